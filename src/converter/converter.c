@@ -20,39 +20,58 @@
 
 #include "converter.h"
 #include "memory.h"
+#include <stdio.h>
 
-static void* converter_OnConvert(void *threadarg)
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+static FilterSetup m_cFilterSetup;
+static pthread_once_t m_hFilterSetupOnce = PTHREAD_ONCE_INIT;
+
+static void converter_InitFilterSetup()
 {
-    ConverterSlot *slot = (ConverterSlot*)(threadarg);
+    filtersetup_New(&m_cFilterSetup);
+    filtersetup_GetTables18(&m_cFilterSetup);
+    filtersetup_GetTables116(&m_cFilterSetup);
+    filtersetup_GetCoefs22(&m_cFilterSetup);
+    filtersetup_GetCoefs32(&m_cFilterSetup);
+}
 
-    while (1)
+/*
+    The frame goes through the whole cascade in blocks of CONVERTER_BLOCK bytes per lane, so that the intermediate
+    samples of a block are still in the cache when the next stage reads them. Every block but the last is a multiple
+    of all decimations, so the blocks give the same samples as one pass over the frame.
+*/
+static void converter_OnConvert(void *pData)
+{
+    ConverterSlot *slot = (ConverterSlot*)(pData);
+    int nLanes = slot->nLanes;
+    int lDsdPcmSamples[CONVERTER_MAX_OUTPUTS];
+
+    for (int nOutput = 0; nOutput < slot->nOutputs; nOutput++)
     {
-        pthread_mutex_lock(&slot->hMutex);
+        slot->lPcmSamples[nOutput] = 0;
+    }
 
-        while (slot->nConverterSlotState != CONVERTER_LOADED && slot->nConverterSlotState != CONVERTER_TERMINATING)
+    for (int nOffset = 0; nOffset < slot->nDsdSamples; nOffset += CONVERTER_BLOCK)
+    {
+        int nBlock = MIN(CONVERTER_BLOCK, slot->nDsdSamples - nOffset);
+
+        for (int nOutput = 0; nOutput < slot->nOutputs; nOutput++)
         {
-            pthread_cond_wait(&slot->hEventPut, &slot->hMutex);
+            if (slot->lSources[nOutput] == nOutput)
+            {
+                lDsdPcmSamples[nOutput] = converterbase_RunDsd(slot->lConverterBases[nOutput], slot->lDsdData + nOffset * nLanes, nBlock);
+            }
         }
 
-        if (slot->nConverterSlotState == CONVERTER_TERMINATING)
+        for (int nOutput = 0; nOutput < slot->nOutputs; nOutput++)
         {
-            slot->nPcmSamples = 0;
-            pthread_mutex_unlock(&slot->hMutex);
-            return 0;
+            int nSource = slot->lSources[nOutput];
+            ConverterBase *pConverterBase = slot->lConverterBases[nOutput];
+            uint8_t *lPcmData = (uint8_t*)slot->lPcmData[nOutput] + slot->lPcmSamples[nOutput] * nLanes * converterbase_GetSampleSize(pConverterBase);
+            slot->lPcmSamples[nOutput] += converterbase_RunPcm(pConverterBase, converterbase_GetDsdPcm(slot->lConverterBases[nSource]), lPcmData, lDsdPcmSamples[nSource]);
         }
-
-        slot->nConverterSlotState = CONVERTER_RUNNING;
-        pthread_mutex_unlock(&slot->hMutex);
-
-        slot->nPcmSamples = converterbase_Convert(slot->pConverterBase, slot->lDsdData, slot->lPcmData, slot->nDsdSamples);
-
-        pthread_mutex_lock(&slot->hMutex);
-        slot->nConverterSlotState = CONVERTER_READY;
-        pthread_cond_signal(&slot->hEventGet);
-        pthread_mutex_unlock(&slot->hMutex);
     }
-
-    return 0;
 }
 
 Converter* converter_New()
@@ -61,11 +80,15 @@ Converter* converter_New()
     pConverter->nChannels = 0;
     pConverter->nFrameRate = 0;
     pConverter->nDsdSampleRate = 0;
-    pConverter->nPcmSampleRate = 0;
-    pConverter->fDelay = 0.0f;
+    pConverter->nOutputs = 0;
     pConverter->lConverterSlots = NULL;
     pConverter->bConvCalled = false;
-    filtersetup_New(&pConverter->cFilterSetup);
+    pConverter->bFloat = false;
+    pConverter->bLockstep = false;
+    pConverter->nSlots = 0;
+    pool_GroupInit(&pConverter->cGroup);
+    pthread_once(&m_hFilterSetupOnce, converter_InitFilterSetup);
+    pConverter->pFilterSetup = &m_cFilterSetup;
 
     for (int i = 0; i < 256; i++)
     {
@@ -82,28 +105,22 @@ Converter* converter_New()
 
 static void converter_FreeSlots(Converter *pConverter)
 {
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
+    for (int nSlot = 0; nSlot < pConverter->nSlots; nSlot++)
     {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
-
-        pthread_mutex_lock(&slot->hMutex);
-        slot->nConverterSlotState = CONVERTER_TERMINATING;
-        pthread_cond_signal(&slot->hEventPut);
-        pthread_mutex_unlock(&slot->hMutex);
+        ConverterSlot *slot = &pConverter->lConverterSlots[nSlot];
 
-        pthread_join(slot->hThread, NULL);
-        pthread_cond_destroy(&slot->hEventGet);
-        pthread_cond_destroy(&slot->hEventPut);
-        pthread_mutex_destroy(&slot->hMutex);
+        for (int nOutput = 0; nOutput < slot->nOutputs; nOutput++)
+        {
+            converterbase_Free(slot->lConverterBases[nOutput]);
+            slot->lConverterBases[nOutput] = NULL;
+            memFree(slot->lPcmData[nOutput]);
+            slot->lPcmData[nOutput] = NULL;
+            slot->lPcmSamples[nOutput] = 0;
+        }
 
-        converterbase_Free(slot->pConverterBase);
-        slot->pConverterBase = NULL;
         memFree(slot->lDsdData);
         slot->lDsdData = NULL;
         slot->nDsdSamples = 0;
-        memFree(slot->lPcmData);
-        slot->lPcmData = NULL;
-        slot->nPcmSamples = 0;
     }
 
     free(pConverter->lConverterSlots);
@@ -123,15 +140,21 @@ static int converter_Close(Converter *pConverter)
 
 void converter_Free(Converter *pConverter)
 {
-    filtersetup_Free(&pConverter->cFilterSetup);
     converter_Close(pConverter);
-    pConverter->fDelay = 0.0f;
     free(pConverter);
 }
 
-float converter_GetDelay(Converter *pConverter)
+float converter_GetDelay(Converter *pConverter, int nOutput)
+{
+    return pConverter->lDelays[nOutput];
+}
+
+/*
+    The multiply-adds per output sample and channel of the filter chain that the planner chose for an output.
+*/
+int converter_GetCost(Converter *pConverter, int nOutput)
 {
-    return pConverter->fDelay;
+    return converterbase_GetCost(pConverter->lConverterSlots[0].lConverterBases[nOutput]);
 }
 
 bool converter_IsConvertCalled(Converter *pConverter)
@@ -139,185 +162,252 @@ bool converter_IsConvertCalled(Converter *pConverter)
     return pConverter->bConvCalled;
 }
 
-static ConverterSlot* converter_InitSlots(Converter *pConverter)
+/*
+    Every slot converts nLanes adjacent channels from nChannel on, interleaved. In lockstep mode the channels are spread
+    evenly over as few slots as CONVERTERBASE_MAX_LANES allows, so up to that many run through the filters side by side
+    on one thread. Otherwise every channel gets its own slot and pool task.
+*/
+static int converter_InitSlots(Converter *pConverter)
 {
-    pConverter->lConverterSlots = calloc (pConverter->nChannels, sizeof (ConverterSlot));
+    pConverter->nSlots = pConverter->bLockstep ? (pConverter->nChannels + CONVERTERBASE_MAX_LANES - 1) / CONVERTERBASE_MAX_LANES : pConverter->nChannels;
+    pConverter->lConverterSlots = calloc (pConverter->nSlots, sizeof (ConverterSlot));
 
     int nDsdSamples = pConverter->nDsdSampleRate / 8 / pConverter->nFrameRate;
-    int nPcmSamples = pConverter->nPcmSampleRate / pConverter->nFrameRate;
-    int nDecimation = pConverter->nDsdSampleRate / pConverter->nPcmSampleRate;
+    int nChannel = 0;
 
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
+    for (int nSlot = 0; nSlot < pConverter->nSlots; nSlot++)
     {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
-        slot->nConverterSlotState = CONVERTER_EMPTY;
-        slot->lDsdData = (uint8_t*)memAlloc(nDsdSamples * sizeof(uint8_t));
+        ConverterSlot *slot = &pConverter->lConverterSlots[nSlot];
+        slot->nChannel = nChannel;
+        slot->nLanes = pConverter->nChannels / pConverter->nSlots + (nSlot < pConverter->nChannels % pConverter->nSlots ? 1 : 0);
+        slot->lDsdData = (uint8_t*)memAlloc(nDsdSamples * slot->nLanes * sizeof(uint8_t));
         slot->nDsdSamples = nDsdSamples;
-        slot->lPcmData = (double*)memAlloc(nPcmSamples * sizeof(double));
-        slot->nPcmSamples = 0;
-        slot->pConverterBase = converterbase_New();
-        converterbase_Init(slot->pConverterBase, &pConverter->cFilterSetup, nDsdSamples, nDecimation);
-        pthread_mutex_init(&slot->hMutex, NULL);
-        pthread_cond_init(&slot->hEventGet, NULL);
-        pthread_cond_init(&slot->hEventPut, NULL);
-        pthread_create(&slot->hThread, NULL, converter_OnConvert, slot);
+        nChannel += slot->nLanes;
+
+        for (int nOutput = 0; nOutput < pConverter->nOutputs; nOutput++)
+        {
+            int nPcmSamples = pConverter->lPcmSampleRates[nOutput] / pConverter->nFrameRate;
+            int nDecimation = pConverter->nDsdSampleRate / pConverter->lPcmSampleRates[nOutput];
+            slot->nOutputs = nOutput + 1;
+            slot->lPcmSamples[nOutput] = 0;
+            slot->lConverterBases[nOutput] = converterbase_New();
+
+            if (converterbase_Init(slot->lConverterBases[nOutput], pConverter->pFilterSetup, CONVERTER_BLOCK, nDecimation, pConverter->bFloat, slot->nLanes) < 0)
+            {
+                converter_FreeSlots(pConverter);
+
+                return -1;
+            }
+
+            slot->lPcmData[nOutput] = memAlloc(nPcmSamples * slot->nLanes * converterbase_GetSampleSize(slot->lConverterBases[nOutput]));
+            slot->lSources[nOutput] = nOutput;
+
+            for (int nSource = 0; nSource < nOutput; nSource++)
+            {
+                if (converterbase_GetDsdDecimation(slot->lConverterBases[nSource]) == converterbase_GetDsdDecimation(slot->lConverterBases[nOutput]))
+                {
+                    slot->lSources[nOutput] = nSource;
+
+                    break;
+                }
+            }
+        }
     }
 
-    return pConverter->lConverterSlots;
+    return 0;
 }
 
-int converter_Init(Converter *pConverter, int nChannels, int nFrameRate, int nDsdSampleRate, int nPcmSampleRate)
+int converter_Init(Converter *pConverter, int nChannels, int nFrameRate, int nDsdSampleRate, int *lPcmSampleRates, int nOutputs, bool bFloat, bool bLockstep)
 {
     converter_Close(pConverter);
 
+    for (int nOutput = 0; nOutput < nOutputs; nOutput++)
+    {
+        ConverterPlan cPlan;
+
+        if (nDsdSampleRate % lPcmSampleRates[nOutput] != 0 || !converterbase_Plan(nDsdSampleRate / lPcmSampleRates[nOutput], &cPlan))
+        {
+            printf("PANIC: Cannot convert %d Hz DSD to %d Hz\n", nDsdSampleRate, lPcmSampleRates[nOutput]);
+
+            return -1;
+        }
+    }
+
     pConverter->nChannels = nChannels;
     pConverter->nFrameRate = nFrameRate;
     pConverter->nDsdSampleRate = nDsdSampleRate;
-    pConverter->nPcmSampleRate = nPcmSampleRate;
-    pConverter->lConverterSlots = converter_InitSlots(pConverter);
-    pConverter->fDelay = converterbase_GetDelay(pConverter->lConverterSlots[0].pConverterBase);
+    pConverter->nOutputs = nOutputs;
+    pConverter->bFloat = bFloat;
+    pConverter->bLockstep = bLockstep;
+
+    for (int nOutput = 0; nOutput < nOutputs; nOutput++)
+    {
+        pConverter->lPcmSampleRates[nOutput] = lPcmSampleRates[nOutput];
+    }
+
+    if (converter_InitSlots(pConverter) < 0)
+    {
+        return -1;
+    }
+
+    for (int nOutput = 0; nOutput < nOutputs; nOutput++)
+    {
+        pConverter->lDelays[nOutput] = converterbase_GetDelay(pConverter->lConverterSlots[0].lConverterBases[nOutput]);
+    }
+
     pConverter->bConvCalled = false;
 
     return 0;
 }
 
-static int converter_ConvertR(Converter *pConverter, float *lPcmData)
+static void converter_Interleave(Converter *pConverter, float **lPcmData, int *lPcmSamples)
 {
-    int nPcmSamples = 0;
-
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
+    for (int nOutput = 0; nOutput < pConverter->nOutputs; nOutput++)
     {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
+        lPcmSamples[nOutput] = 0;
 
-        for (int sample = 0; sample < slot->nDsdSamples / 2; sample++)
+        for (int nSlot = 0; nSlot < pConverter->nSlots; nSlot++)
         {
-            uint8_t temp = slot->lDsdData[slot->nDsdSamples - 1 - sample];
-            slot->lDsdData[slot->nDsdSamples - 1 - sample] = pConverter->lSwapBits[slot->lDsdData[sample]];
-            slot->lDsdData[sample] = pConverter->lSwapBits[temp];
+            ConverterSlot *slot = &pConverter->lConverterSlots[nSlot];
+            int nLanes = slot->nLanes;
+            float *lOut = lPcmData[nOutput] + slot->nChannel;
+
+            if (pConverter->bFloat)
+            {
+                float *lSlotData = (float*)slot->lPcmData[nOutput];
+
+                for (int sample = 0; sample < slot->lPcmSamples[nOutput]; sample++)
+                {
+                    for (int lane = 0; lane < nLanes; lane++)
+                    {
+                        lOut[sample * pConverter->nChannels + lane] = lSlotData[sample * nLanes + lane];
+                    }
+                }
+            }
+            else
+            {
+                double *lSlotData = (double*)slot->lPcmData[nOutput];
+
+                for (int sample = 0; sample < slot->lPcmSamples[nOutput]; sample++)
+                {
+                    for (int lane = 0; lane < nLanes; lane++)
+                    {
+                        lOut[sample * pConverter->nChannels + lane] = (float)lSlotData[sample * nLanes + lane];
+                    }
+                }
+            }
+
+            lPcmSamples[nOutput] += slot->lPcmSamples[nOutput] * nLanes;
         }
-
-        pthread_mutex_lock(&pConverter->lConverterSlots[ch].hMutex);
-        pConverter->lConverterSlots[ch].nConverterSlotState = CONVERTER_LOADED;
-        pthread_cond_signal(&pConverter->lConverterSlots[ch].hEventPut);
-        pthread_mutex_unlock(&pConverter->lConverterSlots[ch].hMutex);
     }
+}
 
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
+static void converter_Run(Converter *pConverter)
+{
+    if (pConverter->nSlots == 1)
     {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
-
-        pthread_mutex_lock(&slot->hMutex);
-
-        while (slot->nConverterSlotState != CONVERTER_READY)
-        {
-            pthread_cond_wait(&slot->hEventGet, &slot->hMutex);
-        }
+        converter_OnConvert(&pConverter->lConverterSlots[0]);
 
-        pthread_mutex_unlock(&slot->hMutex);
-
-        for (int sample = 0; sample < slot->nPcmSamples; sample++)
-        {
-            lPcmData[sample * pConverter->nChannels + ch] = (float)slot->lPcmData[sample];
-        }
+        return;
+    }
 
-        nPcmSamples += slot->nPcmSamples;
+    for (int nSlot = 0; nSlot < pConverter->nSlots; nSlot++)
+    {
+        pool_Submit(&pConverter->cGroup, converter_OnConvert, &pConverter->lConverterSlots[nSlot]);
     }
 
-    return nPcmSamples;
+    pool_Wait(&pConverter->cGroup);
 }
 
-static int converter_ConvertC(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples, float *lPcmData)
+static void converter_ConvertR(Converter *pConverter, float **lPcmData, int *lPcmSamples)
 {
-    int nPcmSamples = 0;
-
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
+    for (int nSlot = 0; nSlot < pConverter->nSlots; nSlot++)
     {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
-        slot->nDsdSamples = nDsdSamples / pConverter->nChannels;
+        ConverterSlot *slot = &pConverter->lConverterSlots[nSlot];
+        int nLanes = slot->nLanes;
 
-        for (int sample = 0; sample < slot->nDsdSamples; sample++)
+        for (int sample = 0; sample < slot->nDsdSamples / 2; sample++)
         {
-            slot->lDsdData[sample] = lDsdData[sample * pConverter->nChannels + ch];
+            uint8_t *lFirst = slot->lDsdData + sample * nLanes;
+            uint8_t *lLast = slot->lDsdData + (slot->nDsdSamples - 1 - sample) * nLanes;
+
+            for (int lane = 0; lane < nLanes; lane++)
+            {
+                uint8_t temp = lLast[lane];
+                lLast[lane] = pConverter->lSwapBits[lFirst[lane]];
+                lFirst[lane] = pConverter->lSwapBits[temp];
+            }
         }
-
-        pthread_mutex_lock(&slot->hMutex);
-        slot->nConverterSlotState = CONVERTER_LOADED;
-        pthread_cond_signal(&slot->hEventPut);
-        pthread_mutex_unlock(&slot->hMutex);
     }
 
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
-    {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
+    converter_Run(pConverter);
+    converter_Interleave(pConverter, lPcmData, lPcmSamples);
+}
 
-        pthread_mutex_lock(&slot->hMutex);
+static void converter_ConvertC(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples, float **lPcmData, int *lPcmSamples)
+{
+    for (int nSlot = 0; nSlot < pConverter->nSlots; nSlot++)
+    {
+        ConverterSlot *slot = &pConverter->lConverterSlots[nSlot];
+        int nLanes = slot->nLanes;
+        slot->nDsdSamples = nDsdSamples / pConverter->nChannels;
 
-        while (slot->nConverterSlotState != CONVERTER_READY)
+        if (pConverter->nSlots == 1)
         {
-            pthread_cond_wait(&slot->hEventGet, &slot->hMutex);
-        }
+            memcpy(slot->lDsdData, lDsdData, slot->nDsdSamples * nLanes);
 
-        pthread_mutex_unlock(&slot->hMutex);
+            continue;
+        }
 
-        for (int sample = 0; sample < slot->nPcmSamples; sample++)
+        for (int sample = 0; sample < slot->nDsdSamples; sample++)
         {
-            lPcmData[sample * pConverter->nChannels + ch] = (float)slot->lPcmData[sample];
+            for (int lane = 0; lane < nLanes; lane++)
+            {
+                slot->lDsdData[sample * nLanes + lane] = lDsdData[sample * pConverter->nChannels + slot->nChannel + lane];
+            }
         }
-
-        nPcmSamples += slot->nPcmSamples;
     }
 
-    return nPcmSamples;
+    converter_Run(pConverter);
+    converter_Interleave(pConverter, lPcmData, lPcmSamples);
 }
 
-static int converter_ConvertL(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples)
+static void converter_ConvertL(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples)
 {
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
+    for (int nSlot = 0; nSlot < pConverter->nSlots; nSlot++)
     {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
+        ConverterSlot *slot = &pConverter->lConverterSlots[nSlot];
+        int nLanes = slot->nLanes;
 
         slot->nDsdSamples = nDsdSamples / pConverter->nChannels;
 
         for (int sample = 0; sample < slot->nDsdSamples; sample++)
         {
-            slot->lDsdData[sample] = pConverter->lSwapBits[lDsdData[(slot->nDsdSamples - 1 - sample) * pConverter->nChannels + ch]];
+            for (int lane = 0; lane < nLanes; lane++)
+            {
+                slot->lDsdData[sample * nLanes + lane] = pConverter->lSwapBits[lDsdData[(slot->nDsdSamples - 1 - sample) * pConverter->nChannels + slot->nChannel + lane]];
+            }
         }
-
-        pthread_mutex_lock(&pConverter->lConverterSlots[ch].hMutex);
-        pConverter->lConverterSlots[ch].nConverterSlotState = CONVERTER_LOADED;
-        pthread_cond_signal(&pConverter->lConverterSlots[ch].hEventPut);
-        pthread_mutex_unlock(&pConverter->lConverterSlots[ch].hMutex);
     }
 
-    for (int ch = 0; ch < pConverter->nChannels; ch++)
-    {
-        ConverterSlot *slot = &pConverter->lConverterSlots[ch];
-
-        pthread_mutex_lock(&slot->hMutex);
-
-        while (slot->nConverterSlotState != CONVERTER_READY)
-        {
-            pthread_cond_wait(&slot->hEventGet, &slot->hMutex);
-        }
-
-        pthread_mutex_unlock(&slot->hMutex);
-    }
-
-    return 0;
+    converter_Run(pConverter);
 }
 
-int converter_Convert(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples, float *lPcmData)
+void converter_Convert(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples, float **lPcmData, int *lPcmSamples)
 {
-    int nPcmSamples = 0;
+    for (int nOutput = 0; nOutput < pConverter->nOutputs; nOutput++)
+    {
+        lPcmSamples[nOutput] = 0;
+    }
 
     if (!lDsdData)
     {
         if (pConverter->lConverterSlots)
         {
-            nPcmSamples = converter_ConvertR(pConverter, lPcmData);
+            converter_ConvertR(pConverter, lPcmData, lPcmSamples);
         }
 
-        return nPcmSamples;
+        return;
     }
 
     if (!pConverter->bConvCalled)
@@ -332,8 +422,6 @@ int converter_Convert(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples,
 
     if (pConverter->lConverterSlots)
     {
-        nPcmSamples = converter_ConvertC(pConverter, lDsdData, nDsdSamples, lPcmData);
+        converter_ConvertC(pConverter, lDsdData, nDsdSamples, lPcmData, lPcmSamples);
     }
-
-    return nPcmSamples;
 }
@@ -21,32 +21,24 @@
 #ifndef CONVERTER_H
 #define CONVERTER_H
 
-#include <pthread.h>
 #include "stdbool.h"
 #include "converterbase.h"
+#include "../worker/pool.h"
 
-typedef enum
-{
-    CONVERTER_EMPTY,
-    CONVERTER_LOADED,
-    CONVERTER_RUNNING,
-    CONVERTER_READY,
-    CONVERTER_TERMINATING
-
-} ConverterSlotState;
+#define CONVERTER_MAX_OUTPUTS 4
+#define CONVERTER_BLOCK 512
 
 typedef struct
 {
     uint8_t *lDsdData;
     int nDsdSamples;
-    double *lPcmData;
-    int nPcmSamples;
-    ConverterBase *pConverterBase;
-    pthread_t hThread;
-    pthread_cond_t hEventGet;
-    pthread_cond_t hEventPut;
-    pthread_mutex_t hMutex;
-    volatile ConverterSlotState nConverterSlotState;
+    int nChannel;
+    int nLanes;
+    int nOutputs;
+    void *lPcmData[CONVERTER_MAX_OUTPUTS];
+    int lPcmSamples[CONVERTER_MAX_OUTPUTS];
+    ConverterBase *lConverterBases[CONVERTER_MAX_OUTPUTS];
+    int lSources[CONVERTER_MAX_OUTPUTS];
 
 } ConverterSlot;
 
@@ -55,20 +47,26 @@ typedef struct
     int nChannels;
     int nFrameRate;
     int nDsdSampleRate;
-    int nPcmSampleRate;
-    float fDelay;
+    int nOutputs;
+    int lPcmSampleRates[CONVERTER_MAX_OUTPUTS];
+    float lDelays[CONVERTER_MAX_OUTPUTS];
     bool bConvCalled;
-    FilterSetup cFilterSetup;
+    bool bFloat;
+    bool bLockstep;
+    int nSlots;
+    FilterSetup *pFilterSetup;
     ConverterSlot *lConverterSlots;
+    PoolGroup cGroup;
     uint8_t lSwapBits[256];
 
 } Converter;
 
 Converter* converter_New();
-float converter_GetDelay(Converter *pConverter);
+float converter_GetDelay(Converter *pConverter, int nOutput);
+int converter_GetCost(Converter *pConverter, int nOutput);
 bool converter_IsConvertCalled(Converter *pConverter);
-int converter_Init(Converter *pConverter, int nChannels, int nFrameRate, int nDsdSampleRate, int nPcmSampleRate);
+int converter_Init(Converter *pConverter, int nChannels, int nFrameRate, int nDsdSampleRate, int *lPcmSampleRates, int nOutputs, bool bFloat, bool bLockstep);
 void converter_Free(Converter *pConverter);
-int converter_Convert(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples, float *lPcmData);
+void converter_Convert(Converter *pConverter, uint8_t *lDsdData, int nDsdSamples, float **lPcmData, int *lPcmSamples);
 
 #endif
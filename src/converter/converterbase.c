@@ -21,6 +21,22 @@
 
 #include "converterbase.h"
 #include "memory.h"
+#include <stdio.h>
+
+typedef struct
+{
+    int nLength;
+    int nDecimation;
+
+} StageInfo;
+
+static const StageInfo m_lStageInfos[4] =
+{
+    {80, 8},
+    {160, 16},
+    {27, 2},
+    {151, 2}
+};
 
 static void converterbase_FreePcmTemp1(ConverterBase *pConverterBase)
 {
@@ -34,16 +50,68 @@ static void converterbase_FreePcmTemp2(ConverterBase *pConverterBase)
     pConverterBase->lPcmTemp2 = NULL;
 }
 
+static void converterbase_FreeDsdPcm(ConverterBase *pConverterBase)
+{
+    memFree(pConverterBase->lDsdPcm);
+    pConverterBase->lDsdPcm = NULL;
+}
+
+int converterbase_GetSampleSize(ConverterBase *pConverterBase)
+{
+    return pConverterBase->bFloat ? sizeof(float) : sizeof(double);
+}
+
 static void converterbase_AllocPcmTemp1(ConverterBase *pConverterBase, int pcm_samples)
 {
     converterbase_FreePcmTemp1(pConverterBase);
-    pConverterBase->lPcmTemp1 = (double*)memAlloc(pcm_samples * sizeof(double));
+    pConverterBase->lPcmTemp1 = memAlloc(pcm_samples * pConverterBase->nLanes * converterbase_GetSampleSize(pConverterBase));
 }
 
 static void converterbase_AllocPcmTemp2(ConverterBase *pConverterBase, int pcm_samples)
 {
     converterbase_FreePcmTemp2(pConverterBase);
-    pConverterBase->lPcmTemp2 = (double*)memAlloc(pcm_samples * sizeof(double));
+    pConverterBase->lPcmTemp2 = memAlloc(pcm_samples * pConverterBase->nLanes * converterbase_GetSampleSize(pConverterBase));
+}
+
+/*
+    The DSD stage decimates by 8 with FILTER18 or by 16 with FILTER116, through the lookup tables of the selected
+    precision.
+*/
+static void converterbase_InitDsdFilter(ConverterBase *pConverterBase, FilterSetup *flt_setup, StageType nStage)
+{
+    int nLength = m_lStageInfos[nStage].nLength;
+    int nDecimation = m_lStageInfos[nStage].nDecimation;
+
+    if (pConverterBase->bFloat)
+    {
+        dsdfilter_InitF(&pConverterBase->cDsdFilter, nStage == STAGE_FILTER116 ? filtersetup_GetTables116F(flt_setup) : filtersetup_GetTables18F(flt_setup), nLength, nDecimation, pConverterBase->nLanes);
+    }
+    else
+    {
+        dsdfilter_Init(&pConverterBase->cDsdFilter, nStage == STAGE_FILTER116 ? filtersetup_GetTables116(flt_setup) : filtersetup_GetTables18(flt_setup), nLength, nDecimation, pConverterBase->nLanes);
+    }
+}
+
+static void converterbase_InitPcmFilter(ConverterBase *pConverterBase, PcmFilter *pPcmFilter, double *lCoefs, int nLength, int nDecimation)
+{
+    if (pConverterBase->bFloat)
+    {
+        pcmfilter_InitF(pPcmFilter, lCoefs, nLength, nDecimation, pConverterBase->nLanes);
+    }
+    else
+    {
+        pcmfilter_Init(pPcmFilter, lCoefs, nLength, nDecimation, pConverterBase->nLanes);
+    }
+}
+
+static int converterbase_RunPcmFilter(ConverterBase *pConverterBase, PcmFilter *pPcmFilter, void *lPcmData, void *lOutData, int nPcmSamples)
+{
+    if (pConverterBase->bFloat)
+    {
+        return pcmfilter_RunF(pPcmFilter, (float*)lPcmData, (float*)lOutData, nPcmSamples);
+    }
+
+    return pcmfilter_Run(pPcmFilter, (double*)lPcmData, (double*)lOutData, nPcmSamples);
 }
 
 ConverterBase *converterbase_New()
@@ -51,12 +119,17 @@ ConverterBase *converterbase_New()
     ConverterBase *pConverterBase = malloc(sizeof(ConverterBase));
     pConverterBase->lPcmTemp1 = NULL;
     pConverterBase->lPcmTemp2 = NULL;
+    pConverterBase->lDsdPcm = NULL;
+    pConverterBase->bFloat = false;
+    pConverterBase->nLanes = 1;
+    pConverterBase->nPcmFilters = 0;
+    pConverterBase->nCost = 0;
     dsdfilter_New(&pConverterBase->cDsdFilter);
-    pcmfilter_New(&pConverterBase->cPcmFilter1A);
-    pcmfilter_New(&pConverterBase->cPcmFilter1B);
-    pcmfilter_New(&pConverterBase->cPcmFilter1C);
-    pcmfilter_New(&pConverterBase->cPcmFilter1D);
-    pcmfilter_New(&pConverterBase->cPcmFilter2);
+
+    for (int i = 0; i < CONVERTERBASE_MAX_STAGES - 1; i++)
+    {
+        pcmfilter_New(&pConverterBase->lPcmFilters[i]);
+    }
 
     return pConverterBase;
 }
@@ -65,12 +138,14 @@ void converterbase_Free(ConverterBase *pConverterBase)
 {
     converterbase_FreePcmTemp1(pConverterBase);
     converterbase_FreePcmTemp2(pConverterBase);
+    converterbase_FreeDsdPcm(pConverterBase);
     dsdfilter_Free(&pConverterBase->cDsdFilter);
-    pcmfilter_Free(&pConverterBase->cPcmFilter1A);
-    pcmfilter_Free(&pConverterBase->cPcmFilter1B);
-    pcmfilter_Free(&pConverterBase->cPcmFilter1C);
-    pcmfilter_Free(&pConverterBase->cPcmFilter1D);
-    pcmfilter_Free(&pConverterBase->cPcmFilter2);
+
+    for (int i = 0; i < CONVERTERBASE_MAX_STAGES - 1; i++)
+    {
+        pcmfilter_Free(&pConverterBase->lPcmFilters[i]);
+    }
+
     free(pConverterBase);
 }
 
@@ -79,124 +154,167 @@ float converterbase_GetDelay(ConverterBase *pConverterBase)
     return pConverterBase->fDelay;
 }
 
-void converterbase_Init(ConverterBase *pConverterBase, FilterSetup *flt_setup, int dsd_samples, int nDecimation)
+int converterbase_GetCost(ConverterBase *pConverterBase)
 {
-    pConverterBase->nDecimation = nDecimation;
+    return pConverterBase->nCost;
+}
 
-    if (nDecimation == 512)
-    {
-        converterbase_AllocPcmTemp1(pConverterBase, dsd_samples / 2);
-        converterbase_AllocPcmTemp2(pConverterBase, dsd_samples / 4);
-        dsdfilter_Init(&pConverterBase->cDsdFilter, filtersetup_GetTables116(flt_setup), 160, 16);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1A, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1B, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1C, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1D, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter2, filtersetup_GetCoefs32(flt_setup), 151, 2);
-        pConverterBase->fDelay = (((dsdfilter_GetDelay(&pConverterBase->cDsdFilter) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1A ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1A)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1B ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1B)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1C ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1C)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter2) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter2);
-    }
-    else if (nDecimation == 256)
-    {
-        converterbase_AllocPcmTemp1(pConverterBase, dsd_samples / 2);
-        converterbase_AllocPcmTemp2(pConverterBase, dsd_samples / 4);
-        dsdfilter_Init(&pConverterBase->cDsdFilter, filtersetup_GetTables116(flt_setup), 160, 16);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1A, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1B, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1C, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter2, filtersetup_GetCoefs32(flt_setup), 151, 2);
-        pConverterBase->fDelay = (((dsdfilter_GetDelay(&pConverterBase->cDsdFilter) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1A ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1A)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1B ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1B)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1C ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1C)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter2) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter2);
-    }
-    else if (nDecimation == 128)
-    {
-        converterbase_AllocPcmTemp1(pConverterBase, dsd_samples / 2);
-        converterbase_AllocPcmTemp2(pConverterBase, dsd_samples / 4);
-        dsdfilter_Init(&pConverterBase->cDsdFilter, filtersetup_GetTables116(flt_setup), 160, 16);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1A, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1B, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter2, filtersetup_GetCoefs32(flt_setup), 151, 2);
-        pConverterBase->fDelay = ((dsdfilter_GetDelay(&pConverterBase->cDsdFilter) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1A ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1A)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1B ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1B)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter2) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter2);
-    }
-    else if (nDecimation == 64)
-    {
-        converterbase_AllocPcmTemp1(pConverterBase, dsd_samples / 2);
-        converterbase_AllocPcmTemp2(pConverterBase, dsd_samples / 4);
-        dsdfilter_Init(&pConverterBase->cDsdFilter, filtersetup_GetTables116(flt_setup), 160, 16);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1A, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter2, filtersetup_GetCoefs32(flt_setup), 151, 2);
-        pConverterBase->fDelay = (dsdfilter_GetDelay(&pConverterBase->cDsdFilter) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1A ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1A)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter2) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter2);
-    }
-    else if (nDecimation == 32)
-    {
-        converterbase_AllocPcmTemp1(pConverterBase, dsd_samples);
-        converterbase_AllocPcmTemp2(pConverterBase, dsd_samples / 2);
-        dsdfilter_Init(&pConverterBase->cDsdFilter, filtersetup_GetTables18(flt_setup), 80, 8);
-        pcmfilter_Init(&pConverterBase->cPcmFilter1A, filtersetup_GetCoefs22(flt_setup), 27, 2);
-        pcmfilter_Init(&pConverterBase->cPcmFilter2, filtersetup_GetCoefs32(flt_setup), 151, 2);
-        pConverterBase->fDelay = (dsdfilter_GetDelay(&pConverterBase->cDsdFilter) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter1A ) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter1A)) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter2) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter2);
-    }
-    else if (nDecimation == 16)
-    {
-        converterbase_AllocPcmTemp1(pConverterBase, dsd_samples);
-        dsdfilter_Init(&pConverterBase->cDsdFilter, filtersetup_GetTables18(flt_setup), 80, 8);
-        pcmfilter_Init(&pConverterBase->cPcmFilter2, filtersetup_GetCoefs32(flt_setup), 151, 2);
-        pConverterBase->fDelay = dsdfilter_GetDelay(&pConverterBase->cDsdFilter) / pcmfilter_GetDecimation(&pConverterBase->cPcmFilter2) + pcmfilter_GetDelay(&pConverterBase->cPcmFilter2);
-    }
-    else if (nDecimation == 8)
+/*
+    A DSD to PCM chain is one DSD stage, FILTER18 (1:8) or FILTER116 (1:16), followed by zero or more FILTER22
+    half-bands and a final FILTER32 half-band that sets the passband. FILTER18 alone is the only chain without
+    FILTER32, and FILTER116 always feeds at least one FILTER22 before FILTER32, as in the fixed chains the converter
+    used before. The cost is the number of multiply-adds per output sample, counting a table lookup of the DSD stage
+    as one, and the cheapest valid chain wins. Returns false when no chain reaches nDecimation.
+*/
+bool converterbase_Plan(int nDecimation, ConverterPlan *pPlan)
+{
+    bool bFound = false;
+
+    for (int nDsdStage = STAGE_FILTER18; nDsdStage <= STAGE_FILTER116; nDsdStage++)
     {
-        dsdfilter_Init(&pConverterBase->cDsdFilter, filtersetup_GetTables18(flt_setup), 80, 8);
-        pConverterBase->fDelay = dsdfilter_GetDelay(&pConverterBase->cDsdFilter);
+        ConverterPlan cPlan;
+        int nPcmDecimation = nDecimation / m_lStageInfos[nDsdStage].nDecimation;
+        int nHalfBands = 0;
+
+        if (nPcmDecimation < 1 || nPcmDecimation * m_lStageInfos[nDsdStage].nDecimation != nDecimation)
+        {
+            continue;
+        }
+
+        while ((1 << nHalfBands) < nPcmDecimation)
+        {
+            nHalfBands++;
+        }
+
+        if ((1 << nHalfBands) != nPcmDecimation || nHalfBands + 1 > CONVERTERBASE_MAX_STAGES || (nDsdStage == STAGE_FILTER116 && nHalfBands < 2))
+        {
+            continue;
+        }
+
+        cPlan.nStages = 0;
+        cPlan.lStages[cPlan.nStages++] = (StageType)nDsdStage;
+
+        for (int i = 0; i < nHalfBands; i++)
+        {
+            cPlan.lStages[cPlan.nStages++] = i == nHalfBands - 1 ? STAGE_FILTER32 : STAGE_FILTER22;
+        }
+
+        cPlan.nCost = 0;
+
+        for (int i = cPlan.nStages - 1, nRatio = 1; i >= 0; i--)
+        {
+            const StageInfo *pStage = &m_lStageInfos[cPlan.lStages[i]];
+            cPlan.nCost += nRatio * (i == 0 ? (pStage->nLength + 7) / 8 : (pStage->nLength + 1) / 4 + 1);
+            nRatio *= pStage->nDecimation;
+        }
+
+        if (!bFound || cPlan.nCost < pPlan->nCost)
+        {
+            *pPlan = cPlan;
+            bFound = true;
+        }
     }
+
+    return bFound;
 }
 
-int converterbase_Convert(ConverterBase *pConverterBase, uint8_t *lDsdData, double *pcm_data, int dsd_samples)
+/*
+    A converter base with several lanes converts that many interleaved channels at once, up to CONVERTERBASE_MAX_LANES,
+    the size of the per-lane sums in the filters. Sample counts stay per lane.
+*/
+int converterbase_Init(ConverterBase *pConverterBase, FilterSetup *flt_setup, int dsd_samples, int nDecimation, bool bFloat, int nLanes)
 {
-    int pcm_samples = 0;
+    ConverterPlan cPlan;
 
-    if (pConverterBase->nDecimation == 512)
+    if (nLanes < 1 || nLanes > CONVERTERBASE_MAX_LANES)
     {
-        pcm_samples = dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, pConverterBase->lPcmTemp1, dsd_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1A, pConverterBase->lPcmTemp1, pConverterBase->lPcmTemp2, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1B, pConverterBase->lPcmTemp2, pConverterBase->lPcmTemp1, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1C, pConverterBase->lPcmTemp1, pConverterBase->lPcmTemp2, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1D, pConverterBase->lPcmTemp2, pConverterBase->lPcmTemp1, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter2, pConverterBase->lPcmTemp1, pcm_data, pcm_samples);
+        printf("PANIC: Cannot filter %d lanes at once\n", nLanes);
+
+        return -1;
     }
-    else if (pConverterBase->nDecimation == 256)
+
+    if (!converterbase_Plan(nDecimation, &cPlan))
     {
-        pcm_samples = dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, pConverterBase->lPcmTemp1, dsd_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1A, pConverterBase->lPcmTemp1, pConverterBase->lPcmTemp2, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1B, pConverterBase->lPcmTemp2, pConverterBase->lPcmTemp1, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1C, pConverterBase->lPcmTemp1, pConverterBase->lPcmTemp2, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter2, pConverterBase->lPcmTemp2, pcm_data, pcm_samples);
+        printf("PANIC: No filter chain for decimation %d\n", nDecimation);
+
+        return -1;
     }
-    else if (pConverterBase->nDecimation == 128)
+
+    pConverterBase->nDecimation = nDecimation;
+    pConverterBase->bFloat = bFloat;
+    pConverterBase->nLanes = nLanes;
+    pConverterBase->nCost = cPlan.nCost;
+    pConverterBase->nPcmFilters = cPlan.nStages - 1;
+    converterbase_InitDsdFilter(pConverterBase, flt_setup, cPlan.lStages[0]);
+    pConverterBase->fDelay = dsdfilter_GetDelay(&pConverterBase->cDsdFilter);
+
+    int dsd_pcm_samples = dsd_samples * 8 / m_lStageInfos[cPlan.lStages[0]].nDecimation;
+
+    for (int i = 0; i < pConverterBase->nPcmFilters; i++)
     {
-        pcm_samples = dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, pConverterBase->lPcmTemp1, dsd_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1A, pConverterBase->lPcmTemp1, pConverterBase->lPcmTemp2, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1B, pConverterBase->lPcmTemp2, pConverterBase->lPcmTemp1, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter2, pConverterBase->lPcmTemp1, pcm_data, pcm_samples);
+        PcmFilter *pPcmFilter = &pConverterBase->lPcmFilters[i];
+        const StageInfo *pStage = &m_lStageInfos[cPlan.lStages[i + 1]];
+        converterbase_InitPcmFilter(pConverterBase, pPcmFilter, cPlan.lStages[i + 1] == STAGE_FILTER32 ? filtersetup_GetCoefs32(flt_setup) : filtersetup_GetCoefs22(flt_setup), pStage->nLength, pStage->nDecimation);
+        pConverterBase->fDelay = pConverterBase->fDelay / pcmfilter_GetDecimation(pPcmFilter) + pcmfilter_GetDelay(pPcmFilter);
     }
-    else if (pConverterBase->nDecimation == 64)
+
+    if (pConverterBase->nPcmFilters > 1)
     {
-        pcm_samples = dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, pConverterBase->lPcmTemp1, dsd_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1A, pConverterBase->lPcmTemp1, pConverterBase->lPcmTemp2, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter2, pConverterBase->lPcmTemp2, pcm_data, pcm_samples);
+        converterbase_AllocPcmTemp1(pConverterBase, dsd_pcm_samples / 2);
+        converterbase_AllocPcmTemp2(pConverterBase, dsd_pcm_samples / 2);
     }
-    else if (pConverterBase->nDecimation == 32)
+
+    converterbase_FreeDsdPcm(pConverterBase);
+    pConverterBase->lDsdPcm = memAlloc(dsd_pcm_samples * nLanes * converterbase_GetSampleSize(pConverterBase));
+
+    return 0;
+}
+
+int converterbase_GetDsdDecimation(ConverterBase *pConverterBase)
+{
+    return pConverterBase->cDsdFilter.nDecimation;
+}
+
+void* converterbase_GetDsdPcm(ConverterBase *pConverterBase)
+{
+    return pConverterBase->lDsdPcm;
+}
+
+int converterbase_RunDsd(ConverterBase *pConverterBase, uint8_t *lDsdData, int dsd_samples)
+{
+    if (pConverterBase->bFloat)
     {
-        pcm_samples = dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, pConverterBase->lPcmTemp1, dsd_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter1A, pConverterBase->lPcmTemp1, pConverterBase->lPcmTemp2, pcm_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter2, pConverterBase->lPcmTemp2, pcm_data, pcm_samples);
+        return dsdfilter_RunF(&pConverterBase->cDsdFilter, lDsdData, (float*)pConverterBase->lDsdPcm, dsd_samples);
     }
-    else if (pConverterBase->nDecimation == 16)
+
+    return dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, (double*)pConverterBase->lDsdPcm, dsd_samples);
+}
+
+/*
+    The PCM stages ping-pong between the two temporaries and the last one writes to pcm_data.
+*/
+int converterbase_RunPcm(ConverterBase *pConverterBase, void *lDsdPcm, void *pcm_data, int pcm_samples)
+{
+    void *lInput = lDsdPcm;
+
+    if (pConverterBase->nPcmFilters == 0)
     {
-        pcm_samples = dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, pConverterBase->lPcmTemp1, dsd_samples);
-        pcm_samples = pcmfilter_Run(&pConverterBase->cPcmFilter2, pConverterBase->lPcmTemp1, pcm_data, pcm_samples);
+        memcpy(pcm_data, lDsdPcm, pcm_samples * pConverterBase->nLanes * converterbase_GetSampleSize(pConverterBase));
     }
-    else if (pConverterBase->nDecimation == 8)
+
+    for (int i = 0; i < pConverterBase->nPcmFilters; i++)
     {
-        pcm_samples = dsdfilter_Run(&pConverterBase->cDsdFilter, lDsdData, pcm_data, dsd_samples);
+        void *lOutput = i == pConverterBase->nPcmFilters - 1 ? pcm_data : i % 2 == 0 ? pConverterBase->lPcmTemp2 : pConverterBase->lPcmTemp1;
+        pcm_samples = converterbase_RunPcmFilter(pConverterBase, &pConverterBase->lPcmFilters[i], lInput, lOutput, pcm_samples);
+        lInput = lOutput;
     }
 
     return pcm_samples;
 }
+
+int converterbase_Convert(ConverterBase *pConverterBase, uint8_t *lDsdData, void *pcm_data, int dsd_samples)
+{
+    int pcm_samples = converterbase_RunDsd(pConverterBase, lDsdData, dsd_samples);
+
+    return converterbase_RunPcm(pConverterBase, pConverterBase->lDsdPcm, pcm_data, pcm_samples);
+}
@@ -25,28 +25,56 @@
 #include "dsdfilter.h"
 #include "pcmfilter.h"
 
+#define CONVERTERBASE_MAX_STAGES 6
+#define CONVERTERBASE_MAX_LANES (DSDFILTER_MAX_LANES < PCMFILTER_MAX_LANES ? DSDFILTER_MAX_LANES : PCMFILTER_MAX_LANES)
+
+typedef enum
+{
+    STAGE_FILTER18 = 0,
+    STAGE_FILTER116 = 1,
+    STAGE_FILTER22 = 2,
+    STAGE_FILTER32 = 3
+
+} StageType;
+
+typedef struct
+{
+    StageType lStages[CONVERTERBASE_MAX_STAGES];
+    int nStages;
+    int nCost;
+
+} ConverterPlan;
+
 typedef struct
 {
     int nFrameRate;
     int nDsdSampleRate;
     int nPcmSampleRate;
     float fDelay;
-    double *lPcmTemp1;
-    double *lPcmTemp2;
+    void *lPcmTemp1;
+    void *lPcmTemp2;
+    void *lDsdPcm;
     DsdFilter cDsdFilter;
-    PcmFilter cPcmFilter1A;
-    PcmFilter cPcmFilter1B;
-    PcmFilter cPcmFilter1C;
-    PcmFilter cPcmFilter1D;
-    PcmFilter cPcmFilter2;
+    PcmFilter lPcmFilters[CONVERTERBASE_MAX_STAGES - 1];
+    int nPcmFilters;
+    int nCost;
     int nDecimation;
+    bool bFloat;
+    int nLanes;
 
 } ConverterBase;
 
 ConverterBase *converterbase_New();
 void converterbase_Free(ConverterBase *pConverterBase);
 float converterbase_GetDelay(ConverterBase *pConverterBase);
-void converterbase_Init(ConverterBase *pConverterBase, FilterSetup *flt_setup, int dsd_samples, int nDecimation);
-int converterbase_Convert(ConverterBase *pConverterBase, uint8_t *lDsdData, double *pcm_data, int dsd_samples);
+int converterbase_GetCost(ConverterBase *pConverterBase);
+bool converterbase_Plan(int nDecimation, ConverterPlan *pPlan);
+int converterbase_Init(ConverterBase *pConverterBase, FilterSetup *flt_setup, int dsd_samples, int nDecimation, bool bFloat, int nLanes);
+int converterbase_GetSampleSize(ConverterBase *pConverterBase);
+int converterbase_GetDsdDecimation(ConverterBase *pConverterBase);
+void* converterbase_GetDsdPcm(ConverterBase *pConverterBase);
+int converterbase_RunDsd(ConverterBase *pConverterBase, uint8_t *lDsdData, int dsd_samples);
+int converterbase_RunPcm(ConverterBase *pConverterBase, void *lDsdPcm, void *pcm_data, int pcm_samples);
+int converterbase_Convert(ConverterBase *pConverterBase, uint8_t *lDsdData, void *pcm_data, int dsd_samples);
 
 #endif
@@ -21,26 +21,45 @@
 #include "dsdfilter.h"
 #include "memory.h"
 
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
 void dsdfilter_New(DsdFilter* pDsdFilter)
 {
     pDsdFilter->pTables = NULL;
+    pDsdFilter->pTablesF = NULL;
     pDsdFilter->nOrder = 0;
     pDsdFilter->nLength = 0;
     pDsdFilter->nDecimation = 0;
     pDsdFilter->lBuffer = NULL;
-    pDsdFilter->nIndex = 0;
+    pDsdFilter->nLanes = 1;
 }
 
-void dsdfilter_Init(DsdFilter* pDsdFilter, CTable *pTables, int nLength, int nDecimation)
+/*
+    The buffer is linear: the last nLength bytes of the previous chunk come first and the new bytes of up to
+    DSDFILTER_BLOCK per lane are appended after them, so every output reads one contiguous window. With several lanes
+    each position holds one byte per lane, and the channels of an interleaved stream are filtered side by side.
+*/
+static void dsdfilter_InitBuffer(DsdFilter* pDsdFilter, int nLength, int nDecimation, int nLanes)
 {
-    pDsdFilter->pTables = pTables;
     pDsdFilter->nOrder = nLength - 1;
     pDsdFilter->nLength = (nLength + 7) / 8;
     pDsdFilter->nDecimation = nDecimation / 8;
-    int buf_size = 2 * pDsdFilter->nLength * sizeof(uint8_t);
+    pDsdFilter->nLanes = nLanes;
+    int buf_size = (pDsdFilter->nLength + DSDFILTER_BLOCK) * nLanes * sizeof(uint8_t);
     pDsdFilter->lBuffer = (uint8_t*)memAlloc(buf_size);
     memset(pDsdFilter->lBuffer, 0x69, buf_size);
-    pDsdFilter->nIndex = 0;
+}
+
+void dsdfilter_Init(DsdFilter* pDsdFilter, CTable *pTables, int nLength, int nDecimation, int nLanes)
+{
+    pDsdFilter->pTables = pTables;
+    dsdfilter_InitBuffer(pDsdFilter, nLength, nDecimation, nLanes);
+}
+
+void dsdfilter_InitF(DsdFilter* pDsdFilter, CTableF *pTablesF, int nLength, int nDecimation, int nLanes)
+{
+    pDsdFilter->pTablesF = pTablesF;
+    dsdfilter_InitBuffer(pDsdFilter, nLength, nDecimation, nLanes);
 }
 
 void dsdfilter_Free(DsdFilter* pDsdFilter)
@@ -57,26 +76,170 @@ float dsdfilter_GetDelay(DsdFilter* pDsdFilter)
     return (float)pDsdFilter->nOrder / 2 / 8 / pDsdFilter->nDecimation;
 }
 
-int dsdfilter_Run(DsdFilter* pDsdFilter, uint8_t *lDsdData, double *lPcmData, int nDsdSamples)
+/*
+    Appends the input of up to nOutputs outputs after the history and returns how many outputs the chunk holds.
+*/
+static int dsdfilter_Append(DsdFilter* pDsdFilter, uint8_t *lDsdData, int nOutputs)
+{
+    int nChunk = MIN(nOutputs, DSDFILTER_BLOCK / pDsdFilter->nDecimation);
+    memcpy(pDsdFilter->lBuffer + pDsdFilter->nLength * pDsdFilter->nLanes, lDsdData, nChunk * pDsdFilter->nDecimation * pDsdFilter->nLanes);
+
+    return nChunk;
+}
+
+static void dsdfilter_Shift(DsdFilter* pDsdFilter, int nChunk)
+{
+    memmove(pDsdFilter->lBuffer, pDsdFilter->lBuffer + nChunk * pDsdFilter->nDecimation * pDsdFilter->nLanes, pDsdFilter->nLength * pDsdFilter->nLanes);
+}
+
+/*
+    Every lane sums the tables in order, oldest byte first, so one lane gives the same result as many. The lanes give
+    the CPU independent chains of lookups and adds to overlap.
+*/
+static inline __attribute__((always_inline)) int dsdfilter_RunN(DsdFilter* pDsdFilter, uint8_t *lDsdData, double *lPcmData, int nDsdSamples, const int nLanes)
 {
     int pcm_samples = nDsdSamples / pDsdFilter->nDecimation;
+    int nLength = pDsdFilter->nLength;
+    int nStep = pDsdFilter->nDecimation * nLanes;
+    CTable *lTables = pDsdFilter->pTables;
 
-    for (int sample = 0; sample < pcm_samples; sample++)
+    for (int nDone = 0; nDone < pcm_samples;)
     {
-        for (int i = 0; i < pDsdFilter->nDecimation; i++)
+        int nChunk = dsdfilter_Append(pDsdFilter, lDsdData + nDone * nStep, pcm_samples - nDone);
+
+        for (int sample = 0; sample < nChunk; sample++)
         {
-            pDsdFilter->lBuffer[pDsdFilter->nIndex + pDsdFilter->nLength] = pDsdFilter->lBuffer[pDsdFilter->nIndex] = *(lDsdData++);
-            pDsdFilter->nIndex = pDsdFilter->nIndex + 1;
-            pDsdFilter->nIndex = pDsdFilter->nIndex % pDsdFilter->nLength;
+            uint8_t *lWindow = pDsdFilter->lBuffer + (sample + 1) * nStep;
+            double lSums[DSDFILTER_MAX_LANES];
+
+            for (int c = 0; c < nLanes; c++)
+            {
+                lSums[c] = 0;
+            }
+
+            for (int j = 0; j < nLength; j++)
+            {
+                for (int c = 0; c < nLanes; c++)
+                {
+                    lSums[c] += lTables[j][lWindow[j * nLanes + c]];
+                }
+            }
+
+            for (int c = 0; c < nLanes; c++)
+            {
+                *(lPcmData++) = lSums[c];
+            }
         }
 
-        lPcmData[sample] = (double)0;
+        dsdfilter_Shift(pDsdFilter, nChunk);
+        nDone += nChunk;
+    }
+
+    return pcm_samples;
+}
+
+/*
+    Sums into four partial sums, which breaks the chain of dependent adds and lets the compiler vectorise the adds.
+*/
+static inline __attribute__((always_inline)) int dsdfilter_RunFN(DsdFilter* pDsdFilter, uint8_t *lDsdData, float *lPcmData, int nDsdSamples, const int nLanes)
+{
+    int pcm_samples = nDsdSamples / pDsdFilter->nDecimation;
+    int nLength = pDsdFilter->nLength;
+    int nStep = pDsdFilter->nDecimation * nLanes;
+    CTableF *lTables = pDsdFilter->pTablesF;
+
+    for (int nDone = 0; nDone < pcm_samples;)
+    {
+        int nChunk = dsdfilter_Append(pDsdFilter, lDsdData + nDone * nStep, pcm_samples - nDone);
 
-        for (int j = 0; j < pDsdFilter->nLength; j++)
+        for (int sample = 0; sample < nChunk; sample++)
         {
-            lPcmData[sample] += pDsdFilter->pTables[j][pDsdFilter->lBuffer[pDsdFilter->nIndex + j]];
+            uint8_t *lWindow = pDsdFilter->lBuffer + (sample + 1) * nStep;
+            float lSums[DSDFILTER_MAX_LANES][4];
+            int j = 0;
+
+            for (int i = 0; i < 4; i++)
+            {
+                for (int c = 0; c < nLanes; c++)
+                {
+                    lSums[c][i] = 0;
+                }
+            }
+
+            for (; j + 4 <= nLength; j += 4)
+            {
+                for (int i = 0; i < 4; i++)
+                {
+                    for (int c = 0; c < nLanes; c++)
+                    {
+                        lSums[c][i] += lTables[j + i][lWindow[(j + i) * nLanes + c]];
+                    }
+                }
+            }
+
+            for (; j < nLength; j++)
+            {
+                for (int c = 0; c < nLanes; c++)
+                {
+                    lSums[c][0] += lTables[j][lWindow[j * nLanes + c]];
+                }
+            }
+
+            for (int c = 0; c < nLanes; c++)
+            {
+                *(lPcmData++) = (lSums[c][0] + lSums[c][1]) + (lSums[c][2] + lSums[c][3]);
+            }
         }
+
+        dsdfilter_Shift(pDsdFilter, nChunk);
+        nDone += nChunk;
     }
 
     return pcm_samples;
 }
+
+/*
+    With the usual channel counts as constants the compiler unrolls the lane loops and keeps the sums in registers. The
+    bodies are forced inline so that every case, one lane included, gets its own copy.
+*/
+int dsdfilter_Run(DsdFilter* pDsdFilter, uint8_t *lDsdData, double *lPcmData, int nDsdSamples)
+{
+    switch (pDsdFilter->nLanes)
+    {
+        case 1:
+            return dsdfilter_RunN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 1);
+        case 2:
+            return dsdfilter_RunN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 2);
+        case 3:
+            return dsdfilter_RunN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 3);
+        case 4:
+            return dsdfilter_RunN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 4);
+        case 5:
+            return dsdfilter_RunN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 5);
+        case 6:
+            return dsdfilter_RunN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 6);
+        default:
+            return dsdfilter_RunN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, pDsdFilter->nLanes);
+    }
+}
+
+int dsdfilter_RunF(DsdFilter* pDsdFilter, uint8_t *lDsdData, float *lPcmData, int nDsdSamples)
+{
+    switch (pDsdFilter->nLanes)
+    {
+        case 1:
+            return dsdfilter_RunFN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 1);
+        case 2:
+            return dsdfilter_RunFN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 2);
+        case 3:
+            return dsdfilter_RunFN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 3);
+        case 4:
+            return dsdfilter_RunFN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 4);
+        case 5:
+            return dsdfilter_RunFN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 5);
+        case 6:
+            return dsdfilter_RunFN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, 6);
+        default:
+            return dsdfilter_RunFN(pDsdFilter, lDsdData, lPcmData, nDsdSamples, pDsdFilter->nLanes);
+    }
+}
@@ -23,23 +23,30 @@
 
 #include <stdint.h>
 
+#define DSDFILTER_MAX_LANES 8
+#define DSDFILTER_BLOCK 1024
+
 typedef double CTable[256];
+typedef float CTableF[256];
 
 typedef struct
 {
     CTable *pTables;
+    CTableF *pTablesF;
     int nOrder;
     int nLength;
     int nDecimation;
     uint8_t *lBuffer;
-    int nIndex;
+    int nLanes;
 
 } DsdFilter;
 
 void dsdfilter_New(DsdFilter* pDsdFilter);
-void dsdfilter_Init(DsdFilter* pDsdFilter, CTable *pTables, int nLength, int nDecimation);
+void dsdfilter_Init(DsdFilter* pDsdFilter, CTable *pTables, int nLength, int nDecimation, int nLanes);
+void dsdfilter_InitF(DsdFilter* pDsdFilter, CTableF *pTablesF, int nLength, int nDecimation, int nLanes);
 void dsdfilter_Free(DsdFilter* pDsdFilter);
 float dsdfilter_GetDelay(DsdFilter* pDsdFilter);
 int dsdfilter_Run(DsdFilter* pDsdFilter, uint8_t *lDsdData, double *lPcmData, int nDsdSamples);
+int dsdfilter_RunF(DsdFilter* pDsdFilter, uint8_t *lDsdData, float *lPcmData, int nDsdSamples);
 
 #endif
@@ -497,12 +497,33 @@ static void filtersetup_SetCoefs(const double *lCoefs, const int nLength, const
     }
 }
 
+/*
+    The single precision tables are rounded from the double ones, so both engines share one filter design.
+*/
+static CTableF* filtersetup_NarrowTables(CTable *pCTables, const int nLength)
+{
+    int ctables = (nLength + 7) / 8;
+    CTableF *pCTablesF = (CTableF*)memAlloc(ctables * sizeof(CTableF));
+
+    for (int ct = 0; ct < ctables; ct++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            pCTablesF[ct][i] = (float)pCTables[ct][i];
+        }
+    }
+
+    return pCTablesF;
+}
+
 void filtersetup_New(FilterSetup *pFilterSetup)
 {
     pFilterSetup->pFilterTable18 = NULL;
     pFilterSetup->pFilterTable116 = NULL;
     pFilterSetup->lFilterCoefs22 = NULL;
     pFilterSetup->lFilterCoefs32 = NULL;
+    pFilterSetup->pFilterTable18F = NULL;
+    pFilterSetup->pFilterTable116F = NULL;
 }
 
 void filtersetup_Free(FilterSetup *pFilterSetup)
@@ -511,6 +532,8 @@ void filtersetup_Free(FilterSetup *pFilterSetup)
     memFree(pFilterSetup->pFilterTable116);
     memFree(pFilterSetup->lFilterCoefs22);
     memFree(pFilterSetup->lFilterCoefs32);
+    memFree(pFilterSetup->pFilterTable18F);
+    memFree(pFilterSetup->pFilterTable116F);
 }
 
 static const double filtersetup_Norm(const int nScale)
@@ -561,3 +584,23 @@ double* filtersetup_GetCoefs32(FilterSetup *pFilterSetup)
 
     return pFilterSetup->lFilterCoefs32;
 }
+
+CTableF* filtersetup_GetTables18F(FilterSetup *pFilterSetup)
+{
+    if (!pFilterSetup->pFilterTable18F)
+    {
+        pFilterSetup->pFilterTable18F = filtersetup_NarrowTables(filtersetup_GetTables18(pFilterSetup), 80);
+    }
+
+    return pFilterSetup->pFilterTable18F;
+}
+
+CTableF* filtersetup_GetTables116F(FilterSetup *pFilterSetup)
+{
+    if (!pFilterSetup->pFilterTable116F)
+    {
+        pFilterSetup->pFilterTable116F = filtersetup_NarrowTables(filtersetup_GetTables116(pFilterSetup), 160);
+    }
+
+    return pFilterSetup->pFilterTable116F;
+}
@@ -22,6 +22,7 @@
 #define FILTERSETUP_H
 
 typedef double CTable[256];
+typedef float CTableF[256];
 
 typedef struct
 {
@@ -29,6 +30,8 @@ typedef struct
     CTable *pFilterTable116;
     double *lFilterCoefs22;
     double *lFilterCoefs32;
+    CTableF *pFilterTable18F;
+    CTableF *pFilterTable116F;
 
 } FilterSetup;
 
@@ -38,5 +41,7 @@ CTable* filtersetup_GetTables18(FilterSetup *pFilterSetup);
 CTable* filtersetup_GetTables116(FilterSetup *pFilterSetup);
 double* filtersetup_GetCoefs22(FilterSetup *pFilterSetup);
 double* filtersetup_GetCoefs32(FilterSetup *pFilterSetup);
+CTableF* filtersetup_GetTables18F(FilterSetup *pFilterSetup);
+CTableF* filtersetup_GetTables116F(FilterSetup *pFilterSetup);
 
 #endif
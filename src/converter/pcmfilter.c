@@ -17,9 +17,11 @@
     You should have received a copy of the GNU General Public License
     along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
 */
-
 #include "pcmfilter.h"
 #include "memory.h"
+#include <stdint.h>
+
+#define MIN(a,b) (((a)<(b))?(a):(b))
 
 void pcmfilter_New(PcmFilter *pPcmFilter)
 {
@@ -28,19 +30,130 @@ void pcmfilter_New(PcmFilter *pPcmFilter)
     pPcmFilter->nLength = 0;
     pPcmFilter->nDecimation = 0;
     pPcmFilter->lBuffer = NULL;
-    pPcmFilter->nIndex = 0;
+    pPcmFilter->bHalfBand = false;
+    pPcmFilter->lTaps = NULL;
+    pPcmFilter->nTaps = 0;
+    pPcmFilter->fCenterTap = 0;
+    pPcmFilter->lHistory = NULL;
+    pPcmFilter->nHistory = 0;
+    pPcmFilter->lCenterHistory = NULL;
+    pPcmFilter->nCenterHistory = 0;
+    pPcmFilter->lCoefsF = NULL;
+    pPcmFilter->lBufferF = NULL;
+    pPcmFilter->lTapsF = NULL;
+    pPcmFilter->fCenterTapF = 0;
+    pPcmFilter->lHistoryF = NULL;
+    pPcmFilter->lCenterHistoryF = NULL;
+    pPcmFilter->nLanes = 1;
+}
+
+/*
+    A symmetric decimate by 2 half-band filter of length 4k+3 is zero at every odd index but the centre. It only needs
+    the even taps, folded in pairs, on one phase and the centre tap, k samples late, on the other.
+*/
+static bool pcmfilter_IsHalfBand(double *lCoefs, int nLength, int nDecimation)
+{
+    if (nDecimation != 2 || nLength % 4 != 3)
+    {
+        return false;
+    }
+
+    for (int j = 0; j < nLength; j++)
+    {
+        if (lCoefs[j] != lCoefs[nLength - 1 - j])
+        {
+            return false;
+        }
+
+        if (j % 2 == 1 && j != nLength / 2 && lCoefs[j] != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
 }
 
-void pcmfilter_Init(PcmFilter *pPcmFilter, double *lCoefs, int nLength, int nDecimation)
+static void pcmfilter_InitHalfBand(PcmFilter *pPcmFilter)
+{
+    pPcmFilter->bHalfBand = true;
+    pPcmFilter->nHistory = (pPcmFilter->nLength + 1) / 2;
+    pPcmFilter->nTaps = pPcmFilter->nHistory / 2;
+    pPcmFilter->nCenterHistory = (pPcmFilter->nLength - 3) / 4 + 1;
+    int history_size = (pPcmFilter->nHistory + PCMFILTER_BLOCK / 2) * pPcmFilter->nLanes;
+    int center_size = (pPcmFilter->nCenterHistory + PCMFILTER_BLOCK / 2) * pPcmFilter->nLanes;
+
+    if (pPcmFilter->lCoefsF)
+    {
+        pPcmFilter->fCenterTapF = pPcmFilter->lCoefsF[pPcmFilter->nLength / 2];
+        pPcmFilter->lTapsF = (float*)memAlloc(pPcmFilter->nTaps * sizeof(float));
+        pPcmFilter->lHistoryF = (float*)memAlloc(history_size * sizeof(float));
+        pPcmFilter->lCenterHistoryF = (float*)memAlloc(center_size * sizeof(float));
+
+        for (int k = 0; k < pPcmFilter->nTaps; k++)
+        {
+            pPcmFilter->lTapsF[k] = pPcmFilter->lCoefsF[2 * k];
+        }
+
+        return;
+    }
+
+    pPcmFilter->fCenterTap = pPcmFilter->lCoefs[pPcmFilter->nLength / 2];
+    pPcmFilter->lTaps = (double*)memAlloc(pPcmFilter->nTaps * sizeof(double));
+    pPcmFilter->lHistory = (double*)memAlloc(history_size * sizeof(double));
+    pPcmFilter->lCenterHistory = (double*)memAlloc(center_size * sizeof(double));
+
+    for (int k = 0; k < pPcmFilter->nTaps; k++)
+    {
+        pPcmFilter->lTaps[k] = pPcmFilter->lCoefs[2 * k];
+    }
+}
+
+/*
+    Every buffer is linear: the history comes first and each chunk of up to PCMFILTER_BLOCK inputs per lane is appended
+    after it, so an output reads one contiguous window, oldest sample first, and the history is moved back to the front
+    once per chunk instead of wrapping an index on every sample.
+*/
+void pcmfilter_Init(PcmFilter *pPcmFilter, double *lCoefs, int nLength, int nDecimation, int nLanes)
 {
     pPcmFilter->lCoefs = lCoefs;
     pPcmFilter->nOrder = nLength - 1;
     pPcmFilter->nLength = nLength;
     pPcmFilter->nDecimation = nDecimation;
-    int buf_size = 2 * pPcmFilter->nLength * sizeof(double);
+    pPcmFilter->nLanes = nLanes;
+    int buf_size = (pPcmFilter->nLength + PCMFILTER_BLOCK) * nLanes * sizeof(double);
     pPcmFilter->lBuffer = (double*)memAlloc(buf_size);
     memset(pPcmFilter->lBuffer, 0, buf_size);
-    pPcmFilter->nIndex = 0;
+
+    if (pcmfilter_IsHalfBand(lCoefs, nLength, nDecimation))
+    {
+        pcmfilter_InitHalfBand(pPcmFilter);
+    }
+}
+
+/*
+    The single precision filter rounds its own copy of the coefficients and keeps the double ones only to check their
+    structure.
+*/
+void pcmfilter_InitF(PcmFilter *pPcmFilter, double *lCoefs, int nLength, int nDecimation, int nLanes)
+{
+    pPcmFilter->lCoefs = lCoefs;
+    pPcmFilter->nOrder = nLength - 1;
+    pPcmFilter->nLength = nLength;
+    pPcmFilter->nDecimation = nDecimation;
+    pPcmFilter->nLanes = nLanes;
+    pPcmFilter->lCoefsF = (float*)memAlloc(nLength * sizeof(float));
+    pPcmFilter->lBufferF = (float*)memAlloc((nLength + PCMFILTER_BLOCK) * nLanes * sizeof(float));
+
+    for (int j = 0; j < nLength; j++)
+    {
+        pPcmFilter->lCoefsF[j] = (float)lCoefs[j];
+    }
+
+    if (pcmfilter_IsHalfBand(lCoefs, nLength, nDecimation))
+    {
+        pcmfilter_InitHalfBand(pPcmFilter);
+    }
 }
 
 void pcmfilter_Free(PcmFilter *pPcmFilter)
@@ -50,6 +163,24 @@ void pcmfilter_Free(PcmFilter *pPcmFilter)
         memFree(pPcmFilter->lBuffer);
         pPcmFilter->lBuffer = NULL;
     }
+
+    memFree(pPcmFilter->lTaps);
+    pPcmFilter->lTaps = NULL;
+    memFree(pPcmFilter->lHistory);
+    pPcmFilter->lHistory = NULL;
+    memFree(pPcmFilter->lCenterHistory);
+    pPcmFilter->lCenterHistory = NULL;
+    memFree(pPcmFilter->lCoefsF);
+    pPcmFilter->lCoefsF = NULL;
+    memFree(pPcmFilter->lBufferF);
+    pPcmFilter->lBufferF = NULL;
+    memFree(pPcmFilter->lTapsF);
+    pPcmFilter->lTapsF = NULL;
+    memFree(pPcmFilter->lHistoryF);
+    pPcmFilter->lHistoryF = NULL;
+    memFree(pPcmFilter->lCenterHistoryF);
+    pPcmFilter->lCenterHistoryF = NULL;
+    pPcmFilter->bHalfBand = false;
 }
 
 int pcmfilter_GetDecimation(PcmFilter *pPcmFilter)
@@ -62,26 +193,259 @@ float pcmfilter_GetDelay(PcmFilter *pPcmFilter)
     return (float)pPcmFilter->nOrder / 2 / pPcmFilter->nDecimation;
 }
 
-int pcmfilter_Run(PcmFilter *pPcmFilter, double *lPcmData, double *lOutData, int nPcmSamples)
+/*
+    Appends the inputs of up to nOutputs outputs and returns how many outputs the chunk holds. A half-band filter takes
+    the two inputs of an output apart: the first one only meets the centre tap, the second one goes into the history
+    that meets the folded taps.
+*/
+static int pcmfilter_Append(PcmFilter *pPcmFilter, void *lHistory, void *lCenterHistory, void *lBuffer, const void *lPcmData, int nOutputs, size_t nSize)
+{
+    int nLanes = pPcmFilter->nLanes;
+
+    if (pPcmFilter->bHalfBand)
+    {
+        int nChunk = MIN(nOutputs, PCMFILTER_BLOCK / 2);
+        uint8_t *lCenter = (uint8_t*)lCenterHistory + pPcmFilter->nCenterHistory * nLanes * nSize;
+        uint8_t *lWindow = (uint8_t*)lHistory + pPcmFilter->nHistory * nLanes * nSize;
+        const uint8_t *lInput = (const uint8_t*)lPcmData;
+
+        for (int sample = 0; sample < nChunk; sample++)
+        {
+            memcpy(lCenter + sample * nLanes * nSize, lInput, nLanes * nSize);
+            memcpy(lWindow + sample * nLanes * nSize, lInput + nLanes * nSize, nLanes * nSize);
+            lInput += 2 * nLanes * nSize;
+        }
+
+        return nChunk;
+    }
+
+    int nChunk = MIN(nOutputs, PCMFILTER_BLOCK / pPcmFilter->nDecimation);
+    memcpy((uint8_t*)lBuffer + pPcmFilter->nLength * nLanes * nSize, lPcmData, nChunk * pPcmFilter->nDecimation * nLanes * nSize);
+
+    return nChunk;
+}
+
+static void pcmfilter_Shift(PcmFilter *pPcmFilter, void *lHistory, void *lCenterHistory, void *lBuffer, int nChunk, size_t nSize)
+{
+    int nLanes = pPcmFilter->nLanes;
+
+    if (pPcmFilter->bHalfBand)
+    {
+        memmove(lCenterHistory, (uint8_t*)lCenterHistory + nChunk * nLanes * nSize, pPcmFilter->nCenterHistory * nLanes * nSize);
+        memmove(lHistory, (uint8_t*)lHistory + nChunk * nLanes * nSize, pPcmFilter->nHistory * nLanes * nSize);
+
+        return;
+    }
+
+    memmove(lBuffer, (uint8_t*)lBuffer + nChunk * pPcmFilter->nDecimation * nLanes * nSize, pPcmFilter->nLength * nLanes * nSize);
+}
+
+/*
+    The lanes run the channels of an interleaved stream side by side: every history position holds one sample per
+    lane, and the inner loops go over the lanes, which the compiler turns into vector operations. Each lane adds its
+    taps in the same order, so one lane gives the same result as many.
+*/
+static inline __attribute__((always_inline)) int pcmfilter_RunN(PcmFilter *pPcmFilter, double *lPcmData, double *lOutData, int nPcmSamples, const int nLanes)
 {
     int out_samples = nPcmSamples / pPcmFilter->nDecimation;
+    int nHistory = pPcmFilter->nHistory;
+    int nTaps = pPcmFilter->nTaps;
+    int nLength = pPcmFilter->nLength;
+    int nStep = pPcmFilter->nDecimation * nLanes;
+    double *lTaps = pPcmFilter->lTaps;
+    double *lCoefs = pPcmFilter->lCoefs;
 
-    for (int sample = 0; sample < out_samples; sample++)
+    for (int nDone = 0; nDone < out_samples;)
     {
-        for (int i = 0; i < pPcmFilter->nDecimation; i++)
+        int nChunk = pcmfilter_Append(pPcmFilter, pPcmFilter->lHistory, pPcmFilter->lCenterHistory, pPcmFilter->lBuffer, lPcmData + nDone * nStep, out_samples - nDone, sizeof(double));
+
+        for (int sample = 0; sample < nChunk; sample++)
         {
-            pPcmFilter->lBuffer[pPcmFilter->nIndex + pPcmFilter->nLength] = pPcmFilter->lBuffer[pPcmFilter->nIndex] = *(lPcmData++);
-            pPcmFilter->nIndex = pPcmFilter->nIndex + 1;
-            pPcmFilter->nIndex = pPcmFilter->nIndex % pPcmFilter->nLength;
+            double lSums[PCMFILTER_MAX_LANES];
+
+            if (pPcmFilter->bHalfBand)
+            {
+                double *lWindow = pPcmFilter->lHistory + (sample + 1) * nLanes;
+                double *lCenter = pPcmFilter->lCenterHistory + (sample + 1) * nLanes;
+                int nLast = (nHistory - 1) * nLanes;
+
+                for (int c = 0; c < nLanes; c++)
+                {
+                    lSums[c] = pPcmFilter->fCenterTap * lCenter[c];
+                }
+
+                for (int k = 0; k < nTaps; k++)
+                {
+                    for (int c = 0; c < nLanes; c++)
+                    {
+                        lSums[c] += lTaps[k] * (lWindow[k * nLanes + c] + lWindow[nLast - k * nLanes + c]);
+                    }
+                }
+            }
+            else
+            {
+                double *lWindow = pPcmFilter->lBuffer + (sample + 1) * nStep;
+
+                for (int c = 0; c < nLanes; c++)
+                {
+                    lSums[c] = 0;
+                }
+
+                for (int j = 0; j < nLength; j++)
+                {
+                    for (int c = 0; c < nLanes; c++)
+                    {
+                        lSums[c] += lCoefs[j] * lWindow[j * nLanes + c];
+                    }
+                }
+            }
+
+            for (int c = 0; c < nLanes; c++)
+            {
+                *(lOutData++) = lSums[c];
+            }
         }
 
-        lOutData[sample] = (double)0;
+        pcmfilter_Shift(pPcmFilter, pPcmFilter->lHistory, pPcmFilter->lCenterHistory, pPcmFilter->lBuffer, nChunk, sizeof(double));
+        nDone += nChunk;
+    }
+
+    return out_samples;
+}
+
+/*
+    The half-band filter sums into four partial sums, so that the compiler can run the folded taps four at a time.
+*/
+static inline __attribute__((always_inline)) int pcmfilter_RunFN(PcmFilter *pPcmFilter, float *lPcmData, float *lOutData, int nPcmSamples, const int nLanes)
+{
+    int out_samples = nPcmSamples / pPcmFilter->nDecimation;
+    int nHistory = pPcmFilter->nHistory;
+    int nTaps = pPcmFilter->nTaps;
+    int nLength = pPcmFilter->nLength;
+    int nStep = pPcmFilter->nDecimation * nLanes;
+    float *lTaps = pPcmFilter->lTapsF;
+    float *lCoefs = pPcmFilter->lCoefsF;
+
+    for (int nDone = 0; nDone < out_samples;)
+    {
+        int nChunk = pcmfilter_Append(pPcmFilter, pPcmFilter->lHistoryF, pPcmFilter->lCenterHistoryF, pPcmFilter->lBufferF, lPcmData + nDone * nStep, out_samples - nDone, sizeof(float));
 
-        for (int j = 0; j < pPcmFilter->nLength; j++)
+        for (int sample = 0; sample < nChunk; sample++)
         {
-            lOutData[sample] += pPcmFilter->lCoefs[j] * pPcmFilter->lBuffer[pPcmFilter->nIndex + j];
+            if (pPcmFilter->bHalfBand)
+            {
+                float *lWindow = pPcmFilter->lHistoryF + (sample + 1) * nLanes;
+                float *lCenter = pPcmFilter->lCenterHistoryF + (sample + 1) * nLanes;
+                int nLast = (nHistory - 1) * nLanes;
+                float lSums[PCMFILTER_MAX_LANES][4];
+                int k = 0;
+
+                for (int i = 0; i < 4; i++)
+                {
+                    for (int c = 0; c < nLanes; c++)
+                    {
+                        lSums[c][i] = 0;
+                    }
+                }
+
+                for (; k + 4 <= nTaps; k += 4)
+                {
+                    for (int i = 0; i < 4; i++)
+                    {
+                        for (int c = 0; c < nLanes; c++)
+                        {
+                            lSums[c][i] += lTaps[k + i] * (lWindow[(k + i) * nLanes + c] + lWindow[nLast - (k + i) * nLanes + c]);
+                        }
+                    }
+                }
+
+                for (; k < nTaps; k++)
+                {
+                    for (int c = 0; c < nLanes; c++)
+                    {
+                        lSums[c][0] += lTaps[k] * (lWindow[k * nLanes + c] + lWindow[nLast - k * nLanes + c]);
+                    }
+                }
+
+                for (int c = 0; c < nLanes; c++)
+                {
+                    *(lOutData++) = pPcmFilter->fCenterTapF * lCenter[c] + (lSums[c][0] + lSums[c][1]) + (lSums[c][2] + lSums[c][3]);
+                }
+            }
+            else
+            {
+                float *lWindow = pPcmFilter->lBufferF + (sample + 1) * nStep;
+                float lSums[PCMFILTER_MAX_LANES];
+
+                for (int c = 0; c < nLanes; c++)
+                {
+                    lSums[c] = 0;
+                }
+
+                for (int j = 0; j < nLength; j++)
+                {
+                    for (int c = 0; c < nLanes; c++)
+                    {
+                        lSums[c] += lCoefs[j] * lWindow[j * nLanes + c];
+                    }
+                }
+
+                for (int c = 0; c < nLanes; c++)
+                {
+                    *(lOutData++) = lSums[c];
+                }
+            }
         }
+
+        pcmfilter_Shift(pPcmFilter, pPcmFilter->lHistoryF, pPcmFilter->lCenterHistoryF, pPcmFilter->lBufferF, nChunk, sizeof(float));
+        nDone += nChunk;
     }
 
     return out_samples;
 }
+
+/*
+    Dispatched on the lane count as in dsdfilter_Run. In each case the folded half-band taps run over a constant number
+    of lanes, which is what lets the single precision sums of one lane vectorise across the four partial sums.
+*/
+int pcmfilter_Run(PcmFilter *pPcmFilter, double *lPcmData, double *lOutData, int nPcmSamples)
+{
+    switch (pPcmFilter->nLanes)
+    {
+        case 1:
+            return pcmfilter_RunN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 1);
+        case 2:
+            return pcmfilter_RunN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 2);
+        case 3:
+            return pcmfilter_RunN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 3);
+        case 4:
+            return pcmfilter_RunN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 4);
+        case 5:
+            return pcmfilter_RunN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 5);
+        case 6:
+            return pcmfilter_RunN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 6);
+        default:
+            return pcmfilter_RunN(pPcmFilter, lPcmData, lOutData, nPcmSamples, pPcmFilter->nLanes);
+    }
+}
+
+int pcmfilter_RunF(PcmFilter *pPcmFilter, float *lPcmData, float *lOutData, int nPcmSamples)
+{
+    switch (pPcmFilter->nLanes)
+    {
+        case 1:
+            return pcmfilter_RunFN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 1);
+        case 2:
+            return pcmfilter_RunFN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 2);
+        case 3:
+            return pcmfilter_RunFN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 3);
+        case 4:
+            return pcmfilter_RunFN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 4);
+        case 5:
+            return pcmfilter_RunFN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 5);
+        case 6:
+            return pcmfilter_RunFN(pPcmFilter, lPcmData, lOutData, nPcmSamples, 6);
+        default:
+            return pcmfilter_RunFN(pPcmFilter, lPcmData, lOutData, nPcmSamples, pPcmFilter->nLanes);
+    }
+}
@@ -21,6 +21,11 @@
 #ifndef PCMFILTER_H
 #define PCMFILTER_H
 
+#include <stdbool.h>
+
+#define PCMFILTER_MAX_LANES 8
+#define PCMFILTER_BLOCK 512
+
 typedef struct
 {
     double *lCoefs;
@@ -28,15 +33,31 @@ typedef struct
     int nLength;
     int nDecimation;
     double *lBuffer;
-    int nIndex;
+    bool bHalfBand;
+    double *lTaps;
+    int nTaps;
+    double fCenterTap;
+    double *lHistory;
+    int nHistory;
+    double *lCenterHistory;
+    int nCenterHistory;
+    float *lCoefsF;
+    float *lBufferF;
+    float *lTapsF;
+    float fCenterTapF;
+    float *lHistoryF;
+    float *lCenterHistoryF;
+    int nLanes;
 
 } PcmFilter;
 
 float pcmfilter_GetDelay(PcmFilter *pPcmFilter);
 void pcmfilter_New(PcmFilter *pPcmFilter);
-void pcmfilter_Init(PcmFilter *pPcmFilter, double *lCoefs, int nLength, int nDecimation);
+void pcmfilter_Init(PcmFilter *pPcmFilter, double *lCoefs, int nLength, int nDecimation, int nLanes);
+void pcmfilter_InitF(PcmFilter *pPcmFilter, double *lCoefs, int nLength, int nDecimation, int nLanes);
 void pcmfilter_Free(PcmFilter *pPcmFilter);
 int pcmfilter_GetDecimation(PcmFilter *pPcmFilter);
 int pcmfilter_Run(PcmFilter *pPcmFilter, double *lPcmData, double *lOutData, int nPcmSamples);
+int pcmfilter_RunF(PcmFilter *pPcmFilter, float *lPcmData, float *lOutData, int nPcmSamples);
 
 #endif
@@ -0,0 +1,121 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "quantizer.h"
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+
+static void quantizer_Pack24Scalar(const float *lSrc, uint8_t *lDst, int nSamples)
+{
+    for (int nSample = 0; nSample < nSamples; nSample++)
+    {
+        float fSample = lSrc[nSample];
+        fSample = MIN(fSample, 1.0);
+        fSample = MAX(fSample, -1.0);
+        fSample *= 8388608.0;
+
+        int32_t nVal = lrintf(fSample);
+        nVal = MIN(nVal, 8388607);
+        nVal = MAX(nVal, -8388608);
+
+        *lDst++ = nVal;
+        *lDst++ = nVal >> 8;
+        *lDst++ = nVal >> 16;
+    }
+}
+
+#if defined(__SSE2__)
+
+/*
+    minps/maxps return their second operand for NaN like MIN/MAX, and cvtps2dq rounds to nearest even like lrintf.
+    Clamping to 8388607 before the conversion matches the integer clamp of the scalar path, byte for byte.
+*/
+
+static int quantizer_Pack24Sse2(const float *lSrc, uint8_t *lDst, int nSamples)
+{
+    const __m128 fHigh = _mm_set1_ps(1.0f);
+    const __m128 fLow = _mm_set1_ps(-1.0f);
+    const __m128 fScale = _mm_set1_ps(8388608.0f);
+    const __m128 fTop = _mm_set1_ps(8388607.0f);
+    int32_t lVal[4];
+    int nSample = 0;
+
+    for (; nSample + 4 <= nSamples; nSample += 4)
+    {
+        __m128 fSample = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(lSrc + nSample), fHigh), fLow);
+        fSample = _mm_min_ps(_mm_mul_ps(fSample, fScale), fTop);
+        _mm_storeu_si128((__m128i*)lVal, _mm_cvtps_epi32(fSample));
+
+        for (int i = 0; i < 4; i++)
+        {
+            *lDst++ = lVal[i];
+            *lDst++ = lVal[i] >> 8;
+            *lDst++ = lVal[i] >> 16;
+        }
+    }
+
+    return nSample;
+}
+
+__attribute__((target("avx2")))
+static int quantizer_Pack24Avx2(const float *lSrc, uint8_t *lDst, int nSamples)
+{
+    const __m256 fHigh = _mm256_set1_ps(1.0f);
+    const __m256 fLow = _mm256_set1_ps(-1.0f);
+    const __m256 fScale = _mm256_set1_ps(8388608.0f);
+    const __m256 fTop = _mm256_set1_ps(8388607.0f);
+    const __m256i nShuffle = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i nPermute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    int nSample = 0;
+
+    // Each store writes 32 bytes of which 24 are valid, so stop while at least 8 more samples follow
+    for (; nSample + 16 <= nSamples; nSample += 8)
+    {
+        __m256 fSample = _mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(lSrc + nSample), fHigh), fLow);
+        fSample = _mm256_min_ps(_mm256_mul_ps(fSample, fScale), fTop);
+        __m256i nVal = _mm256_shuffle_epi8(_mm256_cvtps_epi32(fSample), nShuffle);
+        _mm256_storeu_si256((__m256i*)(lDst + nSample * 3), _mm256_permutevar8x32_epi32(nVal, nPermute));
+    }
+
+    return nSample;
+}
+
+#endif
+
+void quantizer_Pack24(const float *lSrc, uint8_t *lDst, int nSamples)
+{
+    int nSample = 0;
+
+#if defined(__SSE2__)
+    if (__builtin_cpu_supports("avx2"))
+    {
+        nSample = quantizer_Pack24Avx2(lSrc, lDst, nSamples);
+    }
+
+    nSample += quantizer_Pack24Sse2(lSrc + nSample, lDst + nSample * 3, nSamples - nSample);
+#endif
+
+    quantizer_Pack24Scalar(lSrc + nSample, lDst + nSample * 3, nSamples - nSample);
+}
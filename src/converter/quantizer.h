@@ -0,0 +1,31 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef QUANTIZER_H
+#define QUANTIZER_H
+
+#include <stdint.h>
+
+/*
+    Clamps float samples to [-1, 1] and packs them as rounded 24-bit little-endian values.
+*/
+
+void quantizer_Pack24(const float *lSrc, uint8_t *lDst, int nSamples);
+
+#endif
@@ -64,77 +64,71 @@
 
 #include "acdata.h"
 
-#define PBITS 8
-#define PSUM (1 << (PBITS))
-#define ABITS (PBITS + 4)
-#define ONE (1 << ABITS)
-#define HALF (1 << (ABITS - 1))
+#define ONE (1 << AC_ABITS)
 
-int acdata_GetTableIndex(long nPredVal, int nTableLen)
+/*
+    Tops the window up to at least AC_REFILL bits in whole bytes, eight at a time while they are all inside the coded
+    data. The coded data ends with the frame, so only bytes past its end need to be replaced by zeros.
+*/
+void acdata_Refill(ACData *pACData)
 {
-    int j = (nPredVal > 0 ? nPredVal : -nPredVal) >> 3;
-
-    if (j >= nTableLen)
+    if (pACData->nByte + 8 <= pACData->nBytes)
     {
-        j = nTableLen - 1;
-    }
+        const uint8_t *pData = pACData->pADataByte + pACData->nByte;
+        uint64_t nBytes = ((uint64_t)pData[0] << 56) | ((uint64_t)pData[1] << 48) | ((uint64_t)pData[2] << 40) | ((uint64_t)pData[3] << 32)
+                        | ((uint64_t)pData[4] << 24) | ((uint64_t)pData[5] << 16) | ((uint64_t)pData[6] << 8) | (uint64_t)pData[7];
+        int nFill = (64 - pACData->nWindowBits) >> 3;
 
-    return j;
-}
+        // Any bits beyond the whole bytes counted here are the same stream bits the next refill will OR in again
+        pACData->nWindow |= nBytes >> pACData->nWindowBits;
+        pACData->nWindowBits += nFill * 8;
+        pACData->nByte += nFill;
 
-void acdata_Init(ACData *pACData, uint8_t* pADataByte, int fs)
-{
-    pACData->nInit = 0;
-    pACData->nA = ONE - 1;
-    pACData->nC = 0;
+        return;
+    }
 
-    for (pACData->nBit = 1; pACData->nBit <= ABITS; pACData->nBit++)
+    while (pACData->nWindowBits <= AC_REFILL)
     {
-        pACData->nC <<= 1;
+        uint64_t nByte = pACData->nByte < pACData->nBytes ? pACData->pADataByte[pACData->nByte] : 0;
 
-        if (pACData->nBit < fs)
-        {
-            pACData->nC |= GET_BIT(pADataByte, pACData->nBit);
-        }
+        pACData->nWindow |= nByte << (AC_REFILL - pACData->nWindowBits);
+        pACData->nWindowBits += 8;
+        pACData->nByte++;
     }
 }
 
-void acdata_Decode(ACData *pACData, uint8_t* b, int p, uint8_t* pADataByte, int fs)
+void acdata_Init(ACData *pACData, const uint8_t* pADataByte, int nStart, int fs)
 {
-    unsigned int ap;
-    unsigned int h;
-
-    ap = ((pACData->nA >> PBITS) | ((pACData->nA >> (PBITS - 1)) & 1)) * p;
-    h = pACData->nA - ap;
-
-    if (pACData->nC >= h)
-    {
-        *b = 0;
-        pACData->nC -= h;
-        pACData->nA = ap;
-    }
-    else
-    {
-        *b = 1;
-        pACData->nA = h;
-    }
-
-    while (pACData->nA < HALF)
+    pACData->nInit = 0;
+    pACData->nA = ONE - 1;
+    pACData->nC = 0;
+    pACData->pADataByte = pADataByte;
+    pACData->nStart = nStart;
+    pACData->fs = fs;
+    pACData->nBytes = fs > 0 ? (nStart + fs + 7) / 8 : 0;
+    pACData->nByte = nStart / 8;
+    pACData->nWindow = 0;
+    pACData->nWindowBits = 0;
+    acdata_Refill(pACData);
+
+    // Skip to the coded data, whose first bit is always zero and is not part of the code value
+    pACData->nWindow <<= (nStart & 7) + 1;
+    pACData->nWindowBits -= (nStart & 7) + 1;
+    pACData->nC = (unsigned int)(pACData->nWindow >> (64 - AC_ABITS));
+    pACData->nWindow <<= AC_ABITS;
+    pACData->nWindowBits -= AC_ABITS;
+    pACData->nBit = AC_ABITS + 1;
+
+    if (pACData->nWindowBits < AC_ABITS)
     {
-        pACData->nA <<= 1;
-        pACData->nC <<= 1;
-
-        if (pACData->nBit < fs)
-        {
-            pACData->nC |= GET_BIT(pADataByte, pACData->nBit);
-        }
-
-        pACData->nBit++;
+        acdata_Refill(pACData);
     }
 }
 
-void acdata_Flush(ACData *pACData, uint8_t* b, int p, uint8_t* pADataByte, int fs)
+void acdata_Flush(ACData *pACData, uint8_t* b, int p)
 {
+    const uint8_t *pADataByte = pACData->pADataByte;
+    int fs = pACData->fs;
     pACData->nInit = 1;
 
     if (pACData->nBit < fs - 7)
@@ -147,7 +141,7 @@ void acdata_Flush(ACData *pACData, uint8_t* b, int p, uint8_t* pADataByte, int f
 
         while ((pACData->nBit < fs) && (*b == 1))
         {
-            if (GET_BIT(pADataByte, pACData->nBit) != 0)
+            if (GET_BIT(pADataByte, pACData->nStart + pACData->nBit) != 0)
             {
                 *b = 1;
             }
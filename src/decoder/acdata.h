@@ -67,20 +67,64 @@
 
 #include <stdint.h>
 
-#define GET_BIT(BitBase, BitIndex) ((((unsigned char*)BitBase)[BitIndex >> 3] >> (7 - (BitIndex & 7))) & 1)
+#define GET_BIT(BitBase, BitIndex) ((((const unsigned char*)BitBase)[(BitIndex) >> 3] >> (7 - ((BitIndex) & 7))) & 1)
+#define AC_PBITS 8
+#define AC_ABITS (AC_PBITS + 4)
+#define AC_REFILL 56
 
+/*
+    The coded data is read in place from the frame, starting nStart bits into pADataByte and running to the end of the
+    frame. The bits following nBit are kept MSB first in nWindow, which holds nWindowBits of them; past the end of the
+    frame the window is filled with zeros.
+*/
 typedef struct
 {
     unsigned int nInit;
     unsigned int nC;
     unsigned int nA;
     int nBit;
+    uint64_t nWindow;
+    int nWindowBits;
+    int nByte;
+    int nBytes;
+    const uint8_t *pADataByte;
+    int nStart;
+    int fs;
 
 } ACData;
 
-int acdata_GetTableIndex(long nPredVal, int nTableLen);
-void acdata_Init(ACData *pACData, uint8_t *pADataByte, int fs);
-void acdata_Decode(ACData *pACData, uint8_t *b, int p, uint8_t *pADataByte, int fs);
-void acdata_Flush(ACData *pACData, uint8_t *b, int p, uint8_t *pADataByte, int fs);
+void acdata_Init(ACData *pACData, const uint8_t *pADataByte, int nStart, int fs);
+void acdata_Refill(ACData *pACData);
+void acdata_Flush(ACData *pACData, uint8_t *b, int p);
+
+/*
+    Decodes one bit with probability p / 256 of being 1. The interval is renormalised in one step: the leading zeros of
+    nA tell how many bits to shift in, and those are taken from the top of the window.
+*/
+static inline void acdata_Decode(ACData *pACData, uint8_t *b, int p)
+{
+    unsigned int nA = pACData->nA;
+    unsigned int ap = ((nA >> AC_PBITS) | ((nA >> (AC_PBITS - 1)) & 1)) * p;
+    unsigned int h = nA - ap;
+    unsigned int nOne = pACData->nC < h;
+    unsigned int nMask = 0u - nOne;
+
+    *b = (uint8_t)nOne;
+    pACData->nC -= h & ~nMask;
+    nA = (h & nMask) | (ap & ~nMask);
+
+    int nShift = __builtin_clz(nA) - (32 - AC_ABITS);
+
+    pACData->nC = (pACData->nC << nShift) | (unsigned int)((pACData->nWindow >> 1) >> (63 - nShift));
+    pACData->nA = nA << nShift;
+    pACData->nWindow <<= nShift;
+    pACData->nWindowBits -= nShift;
+    pACData->nBit += nShift;
+
+    if (pACData->nWindowBits < AC_ABITS)
+    {
+        acdata_Refill(pACData);
+    }
+}
 
 #endif
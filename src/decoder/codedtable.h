@@ -67,14 +67,11 @@
 
 typedef struct
 {
-    int nStreamBits;
     int lPredOrder[3];
     int lPredCoef[3][3];
     int lCoded[12];
     int lBestMethod[12];
     int lM[12][3];
-    int lDataLenData[12];
-    int lData[12][(1 << 7) * 9];
 
 } CodedTableF;
 
@@ -82,14 +79,11 @@ void codedtablef_New(CodedTableF *pCodedTableF);
 
 typedef struct
 {
-    int nStreamBits;
     int lPredOrder[3];
     int lPredCoef[3][3];
     int lCoded[12];
     int lBestMethod[12];
     int lM[12][3];
-    int lDataLenData[12];
-    int lData[12][8 * (1 << 6)];
 
 } CodedTableP;
 
@@ -22,171 +22,287 @@
 #include <stdlib.h>
 #include <string.h>
 
-void* decoder_OnDecode(void* threadarg)
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+static bool decoder_TakeFrame(Decoder *pDecoder, unsigned int *pFrame)
 {
-    DecoderFrameSlot* pDecoderFrameSlot = (DecoderFrameSlot*)threadarg;
+    unsigned int nTaken = atomic_load(&pDecoder->nTaken);
 
-    while (1)
+    do
     {
-        pthread_mutex_lock(&pDecoderFrameSlot->hMutex);
-
-        while (pDecoderFrameSlot->nDecoderSlotState != DECODER_LOADED && pDecoderFrameSlot->nDecoderSlotState != DECODER_TERMINATING)
+        if (nTaken == atomic_load(&pDecoder->nQueued))
         {
-            pthread_cond_wait(&pDecoderFrameSlot->hEventPut, &pDecoderFrameSlot->hMutex);
+            return false;
         }
+    }
+    while (!atomic_compare_exchange_weak(&pDecoder->nTaken, &nTaken, nTaken + 1));
+
+    *pFrame = nTaken;
 
-        if (pDecoderFrameSlot->nDecoderSlotState == DECODER_TERMINATING)
+    return true;
+}
+
+static void decoder_OnWork(void *pData)
+{
+    DecoderWorker *pWorker = (DecoderWorker*)pData;
+    Decoder *pDecoder = pWorker->pDecoder;
+    unsigned int nFrame;
+
+    while (decoder_TakeFrame(pDecoder, &nFrame))
+    {
+        DecoderFrame *pFrame = &pDecoder->lFrames[nFrame % pDecoder->nDepth];
+
+        if (pFrame->bFetch)
         {
-            pDecoderFrameSlot->lDsdData = NULL;
-            pDecoderFrameSlot->nDstSize = 0;
-            pthread_mutex_unlock(&pDecoderFrameSlot->hMutex);
-            return 0;
+            size_t nDstSize = pDecoder->nDsdSize + 1;
+            pFrame->nDstSize = pDecoder->pFetch(pDecoder->pFetchData, pFrame->nFrame, pFrame->lDstData, &nDstSize) ? (int)nDstSize : 0;
         }
 
-        pDecoderFrameSlot->nDecoderSlotState = DECODER_RUNNING;
-        pthread_mutex_unlock(&pDecoderFrameSlot->hMutex);
-
-        bool bError = false;
-        int nReturn = decoderbase_Decode(&pDecoderFrameSlot->cDecoderBase, pDecoderFrameSlot->lDstData, pDecoderFrameSlot->nDstSize * 8, pDecoderFrameSlot->lDsdData);
+        int nReturn = pFrame->nDstSize > 0 ? decoderbase_Decode(&pWorker->cDecoderBase, pFrame->lDstData, pFrame->nDstSize * 8, pFrame->lDsdData) : -1;
 
         if (nReturn == -1)
         {
-            bError = true;
-            decoderbase_Init(&pDecoderFrameSlot->cDecoderBase, pDecoderFrameSlot->nChannels, pDecoderFrameSlot->nSampleRate / 44100);
+            decoderbase_Init(&pWorker->cDecoderBase, pDecoder->nChannels, pDecoder->nSampleRate / 44100);
+            atomic_store(&pFrame->nDecoderSlotState, DECODER_ERROR);
+        }
+        else
+        {
+            atomic_store(&pFrame->nDecoderSlotState, DECODER_READY);
         }
 
-        pthread_mutex_lock(&pDecoderFrameSlot->hMutex);
-        pDecoderFrameSlot->nDecoderSlotState = bError ? DECODER_ERROR : DECODER_READY;
-        pthread_cond_signal(&pDecoderFrameSlot->hEventGet);
-        pthread_mutex_unlock(&pDecoderFrameSlot->hMutex);
+        pool_GroupRelease(&pFrame->cGroup);
     }
-
-    return 0;
 }
 
-Decoder* decoder_New(int nThreads)
+Decoder* decoder_New(int nWorkers, int nDepth)
 {
     Decoder *pDecoder = malloc(sizeof(Decoder));
-    pDecoder->nThreads = nThreads;
-    pDecoder->lDecoderFrameSlots = malloc(nThreads * sizeof(DecoderFrameSlot));
+    pDecoder->nWorkers = nWorkers;
+    pDecoder->nDepth = nDepth > 0 ? nDepth : 2 * nWorkers;
+    pDecoder->lWorkers = malloc(nWorkers * sizeof(DecoderWorker));
+    pDecoder->lFrames = calloc(pDecoder->nDepth, sizeof(DecoderFrame));
+
+    if (!pDecoder->lWorkers || !pDecoder->lFrames)
+    {
+        pDecoder->nWorkers = 0;
+        pDecoder->nDepth = 0;
+    }
+
+    for (int i = 0; i < pDecoder->nWorkers; i++)
+    {
+        pool_StageInit(&pDecoder->lWorkers[i].cStage, decoder_OnWork, &pDecoder->lWorkers[i]);
+        pDecoder->lWorkers[i].pDecoder = pDecoder;
+        decoderbase_New(&pDecoder->lWorkers[i].cDecoderBase);
+    }
 
-    if (!pDecoder->lDecoderFrameSlots)
+    for (int i = 0; i < pDecoder->nDepth; i++)
     {
-        pDecoder->nThreads = 0;
+        pool_GroupInit(&pDecoder->lFrames[i].cGroup);
     }
 
+    atomic_init(&pDecoder->nQueued, 0);
+    atomic_init(&pDecoder->nTaken, 0);
+    pDecoder->nReleased = 0;
     pDecoder->nChannels = 0;
     pDecoder->nSampleRate = 0;
     pDecoder->nFrameRate = 0;
-    pDecoder->nSlot = 0;
+    pDecoder->nDsdSize = 0;
+    pDecoder->pFetch = NULL;
+    pDecoder->pFetchData = NULL;
 
     return pDecoder;
 }
 
+static void decoder_Wait(Decoder *pDecoder)
+{
+    for (int i = 0; i < pDecoder->nDepth; i++)
+    {
+        pool_Wait(&pDecoder->lFrames[i].cGroup);
+    }
+
+    for (int i = 0; i < pDecoder->nWorkers; i++)
+    {
+        pool_StageWait(&pDecoder->lWorkers[i].cStage);
+    }
+}
+
 void decoder_Free(Decoder *pDecoder)
 {
-    for (int i = 0; i < pDecoder->nThreads; i++)
+    decoder_Wait(pDecoder);
+
+    for (int i = 0; i < pDecoder->nDepth; i++)
     {
-        pthread_mutex_lock(&pDecoder->lDecoderFrameSlots[i].hMutex);
-        pDecoder->lDecoderFrameSlots[i].nDecoderSlotState = DECODER_TERMINATING;
-        pthread_cond_signal(&pDecoder->lDecoderFrameSlots[i].hEventPut);
-        pthread_mutex_unlock(&pDecoder->lDecoderFrameSlots[i].hMutex);
-        pthread_join(pDecoder->lDecoderFrameSlots[i].hThread, NULL);
-        pthread_cond_destroy(&pDecoder->lDecoderFrameSlots[i].hEventGet);
-        pthread_cond_destroy(&pDecoder->lDecoderFrameSlots[i].hEventPut);
-        pthread_mutex_destroy(&pDecoder->lDecoderFrameSlots[i].hMutex);
+        free(pDecoder->lFrames[i].lDstData);
+        free(pDecoder->lFrames[i].lDsdData);
     }
 
-    free(pDecoder->lDecoderFrameSlots);
+    for (int i = 0; i < pDecoder->nWorkers; i++)
+    {
+        decoderbase_Free(&pDecoder->lWorkers[i].cDecoderBase);
+    }
+
+    free(pDecoder->lFrames);
+    free(pDecoder->lWorkers);
     free(pDecoder);
 }
 
 int decoder_Init(Decoder *pDecoder, int nChannels, int nSampleRate, int nFrameRate)
 {
-    for (int i = 0; i < pDecoder->nThreads; i++)
+    decoder_Wait(pDecoder);
+
+    if (pDecoder->nWorkers == 0)
     {
-        if (decoderbase_Init(&pDecoder->lDecoderFrameSlots[i].cDecoderBase, nChannels, (nSampleRate / 44100) / (nFrameRate / 75)) == 0)
-        {
-            pDecoder->lDecoderFrameSlots[i].nDecoderSlotState = DECODER_EMPTY;
-            pDecoder->lDecoderFrameSlots[i].lDsdData = NULL;
-            pDecoder->lDecoderFrameSlots[i].lDstData = NULL;
-            pDecoder->lDecoderFrameSlots[i].nFrame = 0;
-            pDecoder->lDecoderFrameSlots[i].nChannels = nChannels;
-            pDecoder->lDecoderFrameSlots[i].nSampleRate = nSampleRate;
-            pDecoder->lDecoderFrameSlots[i].nFrameRate = nFrameRate;
-            pDecoder->lDecoderFrameSlots[i].nDsdSize = (size_t)(nSampleRate / 8 / nFrameRate * nChannels);
-            pthread_mutex_init(&pDecoder->lDecoderFrameSlots[i].hMutex, NULL);
-            pthread_cond_init(&pDecoder->lDecoderFrameSlots[i].hEventGet, NULL);
-            pthread_cond_init(&pDecoder->lDecoderFrameSlots[i].hEventPut, NULL);
-        }
-        else
+        return -1;
+    }
+
+    for (int i = 0; i < pDecoder->nWorkers; i++)
+    {
+        if (decoderbase_Init(&pDecoder->lWorkers[i].cDecoderBase, nChannels, (nSampleRate / 44100) / (nFrameRate / 75)) != 0)
         {
             return -1;
         }
-
-        pthread_create(&pDecoder->lDecoderFrameSlots[i].hThread, NULL, decoder_OnDecode, &pDecoder->lDecoderFrameSlots[i]);
     }
 
     pDecoder->nChannels = nChannels;
     pDecoder->nSampleRate = nSampleRate;
     pDecoder->nFrameRate = nFrameRate;
-    pDecoder->nFrame = 0;
+    pDecoder->nDsdSize = nSampleRate / 8 / nFrameRate * nChannels;
+
+    // An uncoded DST frame is the DSD frame behind a one byte header
+    for (int i = 0; i < pDecoder->nDepth; i++)
+    {
+        pDecoder->lFrames[i].lDstData = realloc(pDecoder->lFrames[i].lDstData, pDecoder->nDsdSize + 1);
+        pDecoder->lFrames[i].lDsdData = realloc(pDecoder->lFrames[i].lDsdData, pDecoder->nDsdSize);
+        atomic_store(&pDecoder->lFrames[i].nDecoderSlotState, DECODER_EMPTY);
+
+        if (!pDecoder->lFrames[i].lDstData || !pDecoder->lFrames[i].lDsdData)
+        {
+            return -1;
+        }
+    }
+
+    atomic_store(&pDecoder->nQueued, 0);
+    atomic_store(&pDecoder->nTaken, 0);
+    pDecoder->nReleased = 0;
 
     return 0;
 }
 
-int decoder_Decode(Decoder *pDecoder, uint8_t* lDstData, size_t nDstSize, uint8_t** pDsdData, size_t *pDsdSize)
+static DecoderFrame* decoder_GetQueueFrame(Decoder *pDecoder)
 {
-    pDecoder->lDecoderFrameSlots[pDecoder->nSlot].lDsdData = *pDsdData;
-    pDecoder->lDecoderFrameSlots[pDecoder->nSlot].lDstData = lDstData;
-    pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nDstSize = nDstSize;
-    pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nFrame = pDecoder->nFrame;
+    return &pDecoder->lFrames[atomic_load(&pDecoder->nQueued) % pDecoder->nDepth];
+}
 
-    if (nDstSize > 0)
+/*
+    Hands the frame from decoder_GetQueueFrame to the workers. Returns whether nDepth frames are now in flight, so the
+    oldest has to be released before another one can be queued.
+*/
+static bool decoder_Queue(Decoder *pDecoder)
+{
+    unsigned int nQueued = atomic_load(&pDecoder->nQueued);
+    DecoderFrame *pFrame = &pDecoder->lFrames[nQueued % pDecoder->nDepth];
+
+    atomic_store(&pFrame->nDecoderSlotState, DECODER_LOADED);
+    pool_GroupAdd(&pFrame->cGroup);
+    atomic_store(&pDecoder->nQueued, ++nQueued);
+
+    for (int i = 0; i < pDecoder->nWorkers; i++)
     {
-        pthread_mutex_lock(&pDecoder->lDecoderFrameSlots[pDecoder->nSlot].hMutex);
-        pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nDecoderSlotState = DECODER_LOADED;
-        pthread_cond_signal(&pDecoder->lDecoderFrameSlots[pDecoder->nSlot].hEventPut);
-        pthread_mutex_unlock(&pDecoder->lDecoderFrameSlots[pDecoder->nSlot].hMutex);
+        pool_StageKick(&pDecoder->lWorkers[i].cStage);
     }
-    else
+
+    return nQueued - pDecoder->nReleased >= (unsigned int)pDecoder->nDepth;
+}
+
+static int decoder_Release(Decoder *pDecoder, uint8_t **pDsdData, size_t *pDsdSize)
+{
+    if (pDecoder->nReleased == atomic_load(&pDecoder->nQueued))
     {
-        pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nDecoderSlotState = DECODER_EMPTY;
+        return 0;
     }
 
-    pDecoder->nSlot = (pDecoder->nSlot + 1) % pDecoder->nThreads;
+    DecoderFrame *pFrame = &pDecoder->lFrames[pDecoder->nReleased % pDecoder->nDepth];
 
-    if (pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nDecoderSlotState != DECODER_EMPTY)
+    pool_Wait(&pFrame->cGroup);
+    pDecoder->nReleased++;
+    *pDsdData = pFrame->lDsdData;
+    *pDsdSize = (size_t)pDecoder->nDsdSize;
+
+    if (atomic_load(&pFrame->nDecoderSlotState) == DECODER_ERROR)
     {
-        pthread_mutex_lock(&pDecoder->lDecoderFrameSlots[pDecoder->nSlot].hMutex);
+        printf("\nPANIC: Failed to decode frame - inserting silence\n");
+        memset(*pDsdData, 0x69, *pDsdSize);
+
+        return -1;
+    }
+
+    return 0;
+}
 
-        while (pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nDecoderSlotState != DECODER_READY && pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nDecoderSlotState != DECODER_ERROR)
+/*
+    Queues a DST frame, or with nDstSize 0 only drains the queue, and hands back the oldest decoded frame once nDepth
+    frames are in flight or while draining. The DSD data stays valid until the next call. Returns -1 when the frame
+    handed back could not be decoded and was replaced by silence.
+*/
+int decoder_Decode(Decoder *pDecoder, uint8_t* lDstData, size_t nDstSize, uint8_t** pDsdData, size_t *pDsdSize)
+{
+    *pDsdData = NULL;
+    *pDsdSize = 0;
+
+    if (nDstSize > 0)
+    {
+        DecoderFrame *pFrame = decoder_GetQueueFrame(pDecoder);
+
+        pFrame->bFetch = false;
+        pFrame->nDstSize = MIN((int)nDstSize, pDecoder->nDsdSize + 1);
+        memcpy(pFrame->lDstData, lDstData, pFrame->nDstSize);
+
+        if (!decoder_Queue(pDecoder))
         {
-            pthread_cond_wait(&pDecoder->lDecoderFrameSlots[pDecoder->nSlot].hEventGet, &pDecoder->lDecoderFrameSlots[pDecoder->nSlot].hMutex);
+            return 0;
         }
-
-        pthread_mutex_unlock(&pDecoder->lDecoderFrameSlots[pDecoder->nSlot].hMutex);
     }
 
-    switch (pDecoder->lDecoderFrameSlots[pDecoder->nSlot].nDecoderSlotState)
+    return decoder_Release(pDecoder, pDsdData, pDsdSize);
+}
+
+void decoder_SetFetch(Decoder *pDecoder, DecoderFetch pFetch, void *pData)
+{
+    pDecoder->pFetch = pFetch;
+    pDecoder->pFetchData = pData;
+}
+
+/*
+    Like decoder_Decode, but queues frame nFrame of the stream for the worker that takes it to read with the fetch
+    function, so frames are read in parallel and straight into the decoder.
+*/
+int decoder_DecodeFrame(Decoder *pDecoder, uint32_t nFrame, uint8_t **pDsdData, size_t *pDsdSize)
+{
+    DecoderFrame *pFrame = decoder_GetQueueFrame(pDecoder);
+
+    *pDsdData = NULL;
+    *pDsdSize = 0;
+    pFrame->bFetch = true;
+    pFrame->nFrame = nFrame;
+
+    return decoder_Queue(pDecoder) ? decoder_Release(pDecoder, pDsdData, pDsdSize) : 0;
+}
+
+/*
+    The share of filters, over all workers since decoder_Init, whose lookup tables were reused from an earlier frame.
+*/
+float decoder_GetCoefCacheHitRate(Decoder *pDecoder)
+{
+    uint64_t nHits = 0;
+    uint64_t nLookups = 0;
+
+    decoder_Wait(pDecoder);
+
+    for (int i = 0; i < pDecoder->nWorkers; i++)
     {
-        case DECODER_READY:
-            *pDsdData = pDecoder->lDecoderFrameSlots[pDecoder->nSlot].lDsdData;
-            *pDsdSize = (size_t)(pDecoder->nSampleRate / 8 / pDecoder->nFrameRate * pDecoder->nChannels);
-            break;
-        case DECODER_ERROR:
-            printf("\nPANIC: Failed to decode frame - inserting silence\n");
-            *pDsdData = pDecoder->lDecoderFrameSlots[pDecoder->nSlot].lDsdData;
-            *pDsdSize = (size_t)(pDecoder->nSampleRate / 8 / pDecoder->nFrameRate * pDecoder->nChannels);
-            memset(*pDsdData, 0x69, *pDsdSize);
-            break;
-        default:
-            *pDsdData = NULL;
-            *pDsdSize = 0;
-            break;
+        nHits += pDecoder->lWorkers[i].cDecoderBase.nCoefHits;
+        nLookups += pDecoder->lWorkers[i].cDecoderBase.nCoefLookups;
     }
 
-    pDecoder->nFrame++;
-
-    return 0;
+    return nLookups > 0 ? (float)nHits / (float)nLookups : 0.0f;
 }
@@ -22,53 +22,82 @@
 #define DECODER_H
 
 #include "decoderbase.h"
-#include <pthread.h>
+#include "../worker/pool.h"
 
 typedef enum
 {
     DECODER_EMPTY,
     DECODER_LOADED,
-    DECODER_RUNNING,
     DECODER_READY,
-    DECODER_ERROR,
-    DECODER_TERMINATING
+    DECODER_ERROR
 
 } DecoderSlotState;
 
+/*
+    Reads DST frame nFrame of the stream into lDstData, which has room for *pDstSize bytes, and sets *pDstSize to its
+    size. Called from the workers, several at a time.
+*/
+typedef bool (*DecoderFetch)(void *pData, uint32_t nFrame, uint8_t *lDstData, size_t *pDstSize);
+
+/*
+    A frame in flight. Frame n of the stream lives in entry n % nDepth from the time it is queued until the caller has
+    had its DSD data back. cGroup is pending while the frame is waiting to be decoded or being decoded.
+*/
 typedef struct
 {
-    volatile DecoderSlotState nDecoderSlotState;
-    int nFrame;
-    uint8_t *lDsdData;
-    int nDsdSize;
+    atomic_int nDecoderSlotState;
+    PoolGroup cGroup;
     uint8_t *lDstData;
     int nDstSize;
-    int nChannels;
-    int nSampleRate;
-    int nFrameRate;
-    pthread_t hThread;
-    pthread_cond_t hEventGet;
-    pthread_cond_t hEventPut;
-    pthread_mutex_t hMutex;
-    DecoderBase cDecoderBase;
+    bool bFetch;
+    uint32_t nFrame;
+    uint8_t *lDsdData;
+
+} DecoderFrame;
 
-} DecoderFrameSlot;
+struct Decoder;
 
+/*
+    A worker is a stage that takes queued frames in order until there are none left. Each worker owns a DecoderBase,
+    so any worker can decode any frame.
+*/
 typedef struct
 {
-    DecoderFrameSlot *lDecoderFrameSlots;
-    int nThreads;
+    PoolStage cStage;
+    struct Decoder *pDecoder;
+    DecoderBase cDecoderBase;
+
+} DecoderWorker;
+
+/*
+    nQueued frames have been queued, the workers have taken the first nTaken of them and the caller has been handed the
+    first nReleased. The caller gets the frames back in stream order, so a slow frame only holds up its own release
+    while the workers go on with the frames behind it, up to nDepth in flight.
+*/
+typedef struct Decoder
+{
+    DecoderWorker *lWorkers;
+    int nWorkers;
+    DecoderFrame *lFrames;
+    int nDepth;
+    atomic_uint nQueued;
+    atomic_uint nTaken;
+    unsigned int nReleased;
     int nChannels;
     int nSampleRate;
     int nFrameRate;
-    uint32_t nFrame;
-    int nSlot;
+    int nDsdSize;
+    DecoderFetch pFetch;
+    void *pFetchData;
 
 } Decoder;
 
-Decoder* decoder_New(int nThreads);
+Decoder* decoder_New(int nWorkers, int nDepth);
 void decoder_Free(Decoder *pDecoder);
 int decoder_Init(Decoder *pDecoder, int nChannels, int nSampleRate, int nFrameRate);
 int decoder_Decode(Decoder *pDecoder, uint8_t *lDstData, size_t nDstSize, uint8_t **pDsdData, size_t *pDsdSize);
+void decoder_SetFetch(Decoder *pDecoder, DecoderFetch pFetch, void *pData);
+int decoder_DecodeFrame(Decoder *pDecoder, uint32_t nFrame, uint8_t **pDsdData, size_t *pDsdSize);
+float decoder_GetCoefCacheHitRate(Decoder *pDecoder);
 
 #endif
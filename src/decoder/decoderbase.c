@@ -66,27 +66,29 @@
 
 #include "acdata.h"
 #include "decoderbase.h"
+#include <stdlib.h>
 #include <string.h>
 
-#define GET_NIBBLE(NibbleBase, NibbleIndex) ((((unsigned char*)NibbleBase)[NibbleIndex >> 1] >> ((NibbleIndex & 1) << 2)) & 0x0f)
-#define LT_RUN_FILTER_I(FilterTable, ChannelStatus) \
-Predict  = FilterTable[ 0][ChannelStatus[ 0]]; \
-Predict += FilterTable[ 1][ChannelStatus[ 1]]; \
-Predict += FilterTable[ 2][ChannelStatus[ 2]]; \
-Predict += FilterTable[ 3][ChannelStatus[ 3]]; \
-Predict += FilterTable[ 4][ChannelStatus[ 4]]; \
-Predict += FilterTable[ 5][ChannelStatus[ 5]]; \
-Predict += FilterTable[ 6][ChannelStatus[ 6]]; \
-Predict += FilterTable[ 7][ChannelStatus[ 7]]; \
-Predict += FilterTable[ 8][ChannelStatus[ 8]]; \
-Predict += FilterTable[ 9][ChannelStatus[ 9]]; \
-Predict += FilterTable[10][ChannelStatus[10]]; \
-Predict += FilterTable[11][ChannelStatus[11]]; \
-Predict += FilterTable[12][ChannelStatus[12]]; \
-Predict += FilterTable[13][ChannelStatus[13]]; \
-Predict += FilterTable[14][ChannelStatus[14]]; \
-Predict += FilterTable[15][ChannelStatus[15]];
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#define LT_LOOKUP(FilterTable, TableNr, Status) FilterTable[TableNr][(Status >> ((TableNr & 7) * 8)) & 0xff]
 
+void decoderbase_New(DecoderBase *pDecoderBase)
+{
+    pDecoderBase->lCoefCache = NULL;
+    pDecoderBase->nCoefCache = 0;
+}
+
+void decoderbase_Free(DecoderBase *pDecoderBase)
+{
+    free(pDecoderBase->lCoefCache);
+    pDecoderBase->lCoefCache = NULL;
+    pDecoderBase->nCoefCache = 0;
+}
+
+/*
+    The coefficient cache holds a few more sets than a frame of this channel count can use, which is all the decoder
+    allocates besides the fixed size frame header.
+*/
 int decoderbase_Init(DecoderBase *pDecoderBase, int nChannels, int nFs44)
 {
     pDecoderBase->cFrameHeader.nChannels = nChannels;
@@ -100,94 +102,184 @@ int decoderbase_Init(DecoderBase *pDecoderBase, int nChannels, int nFs44)
     codedtablef_New(&pDecoderBase->cCodedTableF);
     codedtablep_New(&pDecoderBase->cCodedTableP);
 
+    int nCoefCache = pDecoderBase->cFrameHeader.nMaxFilters + 4;
+
+    if (pDecoderBase->nCoefCache != nCoefCache)
+    {
+        free(pDecoderBase->lCoefCache);
+        pDecoderBase->lCoefCache = malloc(nCoefCache * sizeof(CoefTable));
+        pDecoderBase->nCoefCache = pDecoderBase->lCoefCache ? nCoefCache : 0;
+
+        if (!pDecoderBase->lCoefCache)
+        {
+            return -1;
+        }
+    }
+
+    for (int i = 0; i < pDecoderBase->nCoefCache; i++)
+    {
+        pDecoderBase->lCoefCache[i].nUsed = 0;
+    }
+
+    pDecoderBase->nCoefHits = 0;
+    pDecoderBase->nCoefLookups = 0;
+
     return 0;
 }
 
-static void decoderbase_FillTable4Bit(DecoderBase *pDecoderBase, Segment *pSegment, uint8_t Table4Bit[6][75264])
+/*
+    Moves a channel on to the segment that holds bit BitNr and returns where that segment ends. The last segment of a
+    channel runs to the end of the frame.
+*/
+static int decoderbase_NextSegment(Segment *pSegment, int ChNr, int BitNr, int nBitsPerCh, int *pSegNr, int nEnd)
 {
-    int SegNr;
-    int Start;
-    int End;
-    int8_t Val;
+    while (nEnd <= BitNr && *pSegNr < pSegment->lSegments[ChNr] - 1)
+    {
+        nEnd += pSegment->nResolution * 8 * pSegment->lLengths[ChNr][++*pSegNr];
+    }
 
-    for (int ChNr = 0; ChNr < pDecoderBase->cFrameHeader.nChannels; ChNr++)
+    return *pSegNr < pSegment->lSegments[ChNr] - 1 && nEnd < nBitsPerCh ? nEnd : nBitsPerCh;
+}
+
+/*
+    Entry i of a table is the sum of its k coefficients with the sign taken from the bits of i. Setting bit j of i only
+    flips the sign of coefficient j, so the entries are built by doubling: the upper half of the first 2^(j+1) entries
+    is the lower half plus one constant, a loop the compiler turns into wide vector adds.
+*/
+void decoderbase_BuildCoefTable(const int16_t *lICoefA, int FilterLength, int16_t Table[16][256])
+{
+    for (int TableNr = 0; TableNr < 16; TableNr++)
     {
-        for (SegNr = 0, Start = 0; SegNr < pSegment->lSegments[ChNr] - 1; SegNr++)
+        int k = FilterLength - TableNr * 8;
+
+        if (k > 8)
+        {
+            k = 8;
+        }
+        else if (k < 0)
         {
-            Val = (int8_t)pSegment->lTable[ChNr][SegNr];
-            End = Start + pSegment->nResolution * 8 * pSegment->lLengths[ChNr][SegNr];
+            k = 0;
+        }
 
-            for (int BitNr = Start; BitNr < End; BitNr++)
-            {
-                uint8_t* p = (uint8_t*)&Table4Bit[ChNr][BitNr / 2];
-                int s = (BitNr & 1) << 2;
-                *p = ((uint8_t)Val << s) | (*p & (0xf0 >> s));
-            }
+        int cvalue = 0;
 
-            Start += pSegment->nResolution * 8 * pSegment->lLengths[ChNr][SegNr];
+        for (int j = 0; j < k; j++)
+        {
+            cvalue -= lICoefA[TableNr * 8 + j];
         }
 
-        Val = (int8_t)pSegment->lTable[ChNr][SegNr];
+        Table[TableNr][0] = (int16_t)cvalue;
 
-        for (int BitNr = Start; BitNr < pDecoderBase->cFrameHeader.nBitsPerCh; BitNr++)
+        for (int j = 0; j < 8; j++)
         {
-            uint8_t* p = (uint8_t*)&Table4Bit[ChNr][BitNr / 2];
-            int s = (BitNr & 1) << 2;
-            *p = ((uint8_t)Val << s) | (*p & (0xf0 >> s));
+            int16_t Step = j < k ? (int16_t)(2 * lICoefA[TableNr * 8 + j]) : 0;
+
+            for (int i = 0; i < (1 << j); i++)
+            {
+                Table[TableNr][(1 << j) + i] = (int16_t)(Table[TableNr][i] + Step);
+            }
         }
     }
 }
 
-static void decoderbase_InitCoefTables(DecoderBase *pDecoderBase, int16_t ICoefI[12][16][256])
+static uint32_t decoderbase_HashCoefs(const int16_t *lICoefA, int FilterLength)
+{
+    uint32_t nHash = 2166136261u ^ (uint32_t)FilterLength;
+
+    for (int i = 0; i < FilterLength; i++)
+    {
+        nHash = (nHash ^ (uint16_t)lICoefA[i]) * 16777619u;
+    }
+
+    return nHash;
+}
+
+/*
+    Filters are often carried over unchanged from one frame to the next, so the tables of recent coefficient sets are
+    kept and only a set that is not among them is built, in place of the one that has gone unused the longest. The cache
+    is larger than nMaxFilters, so a frame never evicts a table it uses itself. Filter numbers a corrupt mapping can
+    still name get all zero tables.
+*/
+static void decoderbase_InitCoefTables(DecoderBase *pDecoderBase, const int16_t (*ICoefI[16])[256])
 {
-    int FilterNr, FilterLength, TableNr, k, i, j;
+    static const int16_t lZeroTable[16][256] = {{0}};
 
-    for (FilterNr = 0; FilterNr < pDecoderBase->cFrameHeader.nFilters; FilterNr++)
+    int nFrame = pDecoderBase->cFrameHeader.nFrame;
+
+    for (int FilterNr = 0; FilterNr < pDecoderBase->cFrameHeader.nFilters; FilterNr++)
     {
-        FilterLength = pDecoderBase->cFrameHeader.lPredOrder[FilterNr];
+        const int16_t *lICoefA = pDecoderBase->cFrameHeader.lICoefA[FilterNr];
+        int FilterLength = pDecoderBase->cFrameHeader.lPredOrder[FilterNr];
+        uint32_t nHash = decoderbase_HashCoefs(lICoefA, FilterLength);
+        CoefTable *pEntry = NULL;
+        CoefTable *pOldest = &pDecoderBase->lCoefCache[0];
 
-        for (TableNr = 0; TableNr < 16; TableNr++)
+        for (int i = 0; i < pDecoderBase->nCoefCache; i++)
         {
-            k = FilterLength - TableNr * 8;
+            CoefTable *pCoefTable = &pDecoderBase->lCoefCache[i];
 
-            if (k > 8)
-            {
-                k = 8;
-            }
-            else if (k < 0)
+            if (pCoefTable->nUsed && pCoefTable->nHash == nHash && pCoefTable->nPredOrder == FilterLength && memcmp(pCoefTable->lICoefA, lICoefA, FilterLength * sizeof(int16_t)) == 0)
             {
-                k = 0;
+                pEntry = pCoefTable;
+
+                break;
             }
 
-            for (i = 0; i < 256; i++)
+            if (pCoefTable->nUsed < pOldest->nUsed)
             {
-                int cvalue = 0;
+                pOldest = pCoefTable;
+            }
+        }
 
-                for (j = 0; j < k; j++)
-                {
-                    cvalue += (((i >> j) & 1) * 2 - 1) * pDecoderBase->cFrameHeader.lICoefA[FilterNr][TableNr * 8 + j];
-                }
+        pDecoderBase->nCoefLookups++;
 
-                ICoefI[FilterNr][TableNr][i] = (int16_t)cvalue;
-            }
+        if (pEntry)
+        {
+            pDecoderBase->nCoefHits++;
         }
+        else
+        {
+            pEntry = pOldest;
+            pEntry->nHash = nHash;
+            pEntry->nPredOrder = FilterLength;
+            memcpy(pEntry->lICoefA, lICoefA, FilterLength * sizeof(int16_t));
+            decoderbase_BuildCoefTable(lICoefA, FilterLength, pEntry->lTable);
+        }
+
+        pEntry->nUsed = nFrame;
+        ICoefI[FilterNr] = (const int16_t (*)[256])pEntry->lTable;
+    }
+
+    for (int FilterNr = pDecoderBase->cFrameHeader.nFilters; FilterNr < 16; FilterNr++)
+    {
+        ICoefI[FilterNr] = lZeroTable;
     }
 }
 
-static void decoderbase_InitStatus(DecoderBase *pDecoderBase, uint8_t Status[6][16])
+static void decoderbase_InitStatus(DecoderBase *pDecoderBase, uint64_t Status[6][2])
 {
-    int ChNr, TableNr;
-
-    for (ChNr = 0; ChNr < pDecoderBase->cFrameHeader.nChannels; ChNr++)
+    for (int ChNr = 0; ChNr < pDecoderBase->cFrameHeader.nChannels; ChNr++)
     {
-        for (TableNr = 0; TableNr < 16; TableNr++)
-        {
-            Status[ChNr][TableNr] = 0xaa;
-        }
+        Status[ChNr][0] = 0xaaaaaaaaaaaaaaaaULL;
+        Status[ChNr][1] = 0xaaaaaaaaaaaaaaaaULL;
     }
 }
 
-static int16_t decoderbase_Reverse7LSBs(int16_t c)
+/*
+    The 128 bit history of a channel is held in two words, low byte first, and byte n indexes table n of the filter.
+    The 16 lookups are independent and summed as a tree; the result wraps to 16 bits exactly like a running int16_t sum.
+*/
+static inline int16_t decoderbase_RunFilter(const int16_t FilterTable[16][256], uint64_t Status[2])
+{
+    int Lo = ((LT_LOOKUP(FilterTable, 0, Status[0]) + LT_LOOKUP(FilterTable, 1, Status[0])) + (LT_LOOKUP(FilterTable, 2, Status[0]) + LT_LOOKUP(FilterTable, 3, Status[0])))
+           + ((LT_LOOKUP(FilterTable, 4, Status[0]) + LT_LOOKUP(FilterTable, 5, Status[0])) + (LT_LOOKUP(FilterTable, 6, Status[0]) + LT_LOOKUP(FilterTable, 7, Status[0])));
+    int Hi = ((LT_LOOKUP(FilterTable, 8, Status[1]) + LT_LOOKUP(FilterTable, 9, Status[1])) + (LT_LOOKUP(FilterTable, 10, Status[1]) + LT_LOOKUP(FilterTable, 11, Status[1])))
+           + ((LT_LOOKUP(FilterTable, 12, Status[1]) + LT_LOOKUP(FilterTable, 13, Status[1])) + (LT_LOOKUP(FilterTable, 14, Status[1]) + LT_LOOKUP(FilterTable, 15, Status[1])));
+
+    return (int16_t)(Lo + Hi);
+}
+
+int16_t decoderbase_Reverse7LSBs(int16_t c)
 {
     const int16_t reverse[128] =
     {
@@ -225,49 +317,83 @@ int decoderbase_Decode(DecoderBase *pDecoderBase, uint8_t* lDstFrame, int nFrame
     if (pDecoderBase->cFrameHeader.nDstCoded == 1)
     {
         ACData AC;
-        int16_t LT_ICoefI[12][16][256]= {0};
-        uint8_t LT_Status[6][16]= {0};
+        const int16_t (*LT_ICoefI[16])[256];
+        uint64_t LT_Status[6][2]= {0};
+        Segment *pSegmentF = &pDecoderBase->cFrameHeader.cSegmentF;
+        Segment *pSegmentP = &pDecoderBase->cFrameHeader.cSegmentP;
+        int lFilterSeg[6], lFilterEnd[6], lPtableSeg[6], lPtableEnd[6], lHalf[6];
+        const int16_t (*lFilters[6])[256];
+        int *lPtables[6];
 
-        decoderbase_FillTable4Bit(pDecoderBase, &pDecoderBase->cFrameHeader.cSegmentF, pDecoderBase->cFrameHeader.lFilter4Bit);
-        decoderbase_FillTable4Bit(pDecoderBase, &pDecoderBase->cFrameHeader.cSegmentP, pDecoderBase->cFrameHeader.lPTable4Bit);
         decoderbase_InitCoefTables(pDecoderBase, LT_ICoefI);
         decoderbase_InitStatus(pDecoderBase, LT_Status);
-        acdata_Init(&AC, pDecoderBase->lADataByte, pDecoderBase->nADataLen);
-        acdata_Decode(&AC, &ACError, decoderbase_Reverse7LSBs(pDecoderBase->cFrameHeader.lICoefA[0][0]), pDecoderBase->lADataByte, pDecoderBase->nADataLen);
+        acdata_Init(&AC, lDstFrame, pDecoderBase->nADataStart, pDecoderBase->nADataLen);
+        acdata_Decode(&AC, &ACError, decoderbase_Reverse7LSBs(pDecoderBase->cFrameHeader.lICoefA[0][0]));
         memset(lDsdFrame, 0, (nBitsPerCh * nChannels + 7) / 8);
 
-        for (BitNr = 0; BitNr < nBitsPerCh; BitNr++)
+        for (ChNr = 0; ChNr < nChannels; ChNr++)
         {
+            lFilterSeg[ChNr] = 0;
+            lFilterEnd[ChNr] = pSegmentF->nResolution * 8 * pSegmentF->lLengths[ChNr][0];
+            lPtableSeg[ChNr] = 0;
+            lPtableEnd[ChNr] = pSegmentP->nResolution * 8 * pSegmentP->lLengths[ChNr][0];
+        }
+
+        // The filter and probability table of every channel stay the same up to the next segment boundary of any channel
+        for (BitNr = 0; BitNr < nBitsPerCh;)
+        {
+            int RunEnd = nBitsPerCh;
+
             for (ChNr = 0; ChNr < nChannels; ChNr++)
             {
-                int16_t Predict;
-                uint8_t Residual;
-                int16_t BitVal;
-                const int FilterNr = GET_NIBBLE(pDecoderBase->cFrameHeader.lFilter4Bit[ChNr], BitNr);
-                LT_RUN_FILTER_I(LT_ICoefI[FilterNr], LT_Status[ChNr]);
-
-                if ((pDecoderBase->cFrameHeader.lHalfProbs[ChNr]) && (BitNr < pDecoderBase->cFrameHeader.lHalfBits[ChNr]))
+                lFilterEnd[ChNr] = decoderbase_NextSegment(pSegmentF, ChNr, BitNr, nBitsPerCh, &lFilterSeg[ChNr], lFilterEnd[ChNr]);
+                lPtableEnd[ChNr] = decoderbase_NextSegment(pSegmentP, ChNr, BitNr, nBitsPerCh, &lPtableSeg[ChNr], lPtableEnd[ChNr]);
+                lFilters[ChNr] = LT_ICoefI[pSegmentF->lTable[ChNr][lFilterSeg[ChNr]]];
+                lPtables[ChNr] = pDecoderBase->lPOne[pSegmentP->lTable[ChNr][lPtableSeg[ChNr]]];
+                lHalf[ChNr] = pDecoderBase->cFrameHeader.lHalfProbs[ChNr] && BitNr < pDecoderBase->cFrameHeader.lHalfBits[ChNr];
+                RunEnd = MIN(RunEnd, MIN(lFilterEnd[ChNr], lPtableEnd[ChNr]));
+
+                if (lHalf[ChNr])
                 {
-                    acdata_Decode(&AC, &Residual, (1 << 8) / 2, pDecoderBase->lADataByte, pDecoderBase->nADataLen);
+                    RunEnd = MIN(RunEnd, pDecoderBase->cFrameHeader.lHalfBits[ChNr]);
                 }
-                else
+            }
+
+            for (; BitNr < RunEnd; BitNr++)
+            {
+                int16_t LT_Predict[6];
+
+                // A channel's prediction only depends on its own history, so all of them are ready before the serial decode
+                for (ChNr = 0; ChNr < nChannels; ChNr++)
                 {
-                    int PtableNr = GET_NIBBLE(pDecoderBase->cFrameHeader.lPTable4Bit[ChNr], BitNr);
-                    int PtableIndex = acdata_GetTableIndex(Predict, pDecoderBase->cFrameHeader.lPTableLengths[PtableNr]);
-                    acdata_Decode(&AC, &Residual, pDecoderBase->lPOne[PtableNr][PtableIndex], pDecoderBase->lADataByte, pDecoderBase->nADataLen);
+                    LT_Predict[ChNr] = decoderbase_RunFilter(lFilters[ChNr], LT_Status[ChNr]);
                 }
 
-                BitVal = ((((uint16_t)Predict) >> 15) ^ Residual) & 1;
-                lDsdFrame[(BitNr >> 3) * nChannels + ChNr] |= (uint8_t)(BitVal << (7 - (BitNr & 7)));
-                uint32_t* const st = (uint32_t*)LT_Status[ChNr];
-                st[3] = (st[3] << 1) | ((st[2] >> 31) & 1);
-                st[2] = (st[2] << 1) | ((st[1] >> 31) & 1);
-                st[1] = (st[1] << 1) | ((st[0] >> 31) & 1);
-                st[0] = (st[0] << 1) | BitVal;
+                for (ChNr = 0; ChNr < nChannels; ChNr++)
+                {
+                    int16_t Predict = LT_Predict[ChNr];
+                    uint8_t Residual;
+                    int16_t BitVal;
+
+                    if (lHalf[ChNr])
+                    {
+                        acdata_Decode(&AC, &Residual, (1 << 8) / 2);
+                    }
+                    else
+                    {
+                        int PtableIndex = (Predict > 0 ? Predict : -Predict) >> 3;
+                        acdata_Decode(&AC, &Residual, lPtables[ChNr][PtableIndex < (1 << 6) ? PtableIndex : (1 << 6) - 1]);
+                    }
+
+                    BitVal = ((((uint16_t)Predict) >> 15) ^ Residual) & 1;
+                    lDsdFrame[(BitNr >> 3) * nChannels + ChNr] |= (uint8_t)(BitVal << (7 - (BitNr & 7)));
+                    LT_Status[ChNr][1] = (LT_Status[ChNr][1] << 1) | (LT_Status[ChNr][0] >> 63);
+                    LT_Status[ChNr][0] = (LT_Status[ChNr][0] << 1) | (uint64_t)BitVal;
+                }
             }
         }
 
-        acdata_Flush(&AC, &ACError, 0, pDecoderBase->lADataByte, pDecoderBase->nADataLen);
+        acdata_Flush(&AC, &ACError, 0);
 
         if (ACError != 1)
         {
@@ -283,7 +409,7 @@ int decoderbase_Unpack(DecoderBase *pDecoderBase, uint8_t* lDstFrame, uint8_t* l
 {
     int Dummy;
     int Ready = 0;
-    strdata_FillBuffer(&pDecoderBase->cStrData, lDstFrame, pDecoderBase->cFrameHeader.nCalcBytes);
+    strdata_SetBuffer(&pDecoderBase->cStrData, lDstFrame, pDecoderBase->cFrameHeader.nCalcBytes);
     strdata_GetIntUnsigned(&pDecoderBase->cStrData, 1, &pDecoderBase->cFrameHeader.nDstCoded);
 
     if (pDecoderBase->cFrameHeader.nDstCoded == 0)
@@ -306,10 +432,11 @@ int decoderbase_Unpack(DecoderBase *pDecoderBase, uint8_t* lDstFrame, uint8_t* l
         framereader_ReadMappingData(&pDecoderBase->cStrData, &pDecoderBase->cFrameHeader);
         framereader_ReadFilterCoefSets(&pDecoderBase->cStrData, pDecoderBase->cFrameHeader.nChannels, &pDecoderBase->cFrameHeader, &pDecoderBase->cCodedTableF);
         framereader_ReadProbabilityTables(&pDecoderBase->cStrData, &pDecoderBase->cFrameHeader, &pDecoderBase->cCodedTableP, pDecoderBase->lPOne);
-        pDecoderBase->nADataLen = pDecoderBase->cFrameHeader.nCalcBits - strdata_GetInBitCount(&pDecoderBase->cStrData);
-        framereader_ReadArithmeticCodedData(&pDecoderBase->cStrData, pDecoderBase->nADataLen, pDecoderBase->lADataByte);
+        // The arithmetic coded data takes the rest of the frame and is decoded from there
+        pDecoderBase->nADataStart = strdata_GetInBitCount(&pDecoderBase->cStrData);
+        pDecoderBase->nADataLen = pDecoderBase->cFrameHeader.nCalcBits - pDecoderBase->nADataStart;
 
-        if (pDecoderBase->nADataLen > 0 && GET_BIT(pDecoderBase->lADataByte, 0) != 0)
+        if (pDecoderBase->nADataLen > 0 && GET_BIT(lDstFrame, pDecoderBase->nADataStart) != 0)
         {
             printf("PANIC: Illegal arithmetic code in frame %d!", pDecoderBase->cFrameHeader.nFrame);
             return -1;
@@ -69,20 +69,42 @@
 
 #include "framereader.h"
 
+/*
+    The prediction lookup tables of one coefficient set. nUsed is the last frame that used them, 0 while the entry is
+    empty.
+*/
+typedef struct
+{
+    uint32_t nHash;
+    int nPredOrder;
+    int16_t lICoefA[1 << 7];
+    int nUsed;
+    int16_t lTable[16][256];
+
+} CoefTable;
+
 typedef struct
 {
     FrameHeader cFrameHeader;
     CodedTableF cCodedTableF;
     CodedTableP cCodedTableP;
     int lPOne[12][1 << 6];
-    uint8_t lADataByte[112896];
+    int nADataStart;
     int nADataLen;
     StrData cStrData;
+    CoefTable *lCoefCache;
+    int nCoefCache;
+    uint64_t nCoefHits;
+    uint64_t nCoefLookups;
 
 } DecoderBase;
 
+void decoderbase_New(DecoderBase *pDecoderBase);
+void decoderbase_Free(DecoderBase *pDecoderBase);
 int decoderbase_Init(DecoderBase *pDecoderBase, int nChannels, int nFs44);
 int decoderbase_Decode(DecoderBase *pDecoderBase, uint8_t *lDstFrame, int nFrameSize, uint8_t *lDsdFrame);
 int decoderbase_Unpack(DecoderBase *pDecoderBase, uint8_t *lDstFrame, uint8_t *lDsdFrame);
+void decoderbase_BuildCoefTable(const int16_t *lICoefA, int FilterLength, int16_t Table[16][256]);
+int16_t decoderbase_Reverse7LSBs(int16_t c);
 
 #endif
@@ -80,19 +80,10 @@ int framereader_RiceDecode(StrData *pStrData, int m)
 {
     int LSBs;
     int Nr;
-    int RLBit;
     int RunLength;
     int Sign;
 
-    RunLength = 0;
-
-    do
-    {
-        strdata_GetIntUnsigned(pStrData, 1, &RLBit);
-        RunLength += (1 - RLBit);
-
-    } while (!RLBit);
-
+    RunLength = strdata_GetUnary(pStrData);
     strdata_GetIntUnsigned(pStrData, m, &LSBs);
     Nr = (RunLength << m) + LSBs;
 
@@ -111,12 +102,7 @@ int framereader_RiceDecode(StrData *pStrData, int m)
 
 void framereader_ReadDsdFrame(StrData *pStrData, long nMaxFrameLen, int nChannels, uint8_t* lDsdFrame)
 {
-    int ByteMax = nMaxFrameLen * nChannels;
-
-    for (int ByteNr = 0; ByteNr < ByteMax; ByteNr++)
-    {
-        strdata_GetChrUnsigned(pStrData, 8, &lDsdFrame[ByteNr]);
-    }
+    strdata_GetBytes(pStrData, nMaxFrameLen * nChannels, lDsdFrame);
 }
 
 void framereader_ReadTableSegmentData(StrData *pStrData, int nChannels, int FrameLen, int MaxNrOfSegs, int MinSegLen, Segment *S, int *SameSegAllCh)
@@ -597,33 +583,11 @@ void framereader_ReadProbabilityTables(StrData *pStrData, FrameHeader *pFrameHea
             lPOne[PtableNr][0] = 128;
             pCodedTableP->lBestMethod[PtableNr] = -1;
         }
-    }
-}
-
-void framereader_ReadArithmeticCodedData(StrData *pStrData, int nADataLen, uint8_t* lADataByte)
-{
-    for (int j = 0; j < (nADataLen >> 3); j++)
-    {
-        uint8_t v;
-
-        strdata_GetChrUnsigned(pStrData, 8, &v);
-        lADataByte[j] = v;
-    }
-
-    uint8_t Val = 0;
-
-    for (int j = nADataLen & ~7; j < nADataLen; j++)
-    {
-        uint8_t v;
-
-        strdata_GetChrUnsigned(pStrData, 1, &v);
-
-        Val |= v << (7 - (j & 7));
 
-        if (j == nADataLen - 1)
+        // Repeat the last entry so that the decoder can clamp the table index to a constant
+        for (int EntryNr = pFrameHeader->lPTableLengths[PtableNr]; EntryNr < (1 << 6); EntryNr++)
         {
-            lADataByte[j >> 3] = Val;
-            Val = 0;
+            lPOne[PtableNr][EntryNr] = lPOne[PtableNr][pFrameHeader->lPTableLengths[PtableNr] - 1];
         }
     }
 }
@@ -94,9 +94,7 @@ typedef struct
     int lHalfProbs[6];
     int lHalfBits[6];
     Segment cSegmentF;
-    uint8_t lFilter4Bit[6][75264];
     Segment cSegmentP;
-    uint8_t lPTable4Bit[6][75264];
     int nPSameSegAsF;
     int nPSameMapAsF;
     int nFSameSegAllCh;
@@ -124,6 +122,5 @@ void framereader_CopyMappingData(FrameHeader *pFrameHeader);
 void framereader_ReadMappingData(StrData *pStrData, FrameHeader *pFrameHeader);
 void framereader_ReadFilterCoefSets(StrData *pStrData, int nChannels, FrameHeader *pFrameHeader, CodedTableF *pCodedTableF);
 void framereader_ReadProbabilityTables(StrData *pStrData, FrameHeader *pFrameHeader, CodedTableP *pCodedTableP, int lPOne[12][1 << 6]);
-void framereader_ReadArithmeticCodedData(StrData *pStrData, int nADataLen, uint8_t *lADataByte);
 
 #endif
@@ -66,114 +66,78 @@
 #include "strdata.h"
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#define STRDATA_REFILL 56
 
-static int strdata_GetBits(StrData *pStrData, long *outword, int out_bitptr)
+/*
+    Tops the cache up to more than STRDATA_REFILL bits in whole bytes, eight at a time while they are all inside the
+    frame. Bytes past the end of the frame are read as zeros.
+*/
+static void strdata_Refill(StrData *pStrData)
 {
-    const int masks[] = { 0, 1, 3, 7, 0xf, 0x1f, 0x3f, 0x7f, 0xff };
-
-    if (out_bitptr == 1)
+    if (pStrData->nByteCounter + 8 <= pStrData->nTotalBytes)
     {
-        if (pStrData->nBitPosition == 0)
-        {
-            pStrData->nDataByte = pStrData->lDstdata[pStrData->nByteCounter++];
+        const uint8_t *pData = pStrData->pData + pStrData->nByteCounter;
+        uint64_t nBytes = ((uint64_t)pData[0] << 56) | ((uint64_t)pData[1] << 48) | ((uint64_t)pData[2] << 40) | ((uint64_t)pData[3] << 32)
+                        | ((uint64_t)pData[4] << 24) | ((uint64_t)pData[5] << 16) | ((uint64_t)pData[6] << 8) | (uint64_t)pData[7];
+        int nFill = (64 - pStrData->nCacheBits) >> 3;
 
-            if (pStrData->nByteCounter > pStrData->nTotalBytes)
-            {
-                return -1;
-            }
+        // The shift also brings in the top bits of byte nByteCounter + nFill; they sit where the next refill puts that byte
+        pStrData->nCache |= nBytes >> pStrData->nCacheBits;
+        pStrData->nCacheBits += nFill * 8;
+        pStrData->nByteCounter += nFill;
 
-            pStrData->nBitPosition = 8;
-        }
-
-        pStrData->nBitPosition--;
-        *outword = (pStrData->nDataByte >> pStrData->nBitPosition) & 1;
-
-        return 0;
+        return;
     }
 
-    *outword = 0;
-
-    while (out_bitptr > 0)
+    while (pStrData->nCacheBits <= STRDATA_REFILL)
     {
-        int thisbits, mask, shift;
+        uint64_t nByte = pStrData->nByteCounter < pStrData->nTotalBytes ? pStrData->pData[pStrData->nByteCounter] : 0;
 
-        if (!pStrData->nBitPosition)
-        {
-            pStrData->nDataByte = pStrData->lDstdata[pStrData->nByteCounter++];
-
-            if (pStrData->nByteCounter > pStrData->nTotalBytes)
-            {
-                return -1;
-            }
-
-            pStrData->nBitPosition = 8;
-        }
+        pStrData->nCache |= nByte << (STRDATA_REFILL - pStrData->nCacheBits);
+        pStrData->nCacheBits += 8;
+        pStrData->nByteCounter++;
+    }
+}
 
-        thisbits = MIN(pStrData->nBitPosition, out_bitptr);
-        shift = (pStrData->nBitPosition - thisbits);
-        mask = masks[thisbits] << shift;
-        shift = (out_bitptr - thisbits) - shift;
+static uint32_t strdata_GetBits(StrData *pStrData, int nLength)
+{
+    if (pStrData->nCacheBits < nLength)
+    {
+        strdata_Refill(pStrData);
+    }
 
-        if (shift <= 0)
-        {
-            *outword |= ((pStrData->nDataByte & mask) >> -shift);
-        }
-        else
-        {
-            *outword |= ((pStrData->nDataByte & mask) << shift);
-        }
+    uint32_t nBits = (uint32_t)(pStrData->nCache >> (64 - nLength));
 
-        out_bitptr -= thisbits;
-        pStrData->nBitPosition -= thisbits;
-    }
+    pStrData->nCache <<= nLength;
+    pStrData->nCacheBits -= nLength;
 
-    return 0;
+    return nBits;
 }
 
-void strdata_GetDstDataPointer(StrData *pStrData, uint8_t** pBuffer)
+void strdata_GetDstDataPointer(StrData *pStrData, const uint8_t** pBuffer)
 {
-    *pBuffer = pStrData->lDstdata;
+    *pBuffer = pStrData->pData;
 }
 
 void strdata_ResetReadingIndex(StrData *pStrData)
 {
-    pStrData->nBitPosition = 0;
     pStrData->nByteCounter = 0;
-    pStrData->nDataByte = 0;
-}
-
-void strdata_CreateBuffer(StrData *pStrData, int nSize)
-{
-    if (nSize > (int)sizeof(pStrData->lDstdata))
-    {
-        pStrData->nTotalBytes = sizeof(pStrData->lDstdata);
-    }
-    else
-    {
-        pStrData->nTotalBytes = nSize;
-    }
-}
-
-void strdata_DeleteBuffer(StrData *pStrData)
-{
-    pStrData->nTotalBytes = 0;
-    strdata_ResetReadingIndex(pStrData);
+    pStrData->nCache = 0;
+    pStrData->nCacheBits = 0;
 }
 
-void strdata_FillBuffer(StrData *pStrData, uint8_t* lBuf, int nSize)
+void strdata_SetBuffer(StrData *pStrData, const uint8_t* lBuf, int nSize)
 {
-    strdata_CreateBuffer(pStrData, nSize);
-    memcpy(pStrData->lDstdata, lBuf, pStrData->nTotalBytes);
+    pStrData->pData = lBuf;
+    pStrData->nTotalBytes = nSize;
     strdata_ResetReadingIndex(pStrData);
 }
 
 void strdata_GetChrUnsigned(StrData *pStrData, int nLength, uint8_t *pChr)
 {
-    long tmp = 0;
-
     if (nLength > 0)
     {
-        strdata_GetBits(pStrData, &tmp, nLength);
+        uint32_t tmp = strdata_GetBits(pStrData, nLength);
 
         *pChr = (unsigned char)tmp;
     }
@@ -189,11 +153,9 @@ void strdata_GetChrUnsigned(StrData *pStrData, int nLength, uint8_t *pChr)
 
 void strdata_GetIntUnsigned(StrData *pStrData, int nLength, int *pChr)
 {
-    long tmp = 0;
-
     if (nLength > 0)
     {
-        strdata_GetBits(pStrData, &tmp, nLength);
+        uint32_t tmp = strdata_GetBits(pStrData, nLength);
 
         *pChr = (int)tmp;
     }
@@ -209,11 +171,9 @@ void strdata_GetIntUnsigned(StrData *pStrData, int nLength, int *pChr)
 
 void strdata_GetIntSigned(StrData *pStrData, int nLength, int *pNum)
 {
-    long tmp = 0;
-
     if (nLength > 0)
     {
-        strdata_GetBits(pStrData, &tmp, nLength);
+        uint32_t tmp = strdata_GetBits(pStrData, nLength);
 
         *pNum = (int)tmp;
 
@@ -234,11 +194,9 @@ void strdata_GetIntSigned(StrData *pStrData, int nLength, int *pNum)
 
 void strdata_GetShortSigned(StrData *pStrData, int nLength, short *pNum)
 {
-    long tmp = 0;
-
     if (nLength > 0)
     {
-        strdata_GetBits(pStrData, &tmp, nLength);
+        uint32_t tmp = strdata_GetBits(pStrData, nLength);
 
         *pNum = (short)tmp;
 
@@ -257,7 +215,67 @@ void strdata_GetShortSigned(StrData *pStrData, int nLength, short *pNum)
     }
 }
 
+/*
+    Counts the zero bits up to the next one bit and skips past them and the one, a cache at a time. A run that reaches the
+    end of the frame stops there.
+*/
+int strdata_GetUnary(StrData *pStrData)
+{
+    int nRun = 0;
+
+    while (1)
+    {
+        int nZeros = pStrData->nCache ? __builtin_clzll(pStrData->nCache) : 64;
+
+        if (nZeros < pStrData->nCacheBits)
+        {
+            pStrData->nCache = (pStrData->nCache << nZeros) << 1;
+            pStrData->nCacheBits -= nZeros + 1;
+
+            return nRun + nZeros;
+        }
+
+        nRun += pStrData->nCacheBits;
+        pStrData->nCache = 0;
+        pStrData->nCacheBits = 0;
+
+        if (pStrData->nByteCounter >= pStrData->nTotalBytes)
+        {
+            return nRun;
+        }
+
+        strdata_Refill(pStrData);
+    }
+}
+
+/*
+    Reads nLength whole bytes, copying them straight from the frame when the read position is on a byte boundary.
+*/
+void strdata_GetBytes(StrData *pStrData, int nLength, uint8_t *lBuf)
+{
+    int nBit = strdata_GetInBitCount(pStrData);
+
+    if ((nBit & 7) == 0)
+    {
+        int nByte = nBit >> 3;
+        int nCopy = nByte < pStrData->nTotalBytes ? MIN(nLength, pStrData->nTotalBytes - nByte) : 0;
+
+        memcpy(lBuf, pStrData->pData + nByte, nCopy);
+        memset(lBuf + nCopy, 0, nLength - nCopy);
+        pStrData->nByteCounter = nByte + nLength;
+        pStrData->nCache = 0;
+        pStrData->nCacheBits = 0;
+
+        return;
+    }
+
+    for (int i = 0; i < nLength; i++)
+    {
+        lBuf[i] = (uint8_t)strdata_GetBits(pStrData, 8);
+    }
+}
+
 int strdata_GetInBitCount(StrData *pStrData)
 {
-    return pStrData->nByteCounter * 8 - pStrData->nBitPosition;
+    return pStrData->nByteCounter * 8 - pStrData->nCacheBits;
 }
@@ -68,25 +68,29 @@
 #include <stdio.h>
 #include <stdint.h>
 
+/*
+    Reads the frame in place. The bits following the read position are kept MSB first in nCache, which holds
+    nCacheBits of them; nByteCounter is the next byte to load into it. Past the end of the frame zeros are read.
+*/
 typedef struct
 {
-    uint8_t lDstdata[112896];
+    const uint8_t *pData;
     int nTotalBytes;
     int nByteCounter;
-    int nBitPosition;
-    uint8_t nDataByte;
+    uint64_t nCache;
+    int nCacheBits;
 
 } StrData;
 
-void strdata_GetDstDataPointer(StrData *pStrData, uint8_t **pBuffer);
+void strdata_GetDstDataPointer(StrData *pStrData, const uint8_t **pBuffer);
 void strdata_ResetReadingIndex(StrData *pStrData);
-void strdata_CreateBuffer(StrData *pStrData, int nSize);
-void strdata_DeleteBuffer(StrData *pStrData);
-void strdata_FillBuffer(StrData *pStrData, uint8_t *lBuf, int nSize);
+void strdata_SetBuffer(StrData *pStrData, const uint8_t *lBuf, int nSize);
 void strdata_GetChrUnsigned(StrData *pStrData, int nLength, uint8_t *pChr);
 void strdata_GetIntUnsigned(StrData *pStrData, int nLength, int *pNum);
 void strdata_GetIntSigned(StrData *pStrData, int nLength, int *pNum);
 void strdata_GetShortSigned(StrData *pStrData, int nLength, short *pNum);
+int strdata_GetUnary(StrData *pStrData);
+void strdata_GetBytes(StrData *pStrData, int nLength, uint8_t *lBuf);
 int strdata_GetInBitCount(StrData *pStrData);
 
 #endif
@@ -0,0 +1,38 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "acencoder.h"
+
+/*
+    The coded data starts with a zero bit that the decoder skips; the interval never grows past it, so no carry reaches
+    it either.
+*/
+void acencoder_Init(ACEncoder *pACEncoder, StrWriter *pStrWriter)
+{
+    pACEncoder->nA = (1u << AC_ABITS) - 1;
+    pACEncoder->nLow = 0;
+    pACEncoder->pStrWriter = pStrWriter;
+    strwriter_PutBit(pStrWriter, 0);
+}
+
+void acencoder_Flush(ACEncoder *pACEncoder)
+{
+    strwriter_PutBits(pACEncoder->pStrWriter, AC_ABITS, pACEncoder->nLow);
+    pACEncoder->nLow = 0;
+}
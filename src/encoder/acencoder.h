@@ -0,0 +1,78 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef ACENCODER_H
+#define ACENCODER_H
+
+#include "strwriter.h"
+#include "../decoder/acdata.h"
+
+/*
+    The arithmetic encoder that acdata_Decode undoes. nLow holds the AC_ABITS bits of the interval's lower end that
+    have not been written yet, and nA its width. The code value the decoder reads is the lower end itself followed by
+    zeros, so finishing a frame is only a matter of writing out nLow.
+*/
+typedef struct
+{
+    unsigned int nA;
+    unsigned int nLow;
+    StrWriter *pStrWriter;
+
+} ACEncoder;
+
+void acencoder_Init(ACEncoder *pACEncoder, StrWriter *pStrWriter);
+void acencoder_Flush(ACEncoder *pACEncoder);
+
+/*
+    Encodes the bit b the way acdata_Decode will decode it with probability p. A zero takes the upper part of the
+    interval, so adding to nLow can carry into bits already written.
+*/
+static inline void acencoder_Encode(ACEncoder *pACEncoder, int b, int p)
+{
+    unsigned int nA = pACEncoder->nA;
+    unsigned int ap = ((nA >> AC_PBITS) | ((nA >> (AC_PBITS - 1)) & 1)) * p;
+    unsigned int h = nA - ap;
+
+    if (b)
+    {
+        nA = h;
+    }
+    else
+    {
+        pACEncoder->nLow += h;
+        nA = ap;
+
+        if (pACEncoder->nLow >= (1u << AC_ABITS))
+        {
+            strwriter_Carry(pACEncoder->pStrWriter);
+            pACEncoder->nLow -= 1u << AC_ABITS;
+        }
+    }
+
+    while (nA < (1u << (AC_ABITS - 1)))
+    {
+        strwriter_PutBit(pACEncoder->pStrWriter, (pACEncoder->nLow >> (AC_ABITS - 1)) & 1);
+        pACEncoder->nLow = (pACEncoder->nLow << 1) & ((1u << AC_ABITS) - 1);
+        nA <<= 1;
+    }
+
+    pACEncoder->nA = nA;
+}
+
+#endif
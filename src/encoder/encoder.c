@@ -0,0 +1,213 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "encoder.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+static bool encoder_TakeFrame(Encoder *pEncoder, unsigned int *pFrame)
+{
+    unsigned int nTaken = atomic_load(&pEncoder->nTaken);
+
+    do
+    {
+        if (nTaken == atomic_load(&pEncoder->nQueued))
+        {
+            return false;
+        }
+    }
+    while (!atomic_compare_exchange_weak(&pEncoder->nTaken, &nTaken, nTaken + 1));
+
+    *pFrame = nTaken;
+
+    return true;
+}
+
+static void encoder_OnWork(void *pData)
+{
+    EncoderWorker *pWorker = (EncoderWorker*)pData;
+    Encoder *pEncoder = pWorker->pEncoder;
+    unsigned int nFrame;
+
+    while (encoder_TakeFrame(pEncoder, &nFrame))
+    {
+        EncoderFrame *pFrame = &pEncoder->lFrames[nFrame % pEncoder->nDepth];
+
+        pFrame->nDstSize = encoderbase_Encode(&pWorker->cEncoderBase, pFrame->lDsdData, pFrame->lDstData);
+        pool_GroupRelease(&pFrame->cGroup);
+    }
+}
+
+Encoder* encoder_New(int nWorkers, int nDepth)
+{
+    Encoder *pEncoder = malloc(sizeof(Encoder));
+    pEncoder->nWorkers = nWorkers;
+    pEncoder->nDepth = nDepth > 0 ? nDepth : 2 * nWorkers;
+    pEncoder->lWorkers = malloc(nWorkers * sizeof(EncoderWorker));
+    pEncoder->lFrames = calloc(pEncoder->nDepth, sizeof(EncoderFrame));
+
+    if (!pEncoder->lWorkers || !pEncoder->lFrames)
+    {
+        pEncoder->nWorkers = 0;
+        pEncoder->nDepth = 0;
+    }
+
+    for (int i = 0; i < pEncoder->nWorkers; i++)
+    {
+        pool_StageInit(&pEncoder->lWorkers[i].cStage, encoder_OnWork, &pEncoder->lWorkers[i]);
+        pEncoder->lWorkers[i].pEncoder = pEncoder;
+        encoderbase_New(&pEncoder->lWorkers[i].cEncoderBase);
+    }
+
+    for (int i = 0; i < pEncoder->nDepth; i++)
+    {
+        pool_GroupInit(&pEncoder->lFrames[i].cGroup);
+    }
+
+    atomic_init(&pEncoder->nQueued, 0);
+    atomic_init(&pEncoder->nTaken, 0);
+    pEncoder->nReleased = 0;
+    pEncoder->nChannels = 0;
+    pEncoder->nDsdSize = 0;
+
+    return pEncoder;
+}
+
+static void encoder_Wait(Encoder *pEncoder)
+{
+    for (int i = 0; i < pEncoder->nDepth; i++)
+    {
+        pool_Wait(&pEncoder->lFrames[i].cGroup);
+    }
+
+    for (int i = 0; i < pEncoder->nWorkers; i++)
+    {
+        pool_StageWait(&pEncoder->lWorkers[i].cStage);
+    }
+}
+
+void encoder_Free(Encoder *pEncoder)
+{
+    encoder_Wait(pEncoder);
+
+    for (int i = 0; i < pEncoder->nDepth; i++)
+    {
+        free(pEncoder->lFrames[i].lDsdData);
+        free(pEncoder->lFrames[i].lDstData);
+    }
+
+    for (int i = 0; i < pEncoder->nWorkers; i++)
+    {
+        encoderbase_Free(&pEncoder->lWorkers[i].cEncoderBase);
+    }
+
+    free(pEncoder->lFrames);
+    free(pEncoder->lWorkers);
+    free(pEncoder);
+}
+
+/*
+    nEffort goes from 0, the fastest, to 2, the smallest output.
+*/
+int encoder_Init(Encoder *pEncoder, int nChannels, int nSampleRate, int nFrameRate, int nEffort)
+{
+    encoder_Wait(pEncoder);
+
+    if (pEncoder->nWorkers == 0)
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < pEncoder->nWorkers; i++)
+    {
+        if (encoderbase_Init(&pEncoder->lWorkers[i].cEncoderBase, nChannels, (nSampleRate / 44100) / (nFrameRate / 75), nEffort) != 0)
+        {
+            return -1;
+        }
+    }
+
+    pEncoder->nChannels = nChannels;
+    pEncoder->nDsdSize = nSampleRate / 8 / nFrameRate * nChannels;
+
+    // A DST frame that would not be smaller than the DSD frame is stored uncoded behind a one byte header
+    for (int i = 0; i < pEncoder->nDepth; i++)
+    {
+        pEncoder->lFrames[i].lDsdData = realloc(pEncoder->lFrames[i].lDsdData, pEncoder->nDsdSize);
+        pEncoder->lFrames[i].lDstData = realloc(pEncoder->lFrames[i].lDstData, pEncoder->nDsdSize + 1);
+
+        if (!pEncoder->lFrames[i].lDsdData || !pEncoder->lFrames[i].lDstData)
+        {
+            return -1;
+        }
+    }
+
+    atomic_store(&pEncoder->nQueued, 0);
+    atomic_store(&pEncoder->nTaken, 0);
+    pEncoder->nReleased = 0;
+
+    return 0;
+}
+
+/*
+    Queues a DSD frame, or with nDsdSize 0 only drains the queue, and hands back the oldest encoded frame once nDepth
+    frames are in flight or while draining. A short last frame is filled up with DSD silence. The DST data stays
+    valid until the next call.
+*/
+void encoder_Encode(Encoder *pEncoder, const uint8_t *lDsdData, size_t nDsdSize, uint8_t **pDstData, size_t *pDstSize)
+{
+    unsigned int nQueued = atomic_load(&pEncoder->nQueued);
+
+    *pDstData = NULL;
+    *pDstSize = 0;
+
+    if (nDsdSize > 0)
+    {
+        EncoderFrame *pFrame = &pEncoder->lFrames[nQueued % pEncoder->nDepth];
+        int nSize = MIN((int)nDsdSize, pEncoder->nDsdSize);
+
+        memcpy(pFrame->lDsdData, lDsdData, nSize);
+        memset(pFrame->lDsdData + nSize, 0x69, pEncoder->nDsdSize - nSize);
+        pool_GroupAdd(&pFrame->cGroup);
+        atomic_store(&pEncoder->nQueued, ++nQueued);
+
+        for (int i = 0; i < pEncoder->nWorkers; i++)
+        {
+            pool_StageKick(&pEncoder->lWorkers[i].cStage);
+        }
+
+        if (nQueued - pEncoder->nReleased < (unsigned int)pEncoder->nDepth)
+        {
+            return;
+        }
+    }
+
+    if (pEncoder->nReleased == nQueued)
+    {
+        return;
+    }
+
+    EncoderFrame *pFrame = &pEncoder->lFrames[pEncoder->nReleased % pEncoder->nDepth];
+
+    pool_Wait(&pFrame->cGroup);
+    pEncoder->nReleased++;
+    *pDstData = pFrame->lDstData;
+    *pDstSize = (size_t)pFrame->nDstSize;
+}
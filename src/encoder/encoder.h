@@ -0,0 +1,77 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include "encoderbase.h"
+#include "../worker/pool.h"
+#include <stddef.h>
+
+/*
+    A frame in flight. Frame n of the stream lives in entry n % nDepth from the time it is queued until the caller has
+    had its DST data back. cGroup is pending while the frame is waiting to be encoded or being encoded.
+*/
+typedef struct
+{
+    PoolGroup cGroup;
+    uint8_t *lDsdData;
+    uint8_t *lDstData;
+    int nDstSize;
+
+} EncoderFrame;
+
+struct Encoder;
+
+/*
+    A worker is a stage that takes queued frames in order until there are none left. Each worker owns an EncoderBase,
+    so any worker can encode any frame.
+*/
+typedef struct
+{
+    PoolStage cStage;
+    struct Encoder *pEncoder;
+    EncoderBase cEncoderBase;
+
+} EncoderWorker;
+
+/*
+    The queue works as the decoder's does: the workers encode up to nDepth frames at once and the caller gets the
+    DST frames back in stream order.
+*/
+typedef struct Encoder
+{
+    EncoderWorker *lWorkers;
+    int nWorkers;
+    EncoderFrame *lFrames;
+    int nDepth;
+    atomic_uint nQueued;
+    atomic_uint nTaken;
+    unsigned int nReleased;
+    int nChannels;
+    int nDsdSize;
+
+} Encoder;
+
+Encoder* encoder_New(int nWorkers, int nDepth);
+void encoder_Free(Encoder *pEncoder);
+int encoder_Init(Encoder *pEncoder, int nChannels, int nSampleRate, int nFrameRate, int nEffort);
+void encoder_Encode(Encoder *pEncoder, const uint8_t *lDsdData, size_t nDsdSize, uint8_t **pDstData, size_t *pDstSize);
+
+#endif
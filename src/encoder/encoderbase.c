@@ -0,0 +1,595 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "encoderbase.h"
+#include "acencoder.h"
+#include "framewriter.h"
+#include "../decoder/decoderbase.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define ENCODER_MAX_ORDER (1 << 7)
+#define ENCODER_STATUS 0xaaaaaaaaaaaaaaaaULL
+
+/*
+    What each effort level tries for every segment of every channel: the filter orders, how many coefficient scales
+    from the largest one that keeps all coefficients in range down in halves, and the most segments per channel.
+*/
+typedef struct
+{
+    int nOrders;
+    int lOrders[3];
+    int nScales;
+    int nSegments;
+
+} EncoderEffort;
+
+static const EncoderEffort m_lEfforts[3] =
+{
+    {1, {64}, 1, 1},
+    {2, {64, 128}, 2, 1},
+    {3, {64, 96, 128}, 3, 2}
+};
+
+void encoderbase_New(EncoderBase *pEncoderBase)
+{
+    pEncoderBase->lChannel = NULL;
+    pEncoderBase->lChannelBits = NULL;
+    pEncoderBase->lTables = NULL;
+}
+
+void encoderbase_Free(EncoderBase *pEncoderBase)
+{
+    free(pEncoderBase->lChannel);
+    free(pEncoderBase->lChannelBits);
+    free(pEncoderBase->lTables);
+    encoderbase_New(pEncoderBase);
+}
+
+int encoderbase_Init(EncoderBase *pEncoderBase, int nChannels, int nFs44, int nEffort)
+{
+    encoderbase_Free(pEncoderBase);
+
+    for (int i = 0; i < 2; i++)
+    {
+        FrameHeader *pFrameHeader = &pEncoderBase->lPlans[i].cFrameHeader;
+        pFrameHeader->nChannels = nChannels;
+        pFrameHeader->nMaxFrameLen = (588 * nFs44 / 8);
+        pFrameHeader->nByteStreamLen = pFrameHeader->nMaxFrameLen * pFrameHeader->nChannels;
+        pFrameHeader->nBitStreamLen = pFrameHeader->nByteStreamLen * 8;
+        pFrameHeader->nBitsPerCh = pFrameHeader->nMaxFrameLen * 8;
+        pFrameHeader->nMaxFilters = 2 * pFrameHeader->nChannels;
+        pFrameHeader->nMaxPTables = 2 * pFrameHeader->nChannels;
+        pFrameHeader->nFrame = 0;
+    }
+
+    pEncoderBase->nEffort = MAX(0, MIN(nEffort, 2));
+    pEncoderBase->nDsdSize = pEncoderBase->lPlans[0].cFrameHeader.nByteStreamLen;
+    codedtablef_New(&pEncoderBase->cCodedTableF);
+    codedtablep_New(&pEncoderBase->cCodedTableP);
+
+    for (int p = 1; p <= (1 << 7); p++)
+    {
+        pEncoderBase->lBits[0][p] = -log2(p / 256.0);
+        pEncoderBase->lBits[1][p] = -log2(1.0 - p / 256.0);
+    }
+
+    // One channel of the frame as bytes, then as 64-bit words with one more word of zeros to read past the end
+    pEncoderBase->lChannel = malloc(pEncoderBase->lPlans[0].cFrameHeader.nMaxFrameLen);
+    pEncoderBase->lChannelBits = calloc(pEncoderBase->lPlans[0].cFrameHeader.nMaxFrameLen / 8 + 2, sizeof(uint64_t));
+    pEncoderBase->lTables = malloc(pEncoderBase->lPlans[0].cFrameHeader.nMaxFilters * sizeof(*pEncoderBase->lTables));
+
+    if (!pEncoderBase->lChannel || !pEncoderBase->lChannelBits || !pEncoderBase->lTables)
+    {
+        encoderbase_Free(pEncoderBase);
+
+        return -1;
+    }
+
+    return 0;
+}
+
+static inline int encoderbase_GetBit(const uint8_t *lChannel, int BitNr)
+{
+    return (lChannel[BitNr >> 3] >> (7 - (BitNr & 7))) & 1;
+}
+
+static inline void encoderbase_ShiftStatus(uint64_t Status[2], int BitVal)
+{
+    Status[1] = (Status[1] << 1) | (Status[0] >> 63);
+    Status[0] = (Status[0] << 1) | (uint64_t)BitVal;
+}
+
+/*
+    The decoder's prediction, summing only the nTables tables a filter of this order fills in; the others are all zero.
+*/
+static inline int16_t encoderbase_RunFilter(const int16_t FilterTable[16][256], int nTables, const uint64_t Status[2])
+{
+    int Predict = 0;
+
+    for (int TableNr = 0; TableNr < nTables; TableNr++)
+    {
+        Predict += FilterTable[TableNr][(Status[TableNr >> 3] >> ((TableNr & 7) * 8)) & 0xff];
+    }
+
+    return (int16_t)Predict;
+}
+
+static inline int encoderbase_GetPtableIndex(int16_t Predict)
+{
+    int PtableIndex = (Predict > 0 ? Predict : -Predict) >> 3;
+
+    return PtableIndex < (1 << 6) ? PtableIndex : (1 << 6) - 1;
+}
+
+static uint64_t encoderbase_GetWord(const uint64_t *lChannelBits, int BitNr)
+{
+    int nShift = BitNr & 63;
+    uint64_t nWord = lChannelBits[BitNr >> 6] << nShift;
+
+    return nShift ? nWord | (lChannelBits[(BitNr >> 6) + 1] >> (64 - nShift)) : nWord;
+}
+
+/*
+    Takes channel ChNr out of the interleaved frame, as bytes for running filters and as words for correlating.
+*/
+static void encoderbase_LoadChannel(EncoderBase *pEncoderBase, const uint8_t *lDsdFrame, int ChNr)
+{
+    int nChannels = pEncoderBase->lPlans[0].cFrameHeader.nChannels;
+    int nMaxFrameLen = pEncoderBase->lPlans[0].cFrameHeader.nMaxFrameLen;
+
+    for (int i = 0; i < nMaxFrameLen; i++)
+    {
+        pEncoderBase->lChannel[i] = lDsdFrame[i * nChannels + ChNr];
+    }
+
+    memset(pEncoderBase->lChannelBits, 0, (nMaxFrameLen / 8 + 2) * sizeof(uint64_t));
+
+    for (int i = 0; i < nMaxFrameLen; i++)
+    {
+        pEncoderBase->lChannelBits[i >> 3] |= (uint64_t)pEncoderBase->lChannel[i] << (56 - 8 * (i & 7));
+    }
+}
+
+/*
+    The autocorrelation of bits nStart to nEnd of the channel as +1 and -1, for lags up to nOrder. Two bits multiply to
+    -1 where they differ, so each lag is the pair count less twice the popcount of the stream xor its shifted self.
+*/
+static void encoderbase_Correlate(EncoderBase *pEncoderBase, int nStart, int nEnd, int nOrder, double *lR)
+{
+    for (int k = 0; k <= nOrder; k++)
+    {
+        int nFirst = MAX(nStart, k);
+        int nDiffer = 0;
+
+        for (int BitNr = nFirst; BitNr < nEnd; BitNr += 64)
+        {
+            uint64_t nWord = encoderbase_GetWord(pEncoderBase->lChannelBits, BitNr) ^ encoderbase_GetWord(pEncoderBase->lChannelBits, BitNr - k);
+
+            if (nEnd - BitNr < 64)
+            {
+                nWord &= ~0ULL << (64 - (nEnd - BitNr));
+            }
+
+            nDiffer += __builtin_popcountll(nWord);
+        }
+
+        lR[k] = (double)(nEnd - nFirst) - 2.0 * nDiffer;
+    }
+}
+
+/*
+    Levinson-Durbin recursion. The predictor of each order is a step on the way to the next, so lPredictors[i] gets
+    the one of order lOrders[i] for all the orders asked for in one pass.
+*/
+static void encoderbase_SolvePredictors(const double *lR, const int *lOrders, int nOrders, double lPredictors[3][ENCODER_MAX_ORDER + 1])
+{
+    double a[ENCODER_MAX_ORDER + 1] = {0};
+    double Prev[ENCODER_MAX_ORDER + 1];
+    double Error = lR[0] * 1.0001 + 1.0;
+    int nOrder = lOrders[nOrders - 1];
+
+    for (int i = 1; i <= nOrder; i++)
+    {
+        double Acc = lR[i];
+
+        for (int j = 1; j < i; j++)
+        {
+            Acc -= a[j] * lR[i - j];
+        }
+
+        double k = Acc / Error;
+        memcpy(Prev, a, sizeof(a));
+        a[i] = k;
+
+        for (int j = 1; j < i; j++)
+        {
+            a[j] = Prev[j] - k * Prev[i - j];
+        }
+
+        Error *= 1.0 - k * k;
+
+        for (int n = 0; n < nOrders; n++)
+        {
+            if (lOrders[n] == i)
+            {
+                memcpy(lPredictors[n], a, sizeof(a));
+            }
+        }
+    }
+}
+
+/*
+    Builds the probability table for residual counts by table index and returns the bits the residuals will take with
+    it. Entries no residual falls on repeat the one before, and the table is cut after its last change since the
+    decoder repeats the last entry. A table of one entry is always 128, so a table that ends up shorter has two.
+*/
+static double encoderbase_BuildPtable(EncoderBase *pEncoderBase, int lCounts[1 << 6][2], int *lPOne, int *pLength)
+{
+    double fBits = 0.0;
+    int nLength = 1;
+    int nPrev = 0;
+
+    for (int i = 0; i < (1 << 6); i++)
+    {
+        int n = lCounts[i][0] + lCounts[i][1];
+
+        if (n > 0)
+        {
+            nPrev = (int)lrint(256.0 * (lCounts[i][0] + 0.5) / (n + 1.0));
+            nPrev = MAX(1, MIN(nPrev, 1 << 7));
+
+            for (int j = 0; j < i && lPOne[j] == 0; j++)
+            {
+                lPOne[j] = nPrev;
+            }
+
+            fBits += lCounts[i][0] * pEncoderBase->lBits[0][nPrev] + lCounts[i][1] * pEncoderBase->lBits[1][nPrev];
+        }
+
+        lPOne[i] = nPrev;
+    }
+
+    if (lPOne[0] == 0)
+    {
+        for (int i = 0; i < (1 << 6); i++)
+        {
+            lPOne[i] = 1 << 7;
+        }
+    }
+
+    for (int i = 1; i < (1 << 6); i++)
+    {
+        if (lPOne[i] != lPOne[i - 1])
+        {
+            nLength = i + 1;
+        }
+    }
+
+    *pLength = nLength == 1 && lPOne[0] != (1 << 7) ? 2 : nLength;
+
+    return fBits;
+}
+
+static void encoderbase_CountResiduals(EncoderBase *pEncoderBase, int nStart, int nEnd, const int16_t FilterTable[16][256], int nTables, int nHalfBits, int lCounts[2][1 << 6][2])
+{
+    uint64_t Status[2] = {ENCODER_STATUS, ENCODER_STATUS};
+
+    memset(lCounts, 0, 2 * sizeof(lCounts[0]));
+
+    for (int BitNr = 0; BitNr < nStart; BitNr++)
+    {
+        encoderbase_ShiftStatus(Status, encoderbase_GetBit(pEncoderBase->lChannel, BitNr));
+    }
+
+    for (int BitNr = nStart; BitNr < nEnd; BitNr++)
+    {
+        int16_t Predict = encoderbase_RunFilter(FilterTable, nTables, Status);
+        int BitVal = encoderbase_GetBit(pEncoderBase->lChannel, BitNr);
+        int Residual = BitVal ^ (((uint16_t)Predict) >> 15);
+
+        lCounts[BitNr >= nHalfBits][encoderbase_GetPtableIndex(Predict)][Residual]++;
+        encoderbase_ShiftStatus(Status, BitVal);
+    }
+}
+
+static int encoderbase_GetTableBits(EncoderBase *pEncoderBase, const int *lValues, int nLength, int nBits, int bPtable)
+{
+    int Coded;
+    int BestMethod;
+    int lM[3];
+
+    if (bPtable)
+    {
+        return nLength > 1 ? 6 + 1 + framewriter_ChooseCoding(lValues, nLength, nBits, pEncoderBase->cCodedTableP.lPredOrder, pEncoderBase->cCodedTableP.lPredCoef, &Coded, &BestMethod, lM) : 6;
+    }
+
+    return 7 + 1 + framewriter_ChooseCoding(lValues, nLength, nBits, pEncoderBase->cCodedTableF.lPredOrder, pEncoderBase->cCodedTableF.lPredCoef, &Coded, &BestMethod, lM);
+}
+
+/*
+    Finds the filter and probability table for bits nStart to nEnd of the loaded channel that take the fewest bits,
+    coefficients and table included, among the orders and scales of the effort level. The first segment of a channel
+    may also code the bits before the filter has a full history at probability one half.
+*/
+static void encoderbase_DesignFilter(EncoderBase *pEncoderBase, EncoderPlan *pPlan, int ChNr, int FilterNr, int nStart, int nEnd)
+{
+    const EncoderEffort *pEffort = &m_lEfforts[pEncoderBase->nEffort];
+    FrameHeader *pFrameHeader = &pPlan->cFrameHeader;
+    int16_t (*FilterTable)[256] = pEncoderBase->lTables[FilterNr];
+    double lR[ENCODER_MAX_ORDER + 1];
+    double lPredictors[3][ENCODER_MAX_ORDER + 1];
+    double fBest = INFINITY;
+
+    encoderbase_Correlate(pEncoderBase, nStart, nEnd, pEffort->lOrders[pEffort->nOrders - 1], lR);
+    encoderbase_SolvePredictors(lR, pEffort->lOrders, pEffort->nOrders, lPredictors);
+
+    for (int n = 0; n < pEffort->nOrders; n++)
+    {
+        int nOrder = pEffort->lOrders[n];
+        double fMax = 0.0;
+
+        for (int i = 1; i <= nOrder; i++)
+        {
+            fMax = MAX(fMax, fabs(lPredictors[n][i]));
+        }
+
+        for (int nScale = 0; nScale < pEffort->nScales; nScale++)
+        {
+            double fScale = (fMax > 0.0 ? 255.0 / fMax : 1.0) / (1 << nScale);
+            int16_t lICoefA[ENCODER_MAX_ORDER];
+            int lValues[ENCODER_MAX_ORDER];
+            int lCounts[2][1 << 6][2];
+            int lPOne[2][1 << 6] = {{0}};
+            int lLengths[2];
+
+            for (int i = 0; i < nOrder; i++)
+            {
+                lValues[i] = (int)lrint(fScale * lPredictors[n][i + 1]);
+                lValues[i] = MAX(-(1 << 8), MIN(lValues[i], (1 << 8) - 1));
+                lICoefA[i] = (int16_t)lValues[i];
+            }
+
+            decoderbase_BuildCoefTable(lICoefA, nOrder, FilterTable);
+            encoderbase_CountResiduals(pEncoderBase, nStart, nEnd, (const int16_t (*)[256])FilterTable, (nOrder + 7) / 8, nStart == 0 ? nOrder : 0, lCounts);
+
+            // Half probabilities for the first bits, whose counts are then left out of the table, or the table for all
+            double fHalfBits = 0.0;
+
+            for (int i = 0; i < (1 << 6); i++)
+            {
+                fHalfBits += lCounts[0][i][0] + lCounts[0][i][1];
+            }
+
+            fHalfBits += encoderbase_BuildPtable(pEncoderBase, lCounts[1], lPOne[1], &lLengths[1]);
+
+            for (int i = 0; i < (1 << 6); i++)
+            {
+                lCounts[0][i][0] += lCounts[1][i][0];
+                lCounts[0][i][1] += lCounts[1][i][1];
+            }
+
+            double fFullBits = encoderbase_BuildPtable(pEncoderBase, lCounts[0], lPOne[0], &lLengths[0]);
+            int nHalf = fHalfBits < fFullBits;
+            double fBits = MIN(fHalfBits, fFullBits) + encoderbase_GetTableBits(pEncoderBase, lValues, nOrder, 9, 0) + encoderbase_GetTableBits(pEncoderBase, lPOne[nHalf], lLengths[nHalf], 7, 1);
+
+            if (fBits < fBest)
+            {
+                fBest = fBits;
+                pFrameHeader->lPredOrder[FilterNr] = nOrder;
+                memcpy(pFrameHeader->lICoefA[FilterNr], lICoefA, nOrder * sizeof(int16_t));
+                pFrameHeader->lPTableLengths[FilterNr] = lLengths[nHalf];
+                memcpy(pPlan->lPOne[FilterNr], lPOne[nHalf], sizeof(lPOne[nHalf]));
+
+                if (nStart == 0)
+                {
+                    pFrameHeader->lHalfProbs[ChNr] = nHalf;
+                }
+            }
+        }
+    }
+
+    pPlan->fBits += fBest;
+}
+
+/*
+    Plans a frame with every channel cut into nSegments equal segments, all channels the same, and a filter and
+    probability table of its own for every segment of every channel.
+*/
+static void encoderbase_Plan(EncoderBase *pEncoderBase, const uint8_t *lDsdFrame, int nSegments, EncoderPlan *pPlan)
+{
+    FrameHeader *pFrameHeader = &pPlan->cFrameHeader;
+    Segment *pSegment = &pFrameHeader->cSegmentF;
+    int nChannels = pFrameHeader->nChannels;
+
+    pSegment->nResolution = nSegments > 1 ? pFrameHeader->nMaxFrameLen / nSegments : 1;
+
+    for (int ChNr = 0; ChNr < nChannels; ChNr++)
+    {
+        pSegment->lSegments[ChNr] = nSegments;
+
+        for (int SegNr = 0; SegNr < nSegments; SegNr++)
+        {
+            pSegment->lLengths[ChNr][SegNr] = SegNr < nSegments - 1 ? 1 : 0;
+            pSegment->lTable[ChNr][SegNr] = ChNr * nSegments + SegNr;
+        }
+    }
+
+    pFrameHeader->cSegmentP = *pSegment;
+    pFrameHeader->nPSameSegAsF = 1;
+    pFrameHeader->nFSameSegAllCh = 1;
+    pFrameHeader->nPSameMapAsF = 1;
+    pFrameHeader->nFSameMapAllCh = nChannels == 1;
+    pFrameHeader->nFilters = nChannels * nSegments;
+    pFrameHeader->nPtables = nChannels * nSegments;
+    pPlan->fBits = 0.0;
+
+    for (int ChNr = 0; ChNr < nChannels; ChNr++)
+    {
+        encoderbase_LoadChannel(pEncoderBase, lDsdFrame, ChNr);
+
+        for (int SegNr = 0; SegNr < nSegments; SegNr++)
+        {
+            int nStart = SegNr * pSegment->nResolution * 8;
+            int nEnd = SegNr < nSegments - 1 ? nStart + pSegment->nResolution * 8 : pFrameHeader->nBitsPerCh;
+
+            encoderbase_DesignFilter(pEncoderBase, pPlan, ChNr, pSegment->lTable[ChNr][SegNr], nStart, nEnd);
+        }
+
+        pFrameHeader->lHalfBits[ChNr] = pFrameHeader->lPredOrder[pSegment->lTable[ChNr][0]];
+    }
+}
+
+static void encoderbase_ChooseCoding(EncoderBase *pEncoderBase, EncoderPlan *pPlan)
+{
+    FrameHeader *pFrameHeader = &pPlan->cFrameHeader;
+    CodedTableF *pCodedTableF = &pEncoderBase->cCodedTableF;
+    CodedTableP *pCodedTableP = &pEncoderBase->cCodedTableP;
+
+    for (int FilterNr = 0; FilterNr < pFrameHeader->nFilters; FilterNr++)
+    {
+        int lValues[ENCODER_MAX_ORDER];
+
+        for (int CoefNr = 0; CoefNr < pFrameHeader->lPredOrder[FilterNr]; CoefNr++)
+        {
+            lValues[CoefNr] = pFrameHeader->lICoefA[FilterNr][CoefNr];
+        }
+
+        framewriter_ChooseCoding(lValues, pFrameHeader->lPredOrder[FilterNr], 9, pCodedTableF->lPredOrder, pCodedTableF->lPredCoef, &pCodedTableF->lCoded[FilterNr], &pCodedTableF->lBestMethod[FilterNr], pCodedTableF->lM[FilterNr]);
+    }
+
+    for (int PtableNr = 0; PtableNr < pFrameHeader->nPtables; PtableNr++)
+    {
+        framewriter_ChooseCoding(pPlan->lPOne[PtableNr], pFrameHeader->lPTableLengths[PtableNr], 7, pCodedTableP->lPredOrder, pCodedTableP->lPredCoef, &pCodedTableP->lCoded[PtableNr], &pCodedTableP->lBestMethod[PtableNr], pCodedTableP->lM[PtableNr]);
+    }
+}
+
+/*
+    Writes the frame header of the plan and arithmetic codes the residuals in the decoder's order, bit by bit across
+    the channels. Returns the frame size in bytes, or 0 when it would not be smaller than the frame stored uncoded.
+*/
+static int encoderbase_Write(EncoderBase *pEncoderBase, EncoderPlan *pPlan, const uint8_t *lDsdFrame, uint8_t *lDstFrame)
+{
+    FrameHeader *pFrameHeader = &pPlan->cFrameHeader;
+    StrWriter *pStrWriter = &pEncoderBase->cStrWriter;
+    int nChannels = pFrameHeader->nChannels;
+    int nBitsPerCh = pFrameHeader->nBitsPerCh;
+    int nSegments = pFrameHeader->cSegmentF.lSegments[0];
+    int nSegBits = pFrameHeader->cSegmentF.nResolution * 8;
+    uint64_t Status[6][2];
+    ACEncoder AC;
+
+    encoderbase_ChooseCoding(pEncoderBase, pPlan);
+    strwriter_SetBuffer(pStrWriter, lDstFrame, pEncoderBase->nDsdSize + 1);
+    strwriter_PutBits(pStrWriter, 1, 1);
+    framewriter_WriteSegmentData(pStrWriter, pFrameHeader);
+    framewriter_WriteMappingData(pStrWriter, pFrameHeader);
+    framewriter_WriteFilterCoefSets(pStrWriter, pFrameHeader, &pEncoderBase->cCodedTableF);
+    framewriter_WriteProbabilityTables(pStrWriter, pFrameHeader, &pEncoderBase->cCodedTableP, pPlan->lPOne);
+
+    int nADataStart = strwriter_GetOutBitCount(pStrWriter);
+
+    for (int FilterNr = 0; FilterNr < pFrameHeader->nFilters; FilterNr++)
+    {
+        decoderbase_BuildCoefTable(pFrameHeader->lICoefA[FilterNr], pFrameHeader->lPredOrder[FilterNr], pEncoderBase->lTables[FilterNr]);
+    }
+
+    for (int ChNr = 0; ChNr < nChannels; ChNr++)
+    {
+        Status[ChNr][0] = ENCODER_STATUS;
+        Status[ChNr][1] = ENCODER_STATUS;
+    }
+
+    acencoder_Init(&AC, pStrWriter);
+    acencoder_Encode(&AC, 1, decoderbase_Reverse7LSBs(pFrameHeader->lICoefA[0][0]));
+
+    for (int BitNr = 0; BitNr < nBitsPerCh; BitNr++)
+    {
+        int SegNr = nSegments > 1 ? MIN(BitNr / nSegBits, nSegments - 1) : 0;
+
+        for (int ChNr = 0; ChNr < nChannels; ChNr++)
+        {
+            int Table = pFrameHeader->cSegmentF.lTable[ChNr][SegNr];
+            int16_t Predict = encoderbase_RunFilter((const int16_t (*)[256])pEncoderBase->lTables[Table], (pFrameHeader->lPredOrder[Table] + 7) / 8, Status[ChNr]);
+            int BitVal = (lDsdFrame[(BitNr >> 3) * nChannels + ChNr] >> (7 - (BitNr & 7))) & 1;
+            int Residual = BitVal ^ (((uint16_t)Predict) >> 15);
+
+            if (pFrameHeader->lHalfProbs[ChNr] && BitNr < pFrameHeader->lHalfBits[ChNr])
+            {
+                acencoder_Encode(&AC, Residual, (1 << 8) / 2);
+            }
+            else
+            {
+                acencoder_Encode(&AC, Residual, pPlan->lPOne[Table][encoderbase_GetPtableIndex(Predict)]);
+            }
+
+            encoderbase_ShiftStatus(Status[ChNr], BitVal);
+        }
+    }
+
+    acencoder_Flush(&AC);
+    strwriter_Trim(pStrWriter, nADataStart);
+
+    if (strwriter_GetOutBitCount(pStrWriter) > pStrWriter->nTotalBits || strwriter_GetOutByteCount(pStrWriter) >= pEncoderBase->nDsdSize + 1)
+    {
+        return 0;
+    }
+
+    return strwriter_GetOutByteCount(pStrWriter);
+}
+
+/*
+    Encodes one DSD frame, interleaved byte by byte, into lDstFrame, which has room for the frame stored uncoded: a
+    one byte header in front of the DSD data. Returns the DST frame size in bytes.
+*/
+int encoderbase_Encode(EncoderBase *pEncoderBase, const uint8_t *lDsdFrame, uint8_t *lDstFrame)
+{
+    EncoderPlan *pBest = &pEncoderBase->lPlans[0];
+    int nSegments = m_lEfforts[pEncoderBase->nEffort].nSegments;
+
+    encoderbase_Plan(pEncoderBase, lDsdFrame, 1, pBest);
+
+    if (nSegments > 1 && pBest->cFrameHeader.nMaxFrameLen / nSegments * 8 >= 1024)
+    {
+        EncoderPlan *pPlan = &pEncoderBase->lPlans[1];
+
+        encoderbase_Plan(pEncoderBase, lDsdFrame, nSegments, pPlan);
+
+        if (pPlan->fBits < pBest->fBits)
+        {
+            pBest = pPlan;
+        }
+    }
+
+    int nSize = encoderbase_Write(pEncoderBase, pBest, lDsdFrame, lDstFrame);
+
+    if (nSize > 0)
+    {
+        return nSize;
+    }
+
+    strwriter_SetBuffer(&pEncoderBase->cStrWriter, lDstFrame, pEncoderBase->nDsdSize + 1);
+    strwriter_PutBits(&pEncoderBase->cStrWriter, 8, 0);
+    framewriter_WriteDsdFrame(&pEncoderBase->cStrWriter, pBest->cFrameHeader.nMaxFrameLen, pBest->cFrameHeader.nChannels, lDsdFrame);
+
+    return pEncoderBase->nDsdSize + 1;
+}
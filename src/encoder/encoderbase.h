@@ -0,0 +1,57 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef ENCODERBASE_H
+#define ENCODERBASE_H
+
+#include "strwriter.h"
+#include "../decoder/framereader.h"
+
+/*
+    The filters, probability tables and segment mapping chosen for a frame, with the bits they are expected to take.
+*/
+typedef struct
+{
+    FrameHeader cFrameHeader;
+    int lPOne[12][1 << 6];
+    double fBits;
+
+} EncoderPlan;
+
+typedef struct
+{
+    int nEffort;
+    int nDsdSize;
+    CodedTableF cCodedTableF;
+    CodedTableP cCodedTableP;
+    EncoderPlan lPlans[2];
+    StrWriter cStrWriter;
+    uint8_t *lChannel;
+    uint64_t *lChannelBits;
+    int16_t (*lTables)[16][256];
+    double lBits[2][(1 << 7) + 1];
+
+} EncoderBase;
+
+void encoderbase_New(EncoderBase *pEncoderBase);
+void encoderbase_Free(EncoderBase *pEncoderBase);
+int encoderbase_Init(EncoderBase *pEncoderBase, int nChannels, int nFs44, int nEffort);
+int encoderbase_Encode(EncoderBase *pEncoderBase, const uint8_t *lDsdFrame, uint8_t *lDstFrame);
+
+#endif
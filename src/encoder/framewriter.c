@@ -0,0 +1,280 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "framewriter.h"
+
+int framewriter_RiceBits(int Nr, int m)
+{
+    Nr = Nr < 0 ? -Nr : Nr;
+
+    return (Nr >> m) + 1 + m + (Nr != 0);
+}
+
+void framewriter_RiceEncode(StrWriter *pStrWriter, int Nr, int m)
+{
+    int Sign = Nr < 0;
+    Nr = Sign ? -Nr : Nr;
+
+    for (int RunLength = Nr >> m; RunLength > 0; RunLength--)
+    {
+        strwriter_PutBit(pStrWriter, 0);
+    }
+
+    strwriter_PutBit(pStrWriter, 1);
+    strwriter_PutBits(pStrWriter, m, Nr & ((1 << m) - 1));
+
+    if (Nr != 0)
+    {
+        strwriter_PutBit(pStrWriter, Sign);
+    }
+}
+
+/*
+    The residual the decoder adds the prediction from the previous values to, rounded the same way it rounds.
+*/
+static int framewriter_GetResidual(const int *lValues, int Nr, const int *lPredCoef, int PredOrder)
+{
+    int x = 0;
+
+    for (int TapNr = 0; TapNr < PredOrder; TapNr++)
+    {
+        x += lPredCoef[TapNr] * lValues[Nr - TapNr - 1];
+    }
+
+    return x >= 0 ? lValues[Nr] + (x + 4) / 8 : lValues[Nr] - (-x + 3) / 8;
+}
+
+/*
+    Picks the cheapest way to store nLength values of nBits each: as they are, or as the first values followed by
+    Rice coded residuals of one of the three fixed predictors. Returns the bits needed after the coded flag.
+*/
+int framewriter_ChooseCoding(const int *lValues, int nLength, int nBits, const int lPredOrder[3], const int lPredCoef[3][3], int *pCoded, int *pBestMethod, int lM[3])
+{
+    int nBest = nLength * nBits;
+    *pCoded = 0;
+    *pBestMethod = -1;
+
+    for (int Method = 0; Method < 3; Method++)
+    {
+        int lRiceBits[8] = {0};
+
+        if (lPredOrder[Method] >= nLength)
+        {
+            continue;
+        }
+
+        for (int Nr = lPredOrder[Method]; Nr < nLength; Nr++)
+        {
+            int Residual = framewriter_GetResidual(lValues, Nr, lPredCoef[Method], lPredOrder[Method]);
+
+            for (int m = 0; m < 8; m++)
+            {
+                lRiceBits[m] += framewriter_RiceBits(Residual, m);
+            }
+        }
+
+        for (int m = 0; m < 8; m++)
+        {
+            int nCoded = 2 + lPredOrder[Method] * nBits + 3 + lRiceBits[m];
+
+            if (nCoded < nBest)
+            {
+                nBest = nCoded;
+                *pCoded = 1;
+                *pBestMethod = Method;
+                lM[Method] = m;
+            }
+        }
+    }
+
+    return nBest;
+}
+
+static void framewriter_WriteResiduals(StrWriter *pStrWriter, const int *lValues, int nLength, const int *lPredCoef, int PredOrder, int m)
+{
+    strwriter_PutBits(pStrWriter, 3, m);
+
+    for (int Nr = PredOrder; Nr < nLength; Nr++)
+    {
+        framewriter_RiceEncode(pStrWriter, framewriter_GetResidual(lValues, Nr, lPredCoef, PredOrder), m);
+    }
+}
+
+void framewriter_WriteDsdFrame(StrWriter *pStrWriter, long nMaxFrameLen, int nChannels, const uint8_t *lDsdFrame)
+{
+    strwriter_PutBytes(pStrWriter, nMaxFrameLen * nChannels, lDsdFrame);
+}
+
+void framewriter_WriteTableSegmentData(StrWriter *pStrWriter, int nChannels, int FrameLen, int MinSegLen, Segment *S, int SameSegAllCh)
+{
+    bool ResolWritten = false;
+
+    strwriter_PutBits(pStrWriter, 1, SameSegAllCh);
+
+    for (int ChNr = 0; ChNr < (SameSegAllCh ? 1 : nChannels); ChNr++)
+    {
+        int MaxSegSize = FrameLen - MinSegLen / 8;
+
+        for (int SegNr = 0; SegNr < S->lSegments[ChNr] - 1; SegNr++)
+        {
+            strwriter_PutBits(pStrWriter, 1, 0);
+
+            if (!ResolWritten)
+            {
+                strwriter_PutBits(pStrWriter, framereader_Log2RoundUp(FrameLen - MinSegLen / 8), S->nResolution);
+                ResolWritten = true;
+            }
+
+            strwriter_PutBits(pStrWriter, framereader_Log2RoundUp(MaxSegSize / S->nResolution), S->lLengths[ChNr][SegNr]);
+            MaxSegSize -= S->nResolution * S->lLengths[ChNr][SegNr];
+        }
+
+        strwriter_PutBits(pStrWriter, 1, 1);
+    }
+}
+
+void framewriter_WriteSegmentData(StrWriter *pStrWriter, FrameHeader *pFrameHeader)
+{
+    strwriter_PutBits(pStrWriter, 1, pFrameHeader->nPSameSegAsF);
+    framewriter_WriteTableSegmentData(pStrWriter, pFrameHeader->nChannels, pFrameHeader->nMaxFrameLen, 1024, &pFrameHeader->cSegmentF, pFrameHeader->nFSameSegAllCh);
+
+    if (pFrameHeader->nPSameSegAsF == 0)
+    {
+        framewriter_WriteTableSegmentData(pStrWriter, pFrameHeader->nChannels, pFrameHeader->nMaxFrameLen, 32, &pFrameHeader->cSegmentP, pFrameHeader->nPSameSegAllCh);
+    }
+}
+
+/*
+    A table number one past the highest so far starts a new table, so tables must be numbered in order of first use.
+*/
+void framewriter_WriteTableMappingData(StrWriter *pStrWriter, int nChannels, Segment *S, int SameMapAllCh)
+{
+    int CountTables = 1;
+
+    strwriter_PutBits(pStrWriter, 1, SameMapAllCh);
+
+    for (int ChNr = 0; ChNr < (SameMapAllCh ? 1 : nChannels); ChNr++)
+    {
+        for (int SegNr = 0; SegNr < S->lSegments[ChNr]; SegNr++)
+        {
+            if ((ChNr != 0) || (SegNr != 0))
+            {
+                strwriter_PutBits(pStrWriter, framereader_Log2RoundUp(CountTables), S->lTable[ChNr][SegNr]);
+
+                if (S->lTable[ChNr][SegNr] == CountTables)
+                {
+                    CountTables++;
+                }
+            }
+        }
+    }
+}
+
+void framewriter_WriteMappingData(StrWriter *pStrWriter, FrameHeader *pFrameHeader)
+{
+    strwriter_PutBits(pStrWriter, 1, pFrameHeader->nPSameMapAsF);
+    framewriter_WriteTableMappingData(pStrWriter, pFrameHeader->nChannels, &pFrameHeader->cSegmentF, pFrameHeader->nFSameMapAllCh);
+
+    if (pFrameHeader->nPSameMapAsF == 0)
+    {
+        framewriter_WriteTableMappingData(pStrWriter, pFrameHeader->nChannels, &pFrameHeader->cSegmentP, pFrameHeader->nPSameMapAllCh);
+    }
+
+    for (int i = 0; i < pFrameHeader->nChannels; i++)
+    {
+        strwriter_PutBits(pStrWriter, 1, pFrameHeader->lHalfProbs[i]);
+    }
+}
+
+void framewriter_WriteFilterCoefSets(StrWriter *pStrWriter, FrameHeader *pFrameHeader, CodedTableF *pCodedTableF)
+{
+    for (int FilterNr = 0; FilterNr < pFrameHeader->nFilters; FilterNr++)
+    {
+        int PredOrder = pFrameHeader->lPredOrder[FilterNr];
+        int bestmethod = pCodedTableF->lBestMethod[FilterNr];
+        int lValues[1 << 7];
+
+        for (int CoefNr = 0; CoefNr < PredOrder; CoefNr++)
+        {
+            lValues[CoefNr] = pFrameHeader->lICoefA[FilterNr][CoefNr];
+        }
+
+        strwriter_PutBits(pStrWriter, 7, PredOrder - 1);
+        strwriter_PutBits(pStrWriter, 1, pCodedTableF->lCoded[FilterNr]);
+
+        if (!pCodedTableF->lCoded[FilterNr])
+        {
+            for (int CoefNr = 0; CoefNr < PredOrder; CoefNr++)
+            {
+                strwriter_PutBits(pStrWriter, 9, lValues[CoefNr] & 0x1ff);
+            }
+        }
+        else
+        {
+            strwriter_PutBits(pStrWriter, 2, bestmethod);
+
+            for (int CoefNr = 0; CoefNr < pCodedTableF->lPredOrder[bestmethod]; CoefNr++)
+            {
+                strwriter_PutBits(pStrWriter, 9, lValues[CoefNr] & 0x1ff);
+            }
+
+            framewriter_WriteResiduals(pStrWriter, lValues, PredOrder, pCodedTableF->lPredCoef[bestmethod], pCodedTableF->lPredOrder[bestmethod], pCodedTableF->lM[FilterNr][bestmethod]);
+        }
+    }
+}
+
+/*
+    A table of one entry is not stored, the decoder takes it to be 128.
+*/
+void framewriter_WriteProbabilityTables(StrWriter *pStrWriter, FrameHeader *pFrameHeader, CodedTableP *pCodedTableP, int lPOne[12][1 << 6])
+{
+    for (int PtableNr = 0; PtableNr < pFrameHeader->nPtables; PtableNr++)
+    {
+        int nLength = pFrameHeader->lPTableLengths[PtableNr];
+        int bestmethod = pCodedTableP->lBestMethod[PtableNr];
+
+        strwriter_PutBits(pStrWriter, 6, nLength - 1);
+
+        if (nLength == 1)
+        {
+            continue;
+        }
+
+        strwriter_PutBits(pStrWriter, 1, pCodedTableP->lCoded[PtableNr]);
+
+        if (!pCodedTableP->lCoded[PtableNr])
+        {
+            for (int EntryNr = 0; EntryNr < nLength; EntryNr++)
+            {
+                strwriter_PutBits(pStrWriter, 7, lPOne[PtableNr][EntryNr] - 1);
+            }
+        }
+        else
+        {
+            strwriter_PutBits(pStrWriter, 2, bestmethod);
+
+            for (int EntryNr = 0; EntryNr < pCodedTableP->lPredOrder[bestmethod]; EntryNr++)
+            {
+                strwriter_PutBits(pStrWriter, 7, lPOne[PtableNr][EntryNr] - 1);
+            }
+
+            framewriter_WriteResiduals(pStrWriter, lPOne[PtableNr], nLength, pCodedTableP->lPredCoef[bestmethod], pCodedTableP->lPredOrder[bestmethod], pCodedTableP->lM[PtableNr][bestmethod]);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef FRAMEWRITER_H
+#define FRAMEWRITER_H
+
+#include "strwriter.h"
+#include "../decoder/framereader.h"
+
+int framewriter_RiceBits(int Nr, int m);
+void framewriter_RiceEncode(StrWriter *pStrWriter, int Nr, int m);
+int framewriter_ChooseCoding(const int *lValues, int nLength, int nBits, const int lPredOrder[3], const int lPredCoef[3][3], int *pCoded, int *pBestMethod, int lM[3]);
+void framewriter_WriteDsdFrame(StrWriter *pStrWriter, long nMaxFrameLen, int nChannels, const uint8_t *lDsdFrame);
+void framewriter_WriteTableSegmentData(StrWriter *pStrWriter, int nChannels, int FrameLen, int MinSegLen, Segment *S, int SameSegAllCh);
+void framewriter_WriteSegmentData(StrWriter *pStrWriter, FrameHeader *pFrameHeader);
+void framewriter_WriteTableMappingData(StrWriter *pStrWriter, int nChannels, Segment *S, int SameMapAllCh);
+void framewriter_WriteMappingData(StrWriter *pStrWriter, FrameHeader *pFrameHeader);
+void framewriter_WriteFilterCoefSets(StrWriter *pStrWriter, FrameHeader *pFrameHeader, CodedTableF *pCodedTableF);
+void framewriter_WriteProbabilityTables(StrWriter *pStrWriter, FrameHeader *pFrameHeader, CodedTableP *pCodedTableP, int lPOne[12][1 << 6]);
+
+#endif
@@ -0,0 +1,107 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "strwriter.h"
+#include <string.h>
+
+#define STRWRITER_BIT(pStrWriter, nBit) (((pStrWriter)->pData[(nBit) >> 3] >> (7 - ((nBit) & 7))) & 1)
+
+void strwriter_SetBuffer(StrWriter *pStrWriter, uint8_t *lBuf, int nSize)
+{
+    memset(lBuf, 0, nSize);
+    pStrWriter->pData = lBuf;
+    pStrWriter->nTotalBits = nSize * 8;
+    pStrWriter->nBit = 0;
+}
+
+void strwriter_PutBits(StrWriter *pStrWriter, int nLength, uint32_t nValue)
+{
+    for (int i = nLength - 1; i >= 0; i--)
+    {
+        strwriter_PutBit(pStrWriter, (nValue >> i) & 1);
+    }
+}
+
+void strwriter_PutBytes(StrWriter *pStrWriter, int nLength, const uint8_t *lBuf)
+{
+    if ((pStrWriter->nBit & 7) == 0 && pStrWriter->nBit + nLength * 8 <= pStrWriter->nTotalBits)
+    {
+        memcpy(pStrWriter->pData + (pStrWriter->nBit >> 3), lBuf, nLength);
+        pStrWriter->nBit += nLength * 8;
+
+        return;
+    }
+
+    for (int i = 0; i < nLength; i++)
+    {
+        strwriter_PutBits(pStrWriter, 8, lBuf[i]);
+    }
+}
+
+/*
+    Adds one to the bits written so far, for the carry out of the arithmetic coder's low register. The run of ones at
+    the end turns into zeros and the zero before it into a one.
+*/
+void strwriter_Carry(StrWriter *pStrWriter)
+{
+    int nBit = pStrWriter->nBit - 1;
+
+    while (nBit >= pStrWriter->nTotalBits)
+    {
+        nBit--;
+    }
+
+    while (nBit >= 0 && STRWRITER_BIT(pStrWriter, nBit))
+    {
+        pStrWriter->pData[nBit >> 3] &= (uint8_t)~(0x80 >> (nBit & 7));
+        nBit--;
+    }
+
+    if (nBit >= 0)
+    {
+        pStrWriter->pData[nBit >> 3] |= (uint8_t)(0x80 >> (nBit & 7));
+    }
+}
+
+/*
+    Drops the zeros at the end of what was written from bit nStart on. A reader gets zeros past the end of a frame, so
+    they need not be stored.
+*/
+void strwriter_Trim(StrWriter *pStrWriter, int nStart)
+{
+    if (pStrWriter->nBit > pStrWriter->nTotalBits)
+    {
+        return;
+    }
+
+    while (pStrWriter->nBit > nStart && !STRWRITER_BIT(pStrWriter, pStrWriter->nBit - 1))
+    {
+        pStrWriter->nBit--;
+    }
+}
+
+int strwriter_GetOutBitCount(StrWriter *pStrWriter)
+{
+    return pStrWriter->nBit;
+}
+
+int strwriter_GetOutByteCount(StrWriter *pStrWriter)
+{
+    return (pStrWriter->nBit + 7) / 8;
+}
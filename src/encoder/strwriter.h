@@ -0,0 +1,55 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef STRWRITER_H
+#define STRWRITER_H
+
+#include <stdint.h>
+
+/*
+    Writes a frame MSB first into a zeroed buffer of nTotalBits. Writing goes on counting past the end of the buffer
+    without storing anything, so an encoder can find out that a frame does not fit and fall back to storing it uncoded.
+*/
+typedef struct
+{
+    uint8_t *pData;
+    int nTotalBits;
+    int nBit;
+
+} StrWriter;
+
+void strwriter_SetBuffer(StrWriter *pStrWriter, uint8_t *lBuf, int nSize);
+void strwriter_PutBits(StrWriter *pStrWriter, int nLength, uint32_t nValue);
+void strwriter_PutBytes(StrWriter *pStrWriter, int nLength, const uint8_t *lBuf);
+void strwriter_Carry(StrWriter *pStrWriter);
+void strwriter_Trim(StrWriter *pStrWriter, int nStart);
+int strwriter_GetOutBitCount(StrWriter *pStrWriter);
+int strwriter_GetOutByteCount(StrWriter *pStrWriter);
+
+static inline void strwriter_PutBit(StrWriter *pStrWriter, int nBit)
+{
+    if (nBit && pStrWriter->nBit < pStrWriter->nTotalBits)
+    {
+        pStrWriter->pData[pStrWriter->nBit >> 3] |= (uint8_t)(0x80 >> (pStrWriter->nBit & 7));
+    }
+
+    pStrWriter->nBit++;
+}
+
+#endif
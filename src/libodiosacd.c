@@ -17,21 +17,38 @@
     along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
 */
 
+#define _GNU_SOURCE
+
 #include "libodiosacd.h"
 #include "reader/disc.h"
 #include "reader/dff.h"
 #include "reader/dsf.h"
 #include "converter/converter.h"
+#include "converter/quantizer.h"
+#include "converter/memory.h"
 #include "decoder/decoder.h"
+#include "encoder/encoder.h"
+#include "worker/pool.h"
+#include "worker/ring.h"
 #include <math.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <fcntl.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <errno.h>
+#include <time.h>
 
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 #define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define PIPELINE_DEPTH 8
+#define CHUNK_MIN_FRAMES 75
+#define OUTPUT_BUFFER_SIZE (4 << 20)
+#define DSF_BLOCK_SIZE 4096
+#define DSF_HEADER_SIZE 92
+#define HEADER_SIZE_MAX 160
+#define DSTI_ENTRY_SIZE 12
 
 typedef enum
 {
@@ -47,9 +64,45 @@ typedef struct
     int nTrack;
     Area nArea;
     int nTrackInfo;
+    int nPart;
+    int nParts;
+    uint32_t nFirstFrame;
+    uint32_t nFrames;
+    uint64_t nCost;
 
 } TrackInfo;
 
+typedef struct
+{
+    atomic_int nPending;
+    uint32_t nFrames;
+    int lFiles[CONVERTER_MAX_OUTPUTS];
+    off_t lDataEnds[CONVERTER_MAX_OUTPUTS];
+    char *lOutFiles[CONVERTER_MAX_OUTPUTS];
+
+} TrackOutput;
+
+typedef struct
+{
+    uint8_t *lData;
+    size_t nSize;
+    FrameType nFrameType;
+    bool bFetch;
+    uint32_t nFrame;
+    float fProgress;
+    bool bEnd;
+
+} ReadFrame;
+
+typedef struct
+{
+    float *lPcmData;
+    uint8_t *lDsdData;
+    int nOffset;
+    int nFrames;
+
+} PcmFrame;
+
 typedef union
 {
     Dff *pDff;
@@ -58,61 +111,189 @@ typedef union
 
 } Reader;
 
+typedef struct OdioLibSacd OdioLibSacd;
+
 typedef struct
 {
+    OdioLibSacd *pOdioLibSacd;
+    int nSampleRate;
+    OutputFormat nFormat;
+    int nConverterOutput;
+    int nSampleBytes;
+    int nPcmSamples;
+    int nPcmDelta;
+    bool bTrimmed;
+    uint32_t nSkipFrames;
+    int nBuffered;
+    PcmFrame lPcmFrames[PIPELINE_DEPTH];
+    Ring cPcmFree;
+    Ring cPcmFull;
+    PoolStage cWriteStage;
+    uint8_t *lOutBuf;
+    int nOutFill;
+    int nFile;
+    off_t nWriteOffset;
+    Encoder *pEncoder;
+    uint8_t *lDstIndex;
+    uint32_t nDstFrames;
+    uint32_t nDstIndexFrames;
+
+} PcmOutput;
+
+struct OdioLibSacd
+{
+    OdioSacdSession *pSession;
+    MediaType nMediaType;
     Media *pMedia;
     Reader cReader;
     Decoder *pDecoder;
     Converter *pConverter;
-    uint8_t *lDstBuf;
-    uint8_t *lDsdBuf;
-    float *lPcmBuf;
+    ReadFrame lReadFrames[PIPELINE_DEPTH];
+    Ring cReadFree;
+    Ring cReadFull;
+    PoolStage cReadStage;
+    bool bReadEnd;
+    bool bFlushing;
+    PcmOutput lOutputs[CONVERTER_MAX_OUTPUTS];
+    int nOutputs;
+    uint32_t nReadFrames;
+    uint32_t nFramesRead;
+    uint32_t nPartFrames;
+    atomic_int nProgress;
     int nDsdBufSize;
     int nDstBufSize;
     int nSampleRate;
     int nFrameRate;
-    int nPcmSamples;
-    int nPcmDelta;
-    float fProgress;
     int nChannels;
     unsigned int nChannelMap;
     bool bTrackCompleted;
-    bool bTrimmed;
+    bool bFailed;
+    bool bStream;
     int nTwoch;
     int nMulch;
+    uint8_t lSwapBits[256];
+};
+
+struct OdioSacdSession
+{
+    int nCpus;
+    int nThreads;
+    TrackInfo *lTrackInfos;
+    int nTrackInfos;
+    TrackInfo *lQueue;
+    int nQueue;
+    atomic_int nQueueHead;
+    TrackOutput *lOutputs;
+    int nParts;
+    int nChunks;
+    int nDecodeDepth;
+    int nDstEffort;
+    bool bSinglePrecision;
+    bool bLockstep;
+    pthread_mutex_t hMutex;
+    pthread_cond_t hFinished;
+    OutputTarget lTargets[CONVERTER_MAX_OUTPUTS];
+    int nTargets;
+    char *sInPath;
+    atomic_int nFinished;
+    MediaType nMediaType;
+    int nDsdSampleRate;
+    int nTracks;
+    OnProgress pOnProgress;
+    DiscDetails *pDiscDetails;
+    OdioLibSacd *pOdioLibSacd;
+    OdioLibSacd *lOdioLibSacd;
+    bool bSameTrackCounts;
+    atomic_bool bAbort;
+    atomic_bool bFailed;
+    void *pUserData;
+    _Atomic float fProgress;
+    int nProgressInterval;
+};
+
+struct OdioSacdTrack
+{
+    OdioLibSacd cOdioLibSacd;
+    PcmFrame *pPcmFrame;
+};
+
+struct OdioSacdDst
+{
+    Decoder *pDecoder;
+    size_t nDsdSize;
+};
+
+static bool odiolibsacd_IsDsd(PcmOutput *pOutput)
+{
+    return pOutput->nFormat == FORMAT_DSF || pOutput->nFormat == FORMAT_DFF || pOutput->nFormat == FORMAT_DST;
+}
+
+/*
+    The PCM rates are 44.1 kHz times 1, 2, 4, 8 or 16, as far as the filter stages can reach them from the DSD rate of
+    the input. DSD64 can not go to 705.6 kHz, for example.
+*/
+static bool odiolibsacd_IsPcmSampleRate(OdioSacdSession *pSession, int nSampleRate)
+{
+    ConverterPlan cPlan;
+
+    if (nSampleRate != 44100 && nSampleRate != 88200 && nSampleRate != 176400 && nSampleRate != 352800 && nSampleRate != 705600)
+    {
+        return false;
+    }
+
+    return pSession->nDsdSampleRate % nSampleRate == 0 && converterbase_Plan(pSession->nDsdSampleRate / nSampleRate, &cPlan);
+}
+
+static const char* odiolibsacd_GetExtension(OutputFormat nFormat)
+{
+    if (nFormat == FORMAT_DSF)
+    {
+        return "dsf";
+    }
+    else if (nFormat == FORMAT_DFF || nFormat == FORMAT_DST)
+    {
+        return "dff";
+    }
+
+    return "wav";
+}
+
+static int odiolibsacd_GetHeaderSize(PcmOutput *pOutput)
+{
+    if (pOutput->nFormat == FORMAT_DSF)
+    {
+        return DSF_HEADER_SIZE;
+    }
+    else if (pOutput->nFormat == FORMAT_DFF)
+    {
+        return 122 + 4 * pOutput->pOdioLibSacd->nChannels;
+    }
+    else if (pOutput->nFormat == FORMAT_DST)
+    {
+        return 136 + 4 * pOutput->pOdioLibSacd->nChannels;
+    }
 
-} OdioLibSacd;
-
-int m_nCpus;
-int m_nThreads;
-TrackInfo *m_lTrackInfos;
-int m_nTrackInfos;
-pthread_mutex_t m_hMutex;
-char *m_sOutPath;
-char *m_sInPath;
-int m_nSampleRate;
-int m_nFinished;
-MediaType m_nMediaType;
-int m_nTracks;
-OnProgress m_pOnProgress;
-DiscDetails *m_pDiscDetails;
-OdioLibSacd *m_pOdioLibSacd;
-bool m_bSameTrackCounts;
-bool m_bAbort;
-void *m_pUserData;
-float m_fProgress;
+    return 68;
+}
 
 void odiolibsacd_DoClose(OdioLibSacd *pOdioLibSacd)
 {
-    if (m_nMediaType == ISO_TYPE && pOdioLibSacd->cReader.pDisc)
+    pool_StageWait(&pOdioLibSacd->cReadStage);
+
+    for (int nOutput = 0; nOutput < CONVERTER_MAX_OUTPUTS; nOutput++)
+    {
+        pool_StageWait(&pOdioLibSacd->lOutputs[nOutput].cWriteStage);
+    }
+
+    if (pOdioLibSacd->nMediaType == ISO_TYPE && pOdioLibSacd->cReader.pDisc)
     {
         disc_Free(pOdioLibSacd->cReader.pDisc);
     }
-    else if (m_nMediaType == DSDIFF_TYPE && pOdioLibSacd->cReader.pDff)
+    else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE && pOdioLibSacd->cReader.pDff)
     {
         dff_Free(pOdioLibSacd->cReader.pDff);
     }
-    else if (m_nMediaType == DSF_TYPE && pOdioLibSacd->cReader.pDsf)
+    else if (pOdioLibSacd->nMediaType == DSF_TYPE && pOdioLibSacd->cReader.pDsf)
     {
         dsf_Free(pOdioLibSacd->cReader.pDsf);
     }
@@ -132,19 +313,33 @@ void odiolibsacd_DoClose(OdioLibSacd *pOdioLibSacd)
         decoder_Free(pOdioLibSacd->pDecoder);
     }
 
-    if (pOdioLibSacd->lDstBuf)
+    for (int i = 0; i < PIPELINE_DEPTH; i++)
     {
-        free(pOdioLibSacd->lDstBuf);
+        free(pOdioLibSacd->lReadFrames[i].lData);
     }
 
-    if (pOdioLibSacd->lDsdBuf)
-    {
-        free(pOdioLibSacd->lDsdBuf);
-    }
+    ring_Free(&pOdioLibSacd->cReadFree);
+    ring_Free(&pOdioLibSacd->cReadFull);
 
-    if (pOdioLibSacd->lPcmBuf)
+    for (int nOutput = 0; nOutput < CONVERTER_MAX_OUTPUTS; nOutput++)
     {
-        free(pOdioLibSacd->lPcmBuf);
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+
+        for (int i = 0; i < PIPELINE_DEPTH; i++)
+        {
+            free(pOutput->lPcmFrames[i].lPcmData);
+            free(pOutput->lPcmFrames[i].lDsdData);
+        }
+
+        if (pOutput->pEncoder)
+        {
+            encoder_Free(pOutput->pEncoder);
+        }
+
+        free(pOutput->lDstIndex);
+        memFree(pOutput->lOutBuf);
+        ring_Free(&pOutput->cPcmFree);
+        ring_Free(&pOutput->cPcmFull);
     }
 }
 
@@ -160,219 +355,617 @@ void odiolibsacd_PackageInt(unsigned char *lBuf, int nOffset, int nValue, int nB
     }
 }
 
-void odiolibsacd_DoConvert(OdioLibSacd *pOdioLibSacd, uint8_t *lDsdData, int nDsdSamples, float *lPcmData)
+static void odiolibsacd_PackageLong(unsigned char *lBuf, int nOffset, uint64_t nValue, int nBytes, bool bBigEndian)
 {
-    if (pOdioLibSacd->pConverter)
+    for (int i = 0; i < nBytes; i++)
     {
-        converter_Convert(pOdioLibSacd->pConverter, lDsdData, nDsdSamples, lPcmData);
+        lBuf[nOffset + (bBigEndian ? nBytes - 1 - i : i)] = (unsigned char)((nValue >> (8 * i)) & 0xff);
     }
 }
 
-void odiolibsacd_WriteData(OdioLibSacd *pOdioLibSacd, FILE *pFile, int nOffset, int nFrames)
+void odiolibsacd_DoConvert(OdioLibSacd *pOdioLibSacd, uint8_t *lDsdData, int nDsdSamples, PcmFrame **lPcmFrames, int *lPcmSamples)
 {
-    int nTrim = 0;
+    float *lPcmData[CONVERTER_MAX_OUTPUTS];
+    int lConverted[CONVERTER_MAX_OUTPUTS];
+    int nConverted = 0;
 
-    if (!pOdioLibSacd->bTrimmed)
+    for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
     {
-        nTrim = 30;
-        pOdioLibSacd->bTrimmed = true;
-    }
+        if (lPcmFrames[nOutput])
+        {
+            lPcmData[nConverted++] = lPcmFrames[nOutput]->lPcmData;
+        }
 
-    int nSamples = (nFrames - nTrim) * pOdioLibSacd->nChannels;
-    int nBytesOut = nSamples * 3;
-    char *pSrc = (char*)(pOdioLibSacd->lPcmBuf + (nOffset + nTrim) * pOdioLibSacd->nChannels);
-    char *pDst = malloc(sizeof(char) * nBytesOut);
-    int nOut = 0;
+        lPcmSamples[nOutput] = 0;
+    }
 
-    for (int nSample = 0; nSample < nSamples; nSample++, pSrc += 4)
+    if (pOdioLibSacd->pConverter)
     {
-        float fSample = *(float*)(pSrc);
-        fSample = MIN(fSample, 1.0);
-        fSample = MAX(fSample, -1.0);
-        fSample *= 8388608.0;
-
-        int32_t nVal = lrintf(fSample);
-        nVal = MIN(nVal, 8388607);
-        nVal = MAX(nVal, -8388608);
+        converter_Convert(pOdioLibSacd->pConverter, lDsdData, nDsdSamples, lPcmData, lConverted);
+        nConverted = 0;
 
-        pDst[nOut++] = nVal;
-        pDst[nOut++] = nVal >> 8;
-        pDst[nOut++] = nVal >> 16;
+        for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
+        {
+            if (lPcmFrames[nOutput])
+            {
+                lPcmSamples[nOutput] = lConverted[nConverted++] / pOdioLibSacd->nChannels;
+            }
+        }
     }
+}
 
-    fwrite(pDst, 1, nBytesOut, pFile);
-    free(pDst);
+static void odiolibsacd_OnRead(void *pData)
+{
+    OdioLibSacd *pOdioLibSacd = (OdioLibSacd*)pData;
+    void *pItem;
 
-    if (m_nMediaType == ISO_TYPE)
-    {
-        pOdioLibSacd->fProgress = disc_GetProgress(pOdioLibSacd->cReader.pDisc);
-    }
-    else if (m_nMediaType == DSDIFF_TYPE)
+    while (!pOdioLibSacd->bReadEnd && ring_Pop(&pOdioLibSacd->cReadFree, &pItem))
     {
-        pOdioLibSacd->fProgress = dff_GetProgress(pOdioLibSacd->cReader.pDff);
-    }
-    else if (m_nMediaType == DSF_TYPE)
-    {
-        pOdioLibSacd->fProgress = dsf_GetProgress(pOdioLibSacd->cReader.pDsf);
+        ReadFrame *pFrame = (ReadFrame*)pItem;
+        bool bResult = false;
+
+        do
+        {
+            if ((!pOdioLibSacd->bStream && pOdioLibSacd->pSession->bAbort) || (pOdioLibSacd->nReadFrames && pOdioLibSacd->nFramesRead == pOdioLibSacd->nReadFrames))
+            {
+                break;
+            }
+
+            pFrame->nSize = pOdioLibSacd->nDstBufSize;
+            pFrame->bFetch = false;
+
+            if (pOdioLibSacd->nMediaType == ISO_TYPE)
+            {
+                bResult = disc_ReadFrame(pOdioLibSacd->cReader.pDisc, pFrame->lData, &pFrame->nSize, &pFrame->nFrameType);
+            }
+            else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE && dff_HasFrameIndex(pOdioLibSacd->cReader.pDff))
+            {
+                // Only the frame's place in the index, the decoder workers read the frames themselves
+                bResult = dff_NextDstFrame(pOdioLibSacd->cReader.pDff, &pFrame->nFrame, &pFrame->nSize);
+                pFrame->nFrameType = FRAME_DST;
+                pFrame->bFetch = true;
+            }
+            else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+            {
+                bResult = dff_ReadFrame(pOdioLibSacd->cReader.pDff, pFrame->lData, &pFrame->nSize, &pFrame->nFrameType);
+            }
+            else if (pOdioLibSacd->nMediaType == DSF_TYPE)
+            {
+                bResult = dsf_ReadFrame(pOdioLibSacd->cReader.pDsf, pFrame->lData, &pFrame->nSize, &pFrame->nFrameType);
+            }
+        }
+        while (bResult && pFrame->nSize == 0);
+
+        if (bResult && pFrame->nFrameType == FRAME_INVALID)
+        {
+            pFrame->nSize = pOdioLibSacd->nDstBufSize;
+            memset(pFrame->lData, 0x69, pFrame->nSize);
+        }
+
+        if (bResult)
+        {
+            pOdioLibSacd->nFramesRead++;
+        }
+
+        if (pOdioLibSacd->nPartFrames)
+        {
+            pFrame->fProgress = MIN(pOdioLibSacd->nFramesRead * 100.0f / pOdioLibSacd->nPartFrames, 100.0f);
+        }
+        else if (pOdioLibSacd->nMediaType == ISO_TYPE)
+        {
+            pFrame->fProgress = disc_GetProgress(pOdioLibSacd->cReader.pDisc);
+        }
+        else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+        {
+            pFrame->fProgress = dff_GetProgress(pOdioLibSacd->cReader.pDff);
+        }
+        else if (pOdioLibSacd->nMediaType == DSF_TYPE)
+        {
+            pFrame->fProgress = dsf_GetProgress(pOdioLibSacd->cReader.pDsf);
+        }
+
+        pFrame->bEnd = !bResult;
+        pOdioLibSacd->bReadEnd = pFrame->bEnd;
+        ring_Push(&pOdioLibSacd->cReadFull, pFrame);
     }
 }
 
-int odiolibsacd_DoOpen(OdioLibSacd *pOdioLibSacd, char *sPath)
+static ReadFrame* odiolibsacd_GetFrame(OdioLibSacd *pOdioLibSacd)
 {
-    pOdioLibSacd->pMedia = NULL;
-    pOdioLibSacd->pConverter = NULL;
-    pOdioLibSacd->pDecoder = NULL;
-    pOdioLibSacd->fProgress = 0;
-    pOdioLibSacd->nPcmSamples = 0;
-    pOdioLibSacd->nPcmDelta = 0;
-    pOdioLibSacd->lDstBuf = NULL;
-    pOdioLibSacd->lDsdBuf = NULL;
-    pOdioLibSacd->lPcmBuf = NULL;
-    pOdioLibSacd->bTrimmed = false;
-
-    char sExt[4];
-    strncpy(sExt, sPath + (strlen(sPath) - 3), 3);
-    sExt[3] = '\0';
+    void *pItem;
 
-    for (int i = 0; i < 3; ++i)
+    while (!ring_Pop(&pOdioLibSacd->cReadFull, &pItem))
     {
-        sExt[i] = tolower(sExt[i]);
+        pool_StageKick(&pOdioLibSacd->cReadStage);
+        pool_StageWait(&pOdioLibSacd->cReadStage);
     }
 
-    m_nMediaType = UNK_TYPE;
+    return (ReadFrame*)pItem;
+}
 
-    if (!strcmp(sExt, "iso"))
-    {
-        m_nMediaType = ISO_TYPE;
-    }
-    else if (!strcmp(sExt, "dff"))
+static bool odiolibsacd_FetchDst(void *pData, uint32_t nFrame, uint8_t *lDstData, size_t *pDstSize)
+{
+    return dff_ReadDstFrame((Dff*)pData, nFrame, lDstData, pDstSize);
+}
+
+static void odiolibsacd_PutFrame(OdioLibSacd *pOdioLibSacd, ReadFrame *pFrame)
+{
+    ring_Push(&pOdioLibSacd->cReadFree, pFrame);
+
+    if (ring_Count(&pOdioLibSacd->cReadFree) >= PIPELINE_DEPTH / 2)
     {
-        m_nMediaType = DSDIFF_TYPE;
+        pool_StageKick(&pOdioLibSacd->cReadStage);
     }
-    else if (!strcmp(sExt, "dsf"))
+}
+
+static void odiolibsacd_Write(PcmOutput *pOutput, uint8_t *lData, size_t nSize, off_t nOffset)
+{
+    if (nSize > 0 && pwrite(pOutput->nFile, lData, nSize, nOffset) != (ssize_t)nSize)
     {
-        m_nMediaType = DSF_TYPE;
+        printf("PANIC: Could not write output file\n");
     }
+}
 
-    if (m_nMediaType == UNK_TYPE)
+/*
+    For DSF outputs nWriteOffset and nOutFill count bytes per channel, and lOutBuf holds whole block groups from the
+    group of the first buffered byte on. Groups at the edges of a chunk are shared with the neighbouring chunks, so
+    they are written channel by channel.
+*/
+static void odiolibsacd_FlushDsf(PcmOutput *pOutput)
+{
+    int nChannels = pOutput->pOdioLibSacd->nChannels;
+    off_t nGroupSize = (off_t)DSF_BLOCK_SIZE * nChannels;
+    off_t nEnd = pOutput->nWriteOffset;
+    off_t nPos = nEnd - pOutput->nOutFill;
+    off_t nFirstBlock = nPos / DSF_BLOCK_SIZE;
+
+    while (nPos < nEnd)
     {
-        printf("PANIC: Unknown media format\n");
-        return 0;
+        off_t nBlock = nPos / DSF_BLOCK_SIZE;
+        off_t nBlockEnd = MIN((nBlock + 1) * DSF_BLOCK_SIZE, nEnd);
+        uint8_t *pGroup = pOutput->lOutBuf + (nBlock - nFirstBlock) * nGroupSize;
+
+        if (nPos % DSF_BLOCK_SIZE == 0 && nBlockEnd % DSF_BLOCK_SIZE == 0)
+        {
+            off_t nLastBlock = nEnd / DSF_BLOCK_SIZE;
+            odiolibsacd_Write(pOutput, pGroup, (nLastBlock - nBlock) * nGroupSize, DSF_HEADER_SIZE + nBlock * nGroupSize);
+            nPos = nLastBlock * DSF_BLOCK_SIZE;
+        }
+        else
+        {
+            for (int ch = 0; ch < nChannels; ch++)
+            {
+                off_t nIndex = ch * DSF_BLOCK_SIZE + nPos % DSF_BLOCK_SIZE;
+                odiolibsacd_Write(pOutput, pGroup + nIndex, nBlockEnd - nPos, DSF_HEADER_SIZE + nBlock * nGroupSize + nIndex);
+            }
+
+            nPos = nBlockEnd;
+        }
     }
 
-    pOdioLibSacd->pMedia = media_New(sPath);
+    pOutput->nOutFill = 0;
+}
 
-    if (!pOdioLibSacd->pMedia)
+static void odiolibsacd_FlushOutput(PcmOutput *pOutput)
+{
+    if (pOutput->nFormat == FORMAT_DSF)
     {
-        printf("PANIC: Failed to initialise media\n");
+        odiolibsacd_FlushDsf(pOutput);
 
-        return 0;
+        return;
     }
 
-    if (m_nMediaType == ISO_TYPE)
-    {
-        pOdioLibSacd->cReader.pDisc = disc_New();
+    odiolibsacd_Write(pOutput, pOutput->lOutBuf, pOutput->nOutFill, pOutput->nWriteOffset - pOutput->nOutFill);
+    pOutput->nOutFill = 0;
+}
 
-        if (!pOdioLibSacd->cReader.pDisc)
-        {
-            printf("PANIC: Failed to initialise reader\n");
+static void odiolibsacd_PackDsf(PcmOutput *pOutput, uint8_t *lDsdData, int nFrames)
+{
+    OdioLibSacd *pOdioLibSacd = pOutput->pOdioLibSacd;
+    int nChannels = pOdioLibSacd->nChannels;
+    off_t nGroupSize = (off_t)DSF_BLOCK_SIZE * nChannels;
 
-            return 0;
-        }
-    }
-    else if (m_nMediaType == DSDIFF_TYPE)
+    if (((pOutput->nWriteOffset + nFrames + DSF_BLOCK_SIZE - 1) / DSF_BLOCK_SIZE - (pOutput->nWriteOffset - pOutput->nOutFill) / DSF_BLOCK_SIZE) * nGroupSize > OUTPUT_BUFFER_SIZE)
     {
-        pOdioLibSacd->cReader.pDff = dff_New();
+        odiolibsacd_FlushDsf(pOutput);
+    }
 
-        if (!pOdioLibSacd->cReader.pDff)
-        {
-            printf("PANIC: Failed to initialise reader\n");
+    off_t nFirstBlock = (pOutput->nWriteOffset - pOutput->nOutFill) / DSF_BLOCK_SIZE;
 
-            return 0;
-        }
-   }
-   else if (m_nMediaType == DSF_TYPE)
-   {
-        pOdioLibSacd->cReader.pDsf = dsf_New();
+    for (int i = 0; i < nFrames;)
+    {
+        int nRun = MIN(nFrames - i, DSF_BLOCK_SIZE - (int)(pOutput->nWriteOffset % DSF_BLOCK_SIZE));
+        uint8_t *pBlock = pOutput->lOutBuf + (pOutput->nWriteOffset / DSF_BLOCK_SIZE - nFirstBlock) * nGroupSize + pOutput->nWriteOffset % DSF_BLOCK_SIZE;
 
-        if (!pOdioLibSacd->cReader.pDsf)
+        for (int ch = 0; ch < nChannels; ch++)
         {
-            printf("PANIC: Failed to initialise reader\n");
-
-            return 0;
+            for (int j = 0; j < nRun; j++)
+            {
+                pBlock[ch * DSF_BLOCK_SIZE + j] = pOdioLibSacd->lSwapBits[lDsdData[(i + j) * nChannels + ch]];
+            }
         }
+
+        i += nRun;
+        pOutput->nOutFill += nRun;
+        pOutput->nWriteOffset += nRun;
     }
+}
 
-    int nTracks = 0;
+/*
+    Every frame goes into a DSTF chunk padded to an even size, and its offset and size into the DSTI index.
+*/
+static void odiolibsacd_AddDstFrame(PcmOutput *pOutput, uint8_t *lDstData, size_t nDstSize)
+{
+    int nChunkSize = 12 + nDstSize + (nDstSize & 1);
 
-    if (m_nMediaType == ISO_TYPE)
-    {
-        nTracks = disc_Open(pOdioLibSacd->cReader.pDisc, pOdioLibSacd->pMedia);
-    }
-    else if (m_nMediaType == DSDIFF_TYPE)
+    if (pOutput->nOutFill + nChunkSize > OUTPUT_BUFFER_SIZE)
     {
-        nTracks = dff_Open(pOdioLibSacd->cReader.pDff, pOdioLibSacd->pMedia);
+        odiolibsacd_FlushOutput(pOutput);
     }
-    else if (m_nMediaType == DSF_TYPE)
+
+    if (pOutput->nDstFrames == pOutput->nDstIndexFrames)
     {
-        nTracks = dsf_Open(pOdioLibSacd->cReader.pDsf, pOdioLibSacd->pMedia);
+        pOutput->nDstIndexFrames = MAX(2 * pOutput->nDstIndexFrames, 4096);
+        pOutput->lDstIndex = realloc(pOutput->lDstIndex, (size_t)pOutput->nDstIndexFrames * DSTI_ENTRY_SIZE);
     }
 
-    if (nTracks == 0)
-    {
-        printf("PANIC: Failed to parse media\n");
+    uint8_t *pChunk = pOutput->lOutBuf + pOutput->nOutFill;
+    uint8_t *pEntry = pOutput->lDstIndex + (size_t)pOutput->nDstFrames * DSTI_ENTRY_SIZE;
+    memcpy(pChunk, "DSTF", 4);
+    odiolibsacd_PackageLong(pChunk, 4, nDstSize, 8, true);
+    memcpy(pChunk + 12, lDstData, nDstSize);
 
-        return 0;
+    if (nDstSize & 1)
+    {
+        pChunk[12 + nDstSize] = 0;
     }
 
-    return nTracks;
+    odiolibsacd_PackageLong(pEntry, 0, pOutput->nWriteOffset + 12, 8, true);
+    odiolibsacd_PackageLong(pEntry, 8, nDstSize, 4, true);
+    pOutput->nOutFill += nChunkSize;
+    pOutput->nWriteOffset += nChunkSize;
+    pOutput->nDstFrames++;
 }
 
-char* odiolibsacd_Init(OdioLibSacd *pOdioLibSacd, uint32_t nSubsong, int nSampleRate, Area nArea)
+static void odiolibsacd_PackDst(PcmOutput *pOutput, uint8_t *lDsdData, int nBytes)
 {
-    if (pOdioLibSacd->pConverter)
-    {
-        converter_Free(pOdioLibSacd->pConverter);
-        pOdioLibSacd->pConverter = NULL;
-    }
+    uint8_t *lDstData;
+    size_t nDstSize;
 
-    if (pOdioLibSacd->pDecoder)
+    if (nBytes == 0 || !pOutput->pEncoder)
     {
-        decoder_Free(pOdioLibSacd->pDecoder);
-        pOdioLibSacd->pDecoder = NULL;
+        return;
     }
 
-    char *strFileName = NULL;
+    encoder_Encode(pOutput->pEncoder, lDsdData, nBytes, &lDstData, &nDstSize);
 
-    if (m_nMediaType == ISO_TYPE)
+    if (nDstSize > 0)
     {
-        strFileName = disc_SetTrack(pOdioLibSacd->cReader.pDisc, nSubsong, nArea);
-        pOdioLibSacd->nSampleRate = disc_GetSampleRate();
-        pOdioLibSacd->nFrameRate = disc_GetFrameRate();
-        pOdioLibSacd->nChannels = disc_GetChannels(pOdioLibSacd->cReader.pDisc);
+        odiolibsacd_AddDstFrame(pOutput, lDstData, nDstSize);
     }
-    else if (m_nMediaType == DSDIFF_TYPE)
+}
+
+/*
+    Writes the frames the encoder still holds and the DSTI index behind them.
+*/
+static void odiolibsacd_FinishDst(PcmOutput *pOutput)
+{
+    uint8_t *lDstData;
+    size_t nDstSize;
+    uint8_t arrChunk[12];
+
+    if (!pOutput->pEncoder)
     {
-        strFileName = dff_SetTrack(pOdioLibSacd->cReader.pDff, nSubsong);
-        pOdioLibSacd->nSampleRate = dff_GetSampleRate(pOdioLibSacd->cReader.pDff);
-        pOdioLibSacd->nFrameRate = dff_GetFrameRate(pOdioLibSacd->cReader.pDff);
-        pOdioLibSacd->nChannels = dff_GetChannels(pOdioLibSacd->cReader.pDff);
+        return;
     }
-    else if (m_nMediaType == DSF_TYPE)
+
+    do
     {
-        strFileName = dsf_SetTrack(pOdioLibSacd->cReader.pDsf);
-        pOdioLibSacd->nSampleRate = dsf_GetSampleRate(pOdioLibSacd->cReader.pDsf);
-        pOdioLibSacd->nFrameRate = dsf_GetFrameRate();
-        pOdioLibSacd->nChannels = dsf_GetChannels(pOdioLibSacd->cReader.pDsf);
+        encoder_Encode(pOutput->pEncoder, NULL, 0, &lDstData, &nDstSize);
+
+        if (nDstSize > 0)
+        {
+            odiolibsacd_AddDstFrame(pOutput, lDstData, nDstSize);
+        }
     }
+    while (nDstSize > 0);
 
-    pOdioLibSacd->nPcmSamples = m_nSampleRate / pOdioLibSacd->nFrameRate;
+    odiolibsacd_FlushOutput(pOutput);
+    memcpy(arrChunk, "DSTI", 4);
+    odiolibsacd_PackageLong(arrChunk, 4, (uint64_t)pOutput->nDstFrames * DSTI_ENTRY_SIZE, 8, true);
+    odiolibsacd_Write(pOutput, arrChunk, sizeof(arrChunk), pOutput->nWriteOffset);
+    odiolibsacd_Write(pOutput, pOutput->lDstIndex, (size_t)pOutput->nDstFrames * DSTI_ENTRY_SIZE, pOutput->nWriteOffset + sizeof(arrChunk));
+    pOutput->nWriteOffset += sizeof(arrChunk) + (off_t)pOutput->nDstFrames * DSTI_ENTRY_SIZE;
+}
 
-    switch (pOdioLibSacd->nChannels)
+static void odiolibsacd_OnWrite(void *pData)
+{
+    PcmOutput *pOutput = (PcmOutput*)pData;
+    OdioLibSacd *pOdioLibSacd = pOutput->pOdioLibSacd;
+    void *pItem;
+
+    while (ring_Pop(&pOutput->cPcmFull, &pItem))
     {
-        case 1:
-            pOdioLibSacd->nChannelMap = 1<<2;
-            break;
+        PcmFrame *pPcmFrame = (PcmFrame*)pItem;
+        int nFrames = pOdioLibSacd->pSession->bAbort ? 0 : pPcmFrame->nFrames;
+        int nSamples = nFrames * pOdioLibSacd->nChannels;
+        int nBytes = nSamples * pOutput->nSampleBytes;
+
+        if (pOutput->nFormat == FORMAT_DSF)
+        {
+            odiolibsacd_PackDsf(pOutput, pPcmFrame->lDsdData + pPcmFrame->nOffset * pOdioLibSacd->nChannels, nFrames);
+            ring_Push(&pOutput->cPcmFree, pPcmFrame);
+
+            continue;
+        }
+        else if (pOutput->nFormat == FORMAT_DST)
+        {
+            odiolibsacd_PackDst(pOutput, pPcmFrame->lDsdData + pPcmFrame->nOffset * pOdioLibSacd->nChannels, nBytes);
+            ring_Push(&pOutput->cPcmFree, pPcmFrame);
+
+            continue;
+        }
+
+        if (pOutput->nOutFill + nBytes > OUTPUT_BUFFER_SIZE)
+        {
+            odiolibsacd_FlushOutput(pOutput);
+        }
+
+        if (pOutput->nFormat == FORMAT_DFF)
+        {
+            memcpy(pOutput->lOutBuf + pOutput->nOutFill, pPcmFrame->lDsdData + pPcmFrame->nOffset * pOdioLibSacd->nChannels, nBytes);
+        }
+        else if (pOutput->nFormat == FORMAT_FLOAT32)
+        {
+            memcpy(pOutput->lOutBuf + pOutput->nOutFill, pPcmFrame->lPcmData + pPcmFrame->nOffset * pOdioLibSacd->nChannels, nBytes);
+        }
+        else
+        {
+            quantizer_Pack24(pPcmFrame->lPcmData + pPcmFrame->nOffset * pOdioLibSacd->nChannels, pOutput->lOutBuf + pOutput->nOutFill, nSamples);
+        }
+
+        pOutput->nOutFill += nBytes;
+        pOutput->nWriteOffset += nBytes;
+        ring_Push(&pOutput->cPcmFree, pPcmFrame);
+    }
+}
+
+static PcmFrame* odiolibsacd_GetPcmFrame(PcmOutput *pOutput)
+{
+    void *pItem;
+
+    while (!ring_Pop(&pOutput->cPcmFree, &pItem))
+    {
+        pool_StageWait(&pOutput->cWriteStage);
+    }
+
+    return (PcmFrame*)pItem;
+}
+
+void odiolibsacd_WriteData(PcmOutput *pOutput, PcmFrame *pPcmFrame, int nOffset, int nFrames)
+{
+    int nTrim = 0;
+
+    if (pOutput->nSkipFrames > 0)
+    {
+        pOutput->nSkipFrames--;
+        nFrames = 0;
+    }
+
+    if (!pOutput->bTrimmed)
+    {
+        nTrim = 30;
+        pOutput->bTrimmed = true;
+    }
+
+    pPcmFrame->nOffset = nOffset + nTrim;
+    pPcmFrame->nFrames = MAX(nFrames - nTrim, 0);
+    pOutput->nBuffered += pPcmFrame->nFrames;
+    ring_Push(&pOutput->cPcmFull, pPcmFrame);
+
+    if (!pOutput->pOdioLibSacd->bStream)
+    {
+        pool_StageKick(&pOutput->cWriteStage);
+    }
+}
+
+int odiolibsacd_DoOpen(OdioLibSacd *pOdioLibSacd, OdioSacdSession *pSession, char *sPath)
+{
+    pOdioLibSacd->pSession = pSession;
+    pOdioLibSacd->pMedia = NULL;
+    pOdioLibSacd->cReader.pDisc = NULL;
+    pOdioLibSacd->pConverter = NULL;
+    pOdioLibSacd->pDecoder = NULL;
+    atomic_init(&pOdioLibSacd->nProgress, 0);
+
+    for (int i = 0; i < PIPELINE_DEPTH; i++)
+    {
+        pOdioLibSacd->lReadFrames[i].lData = NULL;
+    }
+
+    ring_Init(&pOdioLibSacd->cReadFree, PIPELINE_DEPTH);
+    ring_Init(&pOdioLibSacd->cReadFull, PIPELINE_DEPTH);
+    pool_StageInit(&pOdioLibSacd->cReadStage, odiolibsacd_OnRead, pOdioLibSacd);
+
+    for (int nOutput = 0; nOutput < CONVERTER_MAX_OUTPUTS; nOutput++)
+    {
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+        pOutput->pOdioLibSacd = pOdioLibSacd;
+        pOutput->nPcmSamples = 0;
+        pOutput->nPcmDelta = 0;
+        pOutput->bTrimmed = false;
+        pOutput->lOutBuf = NULL;
+        pOutput->nFile = -1;
+        pOutput->pEncoder = NULL;
+        pOutput->lDstIndex = NULL;
+        pOutput->nDstFrames = 0;
+        pOutput->nDstIndexFrames = 0;
+
+        for (int i = 0; i < PIPELINE_DEPTH; i++)
+        {
+            pOutput->lPcmFrames[i].lPcmData = NULL;
+            pOutput->lPcmFrames[i].lDsdData = NULL;
+        }
+
+        ring_Init(&pOutput->cPcmFree, PIPELINE_DEPTH);
+        ring_Init(&pOutput->cPcmFull, PIPELINE_DEPTH);
+        pool_StageInit(&pOutput->cWriteStage, odiolibsacd_OnWrite, pOutput);
+    }
+
+    pOdioLibSacd->nOutputs = 1;
+    pOdioLibSacd->bStream = false;
+
+    for (int i = 0; i < 256; i++)
+    {
+        pOdioLibSacd->lSwapBits[i] = 0;
+
+        for (int j = 0; j < 8; j++)
+        {
+            pOdioLibSacd->lSwapBits[i] |= ((i >> j) & 1) << (7 - j);
+        }
+    }
+
+    char sExt[4];
+    strncpy(sExt, sPath + (strlen(sPath) - 3), 3);
+    sExt[3] = '\0';
+
+    for (int i = 0; i < 3; ++i)
+    {
+        sExt[i] = tolower(sExt[i]);
+    }
+
+    pOdioLibSacd->nMediaType = UNK_TYPE;
+
+    if (!strcmp(sExt, "iso"))
+    {
+        pOdioLibSacd->nMediaType = ISO_TYPE;
+    }
+    else if (!strcmp(sExt, "dff"))
+    {
+        pOdioLibSacd->nMediaType = DSDIFF_TYPE;
+    }
+    else if (!strcmp(sExt, "dsf"))
+    {
+        pOdioLibSacd->nMediaType = DSF_TYPE;
+    }
+
+    if (pOdioLibSacd->nMediaType == UNK_TYPE)
+    {
+        printf("PANIC: Unknown media format\n");
+        return 0;
+    }
+
+    pOdioLibSacd->pMedia = media_New(sPath);
+
+    if (!pOdioLibSacd->pMedia)
+    {
+        printf("PANIC: Failed to initialise media\n");
+
+        return 0;
+    }
+
+    if (pOdioLibSacd->nMediaType == ISO_TYPE)
+    {
+        pOdioLibSacd->cReader.pDisc = disc_New();
+
+        if (!pOdioLibSacd->cReader.pDisc)
+        {
+            printf("PANIC: Failed to initialise reader\n");
+
+            return 0;
+        }
+    }
+    else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+    {
+        pOdioLibSacd->cReader.pDff = dff_New();
+
+        if (!pOdioLibSacd->cReader.pDff)
+        {
+            printf("PANIC: Failed to initialise reader\n");
+
+            return 0;
+        }
+   }
+   else if (pOdioLibSacd->nMediaType == DSF_TYPE)
+   {
+        pOdioLibSacd->cReader.pDsf = dsf_New();
+
+        if (!pOdioLibSacd->cReader.pDsf)
+        {
+            printf("PANIC: Failed to initialise reader\n");
+
+            return 0;
+        }
+    }
+
+    int nTracks = 0;
+
+    if (pOdioLibSacd->nMediaType == ISO_TYPE)
+    {
+        nTracks = disc_Open(pOdioLibSacd->cReader.pDisc, pOdioLibSacd->pMedia);
+    }
+    else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+    {
+        nTracks = dff_Open(pOdioLibSacd->cReader.pDff, pOdioLibSacd->pMedia);
+    }
+    else if (pOdioLibSacd->nMediaType == DSF_TYPE)
+    {
+        nTracks = dsf_Open(pOdioLibSacd->cReader.pDsf, pOdioLibSacd->pMedia);
+    }
+
+    if (nTracks == 0)
+    {
+        printf("PANIC: Failed to parse media\n");
+
+        return 0;
+    }
+
+    return nTracks;
+}
+
+char* odiolibsacd_Init(OdioLibSacd *pOdioLibSacd, uint32_t nSubsong, OutputTarget *lTargets, int nTargets, Area nArea)
+{
+    if (pOdioLibSacd->pConverter)
+    {
+        converter_Free(pOdioLibSacd->pConverter);
+        pOdioLibSacd->pConverter = NULL;
+    }
+
+    if (pOdioLibSacd->pDecoder)
+    {
+        decoder_Free(pOdioLibSacd->pDecoder);
+        pOdioLibSacd->pDecoder = NULL;
+    }
+
+    char *strFileName = NULL;
+
+    if (pOdioLibSacd->nMediaType == ISO_TYPE)
+    {
+        strFileName = disc_SetTrack(pOdioLibSacd->cReader.pDisc, nSubsong, nArea);
+        pOdioLibSacd->nSampleRate = disc_GetSampleRate();
+        pOdioLibSacd->nFrameRate = disc_GetFrameRate();
+        pOdioLibSacd->nChannels = disc_GetChannels(pOdioLibSacd->cReader.pDisc);
+    }
+    else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+    {
+        strFileName = dff_SetTrack(pOdioLibSacd->cReader.pDff, nSubsong);
+        pOdioLibSacd->nSampleRate = dff_GetSampleRate(pOdioLibSacd->cReader.pDff);
+        pOdioLibSacd->nFrameRate = dff_GetFrameRate(pOdioLibSacd->cReader.pDff);
+        pOdioLibSacd->nChannels = dff_GetChannels(pOdioLibSacd->cReader.pDff);
+    }
+    else if (pOdioLibSacd->nMediaType == DSF_TYPE)
+    {
+        strFileName = dsf_SetTrack(pOdioLibSacd->cReader.pDsf);
+        pOdioLibSacd->nSampleRate = dsf_GetSampleRate(pOdioLibSacd->cReader.pDsf);
+        pOdioLibSacd->nFrameRate = dsf_GetFrameRate();
+        pOdioLibSacd->nChannels = dsf_GetChannels(pOdioLibSacd->cReader.pDsf);
+    }
+
+    switch (pOdioLibSacd->nChannels)
+    {
+        case 1:
+            pOdioLibSacd->nChannelMap = 1<<2;
+            break;
         case 2:
             pOdioLibSacd->nChannelMap = 1<<0 | 1<<1;
             break;
@@ -394,21 +987,126 @@ char* odiolibsacd_Init(OdioLibSacd *pOdioLibSacd, uint32_t nSubsong, int nSample
     }
 
     pOdioLibSacd->nDstBufSize = pOdioLibSacd->nDsdBufSize = pOdioLibSacd->nSampleRate / 8 / pOdioLibSacd->nFrameRate * pOdioLibSacd->nChannels;
-    pOdioLibSacd->lDsdBuf = realloc(pOdioLibSacd->lDsdBuf, pOdioLibSacd->nDsdBufSize * m_nCpus * sizeof(uint8_t));
-    pOdioLibSacd->lDstBuf = realloc(pOdioLibSacd->lDstBuf, pOdioLibSacd->nDstBufSize * m_nCpus * sizeof(uint8_t));
-    pOdioLibSacd->lPcmBuf = realloc(pOdioLibSacd->lPcmBuf, pOdioLibSacd->nChannels * pOdioLibSacd->nPcmSamples * sizeof(float));
-    pOdioLibSacd->pConverter = converter_New();
-    converter_Init(pOdioLibSacd->pConverter, pOdioLibSacd->nChannels, pOdioLibSacd->nFrameRate, pOdioLibSacd->nSampleRate, m_nSampleRate);
 
-    float fPcmOutDelay = converter_GetDelay(pOdioLibSacd->pConverter);
-    pOdioLibSacd->nPcmDelta = (int)(fPcmOutDelay - 0.5f);//  + 0.5f originally
+    ring_Reset(&pOdioLibSacd->cReadFree);
+    ring_Reset(&pOdioLibSacd->cReadFull);
+    pOdioLibSacd->bReadEnd = false;
+    pOdioLibSacd->bFlushing = false;
+    pOdioLibSacd->nReadFrames = 0;
+    pOdioLibSacd->nFramesRead = 0;
+    pOdioLibSacd->nPartFrames = 0;
+    atomic_store(&pOdioLibSacd->nProgress, 0);
+
+    for (int i = 0; i < PIPELINE_DEPTH; i++)
+    {
+        pOdioLibSacd->lReadFrames[i].lData = realloc(pOdioLibSacd->lReadFrames[i].lData, pOdioLibSacd->nDstBufSize * sizeof(uint8_t));
+        ring_Push(&pOdioLibSacd->cReadFree, &pOdioLibSacd->lReadFrames[i]);
+    }
+
+    int lSampleRates[CONVERTER_MAX_OUTPUTS];
+    int nConverted = 0;
+    pOdioLibSacd->nOutputs = nTargets;
+
+    for (int nOutput = 0; nOutput < nTargets; nOutput++)
+    {
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+        pOutput->nFormat = lTargets[nOutput].nFormat;
+
+        if (odiolibsacd_IsDsd(pOutput))
+        {
+            pOutput->nConverterOutput = -1;
+            pOutput->nSampleRate = pOdioLibSacd->nSampleRate;
+            pOutput->nSampleBytes = 1;
+            pOutput->nPcmSamples = pOdioLibSacd->nDsdBufSize / pOdioLibSacd->nChannels;
+        }
+        else
+        {
+            pOutput->nConverterOutput = nConverted;
+            lSampleRates[nConverted++] = lTargets[nOutput].nSampleRate;
+            pOutput->nSampleRate = lTargets[nOutput].nSampleRate;
+            pOutput->nSampleBytes = pOutput->nFormat == FORMAT_FLOAT32 ? 4 : 3;
+            pOutput->nPcmSamples = pOutput->nSampleRate / pOdioLibSacd->nFrameRate;
+        }
+
+        if (!pOdioLibSacd->bStream && !pOutput->lOutBuf)
+        {
+            pOutput->lOutBuf = memAlloc(OUTPUT_BUFFER_SIZE);
+        }
+
+        if (pOutput->nFormat == FORMAT_DST)
+        {
+            if (!pOutput->pEncoder)
+            {
+                pOutput->pEncoder = encoder_New(pOdioLibSacd->pSession->nCpus, 0);
+            }
+
+            if (encoder_Init(pOutput->pEncoder, pOdioLibSacd->nChannels, pOdioLibSacd->nSampleRate, pOdioLibSacd->nFrameRate, pOdioLibSacd->pSession->nDstEffort) != 0)
+            {
+                printf("PANIC: Failed to initialise the DST encoder\n");
+                encoder_Free(pOutput->pEncoder);
+                pOutput->pEncoder = NULL;
+            }
+
+            pOutput->nDstFrames = 0;
+        }
+
+        ring_Reset(&pOutput->cPcmFree);
+        ring_Reset(&pOutput->cPcmFull);
+        pOutput->bTrimmed = odiolibsacd_IsDsd(pOutput);
+        pOutput->nWriteOffset = pOutput->nFormat == FORMAT_DSF ? 0 : odiolibsacd_GetHeaderSize(pOutput);
+        pOutput->nOutFill = 0;
+        pOutput->nSkipFrames = 0;
+        pOutput->nBuffered = 0;
+        pOutput->nPcmDelta = 0;
+
+        for (int i = 0; i < PIPELINE_DEPTH; i++)
+        {
+            if (odiolibsacd_IsDsd(pOutput))
+            {
+                pOutput->lPcmFrames[i].lDsdData = realloc(pOutput->lPcmFrames[i].lDsdData, pOdioLibSacd->nDsdBufSize * sizeof(uint8_t));
+            }
+            else
+            {
+                pOutput->lPcmFrames[i].lPcmData = realloc(pOutput->lPcmFrames[i].lPcmData, pOdioLibSacd->nChannels * pOutput->nPcmSamples * sizeof(float));
+            }
+
+            ring_Push(&pOutput->cPcmFree, &pOutput->lPcmFrames[i]);
+        }
+    }
+
+    if (nConverted > 0)
+    {
+        pOdioLibSacd->pConverter = converter_New();
+
+        if (converter_Init(pOdioLibSacd->pConverter, pOdioLibSacd->nChannels, pOdioLibSacd->nFrameRate, pOdioLibSacd->nSampleRate, lSampleRates, nConverted, pOdioLibSacd->pSession->bSinglePrecision, pOdioLibSacd->pSession->bLockstep) != 0)
+        {
+            converter_Free(pOdioLibSacd->pConverter);
+            pOdioLibSacd->pConverter = NULL;
+
+            return NULL;
+        }
+    }
 
-    if (pOdioLibSacd->nPcmDelta > pOdioLibSacd->nPcmSamples - 1)
+    for (int nOutput = 0; nOutput < nTargets; nOutput++)
     {
-        pOdioLibSacd->nPcmDelta = pOdioLibSacd->nPcmSamples - 1;
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+
+        if (odiolibsacd_IsDsd(pOutput))
+        {
+            continue;
+        }
+
+        float fPcmOutDelay = converter_GetDelay(pOdioLibSacd->pConverter, pOutput->nConverterOutput);
+        pOutput->nPcmDelta = (int)(fPcmOutDelay - 0.5f);//  + 0.5f originally
+
+        if (pOutput->nPcmDelta > pOutput->nPcmSamples - 1)
+        {
+            pOutput->nPcmDelta = pOutput->nPcmSamples - 1;
+        }
     }
 
     pOdioLibSacd->bTrackCompleted = false;
+    pOdioLibSacd->bFailed = false;
 
     return strFileName;
 }
@@ -437,545 +1135,1590 @@ void odiolibsacd_FixPcmStream(OdioLibSacd *pOdioLibSacd, bool bIsEnd, float *pPc
     }
 }
 
-bool odiolibsacd_Decode(OdioLibSacd *pOdioLibSacd, FILE *pFile)
+static void odiolibsacd_GetPcmFrames(OdioLibSacd *pOdioLibSacd, PcmFrame **lPcmFrames)
 {
-    if (pOdioLibSacd->bTrackCompleted)
+    for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
     {
-        return true;
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+        lPcmFrames[nOutput] = odiolibsacd_IsDsd(pOutput) ? NULL : odiolibsacd_GetPcmFrame(pOutput);
     }
+}
 
-    uint8_t *pDsdData;
-    uint8_t *pDstData;
-    size_t nDsdSize = 0;
-    size_t nDstSize = 0;
-    int nThread = 0;
-
-    while (1)
+static void odiolibsacd_WriteDsd(OdioLibSacd *pOdioLibSacd, uint8_t *lDsdData, size_t nDsdSize)
+{
+    for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
     {
-        nThread = pOdioLibSacd->pDecoder ? pOdioLibSacd->pDecoder->nSlot : 0;
-        pDsdData = pOdioLibSacd->lDsdBuf + pOdioLibSacd->nDsdBufSize * nThread;
-        pDstData = pOdioLibSacd->lDstBuf + pOdioLibSacd->nDstBufSize * nThread;
-        nDstSize = pOdioLibSacd->nDstBufSize;
-        FrameType nFrameType;
-        bool bResult = false;
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
 
-        if (m_nMediaType == ISO_TYPE)
+        if (odiolibsacd_IsDsd(pOutput))
         {
-            bResult = disc_ReadFrame(pOdioLibSacd->cReader.pDisc, pDstData, &nDstSize, &nFrameType);
+            PcmFrame *pPcmFrame = odiolibsacd_GetPcmFrame(pOutput);
+            memcpy(pPcmFrame->lDsdData, lDsdData, nDsdSize);
+            odiolibsacd_WriteData(pOutput, pPcmFrame, 0, nDsdSize / pOdioLibSacd->nChannels);
         }
-        else if (m_nMediaType == DSDIFF_TYPE)
+    }
+}
+
+bool odiolibsacd_Decode(OdioLibSacd *pOdioLibSacd)
+{
+    if (pOdioLibSacd->bTrackCompleted)
+    {
+        return true;
+    }
+
+    uint8_t *pDsdData;
+    size_t nDsdSize = 0;
+    size_t nDstSize = 0;
+    PcmFrame *lPcmFrames[CONVERTER_MAX_OUTPUTS];
+    int lPcmSamples[CONVERTER_MAX_OUTPUTS];
+
+    while (!pOdioLibSacd->bFlushing)
+    {
+        ReadFrame *pFrame = odiolibsacd_GetFrame(pOdioLibSacd);
+        atomic_store(&pOdioLibSacd->nProgress, (int)(pFrame->fProgress * 100.0f));
+
+        if (pFrame->bEnd)
+        {
+            odiolibsacd_PutFrame(pOdioLibSacd, pFrame);
+            pOdioLibSacd->bFlushing = true;
+
+            break;
+        }
+
+        nDstSize = pFrame->nSize;
+
+        if (pFrame->nFrameType == FRAME_DST)
+        {
+            if (!pOdioLibSacd->pDecoder)
+            {
+                pOdioLibSacd->pDecoder = decoder_New(pOdioLibSacd->pSession->nCpus, pOdioLibSacd->pSession->nDecodeDepth);
+
+                if (!pOdioLibSacd->pDecoder || decoder_Init(pOdioLibSacd->pDecoder, pOdioLibSacd->nChannels, pOdioLibSacd->nSampleRate, pOdioLibSacd->nFrameRate) != 0)
+                {
+                    printf("PANIC: Failed to initialise the DST decoder\n");
+
+                    if (pOdioLibSacd->pDecoder)
+                    {
+                        decoder_Free(pOdioLibSacd->pDecoder);
+                        pOdioLibSacd->pDecoder = NULL;
+                    }
+
+                    odiolibsacd_PutFrame(pOdioLibSacd, pFrame);
+                    pOdioLibSacd->bFailed = true;
+                    pOdioLibSacd->bTrackCompleted = true;
+
+                    return true;
+                }
+
+                if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+                {
+                    decoder_SetFetch(pOdioLibSacd->pDecoder, odiolibsacd_FetchDst, pOdioLibSacd->cReader.pDff);
+                }
+            }
+
+            if (pFrame->bFetch)
+            {
+                decoder_DecodeFrame(pOdioLibSacd->pDecoder, pFrame->nFrame, &pDsdData, &nDsdSize);
+            }
+            else
+            {
+                decoder_Decode(pOdioLibSacd->pDecoder, pFrame->lData, nDstSize, &pDsdData, &nDsdSize);
+            }
+
+            odiolibsacd_PutFrame(pOdioLibSacd, pFrame);
+            pFrame = NULL;
+        }
+        else
+        {
+            pDsdData = pFrame->lData;
+            nDsdSize = nDstSize;
+        }
+
+        if (nDsdSize > 0)
+        {
+            bool bFirst = pOdioLibSacd->pConverter && !converter_IsConvertCalled(pOdioLibSacd->pConverter);
+            odiolibsacd_GetPcmFrames(pOdioLibSacd, lPcmFrames);
+            odiolibsacd_DoConvert(pOdioLibSacd, pDsdData, nDsdSize, lPcmFrames, lPcmSamples);
+            odiolibsacd_WriteDsd(pOdioLibSacd, pDsdData, nDsdSize);
+
+            if (pFrame)
+            {
+                odiolibsacd_PutFrame(pOdioLibSacd, pFrame);
+            }
+
+            for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
+            {
+                PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+                int nRemoveSamples = 0;
+
+                if (!lPcmFrames[nOutput])
+                {
+                    continue;
+                }
+
+                if (bFirst && !pOutput->bTrimmed)
+                {
+                    nRemoveSamples = pOutput->nPcmDelta;
+                }
+
+                if (nRemoveSamples > 0)
+                {
+                    odiolibsacd_FixPcmStream(pOdioLibSacd, false, lPcmFrames[nOutput]->lPcmData + pOdioLibSacd->nChannels * nRemoveSamples, lPcmSamples[nOutput] - nRemoveSamples);
+                }
+
+                odiolibsacd_WriteData(pOutput, lPcmFrames[nOutput], nRemoveSamples, lPcmSamples[nOutput] - nRemoveSamples);
+            }
+
+            return false;
+        }
+
+        if (pFrame)
+        {
+            odiolibsacd_PutFrame(pOdioLibSacd, pFrame);
+        }
+    }
+
+    pDsdData = NULL;
+    nDstSize = 0;
+
+    if (pOdioLibSacd->pDecoder)
+    {
+        decoder_Decode(pOdioLibSacd->pDecoder, NULL, nDstSize, &pDsdData, &nDsdSize);
+    }
+
+    if (nDsdSize > 0)
+    {
+        odiolibsacd_GetPcmFrames(pOdioLibSacd, lPcmFrames);
+        odiolibsacd_DoConvert(pOdioLibSacd, pDsdData, nDsdSize, lPcmFrames, lPcmSamples);
+        odiolibsacd_WriteDsd(pOdioLibSacd, pDsdData, nDsdSize);
+
+        for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
+        {
+            if (lPcmFrames[nOutput])
+            {
+                odiolibsacd_WriteData(&pOdioLibSacd->lOutputs[nOutput], lPcmFrames[nOutput], 0, lPcmSamples[nOutput]);
+            }
+        }
+
+        return false;
+    }
+
+    bool bTail = false;
+
+    for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
+    {
+        bTail |= pOdioLibSacd->lOutputs[nOutput].nPcmDelta > 0;
+    }
+
+    if (bTail && !pOdioLibSacd->nReadFrames)
+    {
+        odiolibsacd_GetPcmFrames(pOdioLibSacd, lPcmFrames);
+        odiolibsacd_DoConvert(pOdioLibSacd, NULL, 0, lPcmFrames, lPcmSamples);
+
+        for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
+        {
+            PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+
+            if (!lPcmFrames[nOutput])
+            {
+                continue;
+            }
+
+            odiolibsacd_FixPcmStream(pOdioLibSacd, true, lPcmFrames[nOutput]->lPcmData, pOutput->nPcmDelta);
+            odiolibsacd_WriteData(pOutput, lPcmFrames[nOutput], 0, pOutput->nPcmDelta);
+        }
+    }
+
+    pOdioLibSacd->bTrackCompleted = true;
+
+    return true;
+}
+
+static void odiolibsacd_WaitFinished(OdioSacdSession *pSession, bool bTimed)
+{
+    struct timespec cTime;
+    clock_gettime(CLOCK_MONOTONIC, &cTime);
+    cTime.tv_sec += pSession->nProgressInterval / 1000;
+    cTime.tv_nsec += (long)(pSession->nProgressInterval % 1000) * 1000000;
+
+    if (cTime.tv_nsec >= 1000000000)
+    {
+        cTime.tv_sec++;
+        cTime.tv_nsec -= 1000000000;
+    }
+
+    pthread_mutex_lock(&pSession->hMutex);
+
+    while (atomic_load(&pSession->nFinished) != pSession->nParts)
+    {
+        if (!bTimed)
+        {
+            pthread_cond_wait(&pSession->hFinished, &pSession->hMutex);
+        }
+        else if (pthread_cond_timedwait(&pSession->hFinished, &pSession->hMutex, &cTime) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&pSession->hMutex);
+}
+
+static void odiolibsacd_PartFinished(OdioLibSacd *pOdioLibSacd)
+{
+    OdioSacdSession *pSession = pOdioLibSacd->pSession;
+    atomic_store(&pOdioLibSacd->nProgress, 0);
+
+    if (atomic_fetch_add(&pSession->nFinished, 1) + 1 == pSession->nParts)
+    {
+        pthread_mutex_lock(&pSession->hMutex);
+        pthread_cond_broadcast(&pSession->hFinished);
+        pthread_mutex_unlock(&pSession->hMutex);
+    }
+}
+
+void* odiolibsacd_OnProgress(void *pData)
+{
+    OdioSacdSession *pSession = (OdioSacdSession*)pData;
+
+    while(1)
+    {
+        int nFinished = atomic_load(&pSession->nFinished);
+        float fProgress = nFinished * 100.0f;
+
+        for (int i = 0; i < pSession->nThreads; i++)
+        {
+            fProgress += atomic_load(&pSession->lOdioLibSacd[i].nProgress) / 100.0f;
+        }
+
+        pSession->fProgress = MIN(fProgress / (float)pSession->nParts, 100.0f);
+
+        if (pSession->pOnProgress)
+        {
+            if (!pSession->pOnProgress(pSession->fProgress, NULL, -1, pSession->pUserData))
+            {
+                pSession->bAbort = true;
+                odiolibsacd_WaitFinished(pSession, false);
+
+                return 0;
+            }
+        }
+
+        if (nFinished == pSession->nParts)
+        {
+            break;
+        }
+
+        odiolibsacd_WaitFinished(pSession, true);
+    }
+
+    return 0;
+}
+
+static void odiolibsacd_PackageHeader(PcmOutput *pOutput, unsigned char *arrHeader, unsigned int nSize)
+{
+    OdioLibSacd *pOdioLibSacd = pOutput->pOdioLibSacd;
+    unsigned char arrFormat[2] = {0xFE, 0xFF};
+    unsigned char arrSubtype[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+    int nSampleRate = pOutput->nSampleRate;
+    int nBits = pOutput->nSampleBytes * 8;
+
+    if (pOutput->nFormat == FORMAT_FLOAT32)
+    {
+        arrSubtype[0] = 0x03;
+    }
+
+    memcpy (arrHeader, "RIFF", 4);
+    odiolibsacd_PackageInt (arrHeader, 4, nSize - 8, 4);
+    memcpy (arrHeader + 8, "WAVE", 4);
+    memcpy (arrHeader + 12, "fmt ", 4);
+    odiolibsacd_PackageInt (arrHeader, 16, 40, 4);
+    memcpy (arrHeader + 20, arrFormat, 2);
+    odiolibsacd_PackageInt (arrHeader, 22, pOdioLibSacd->nChannels, 2);
+    odiolibsacd_PackageInt (arrHeader, 24, nSampleRate, 4);
+    odiolibsacd_PackageInt (arrHeader, 28, (nSampleRate * nBits * pOdioLibSacd->nChannels) / 8, 4);
+    odiolibsacd_PackageInt (arrHeader, 32, pOdioLibSacd->nChannels * pOutput->nSampleBytes, 2);
+    odiolibsacd_PackageInt (arrHeader, 34, nBits, 2);
+    odiolibsacd_PackageInt (arrHeader, 36, 22, 2);
+    odiolibsacd_PackageInt (arrHeader, 38, nBits, 2);
+    odiolibsacd_PackageInt (arrHeader, 40, pOdioLibSacd->nChannelMap, 4);
+    memcpy (arrHeader + 44, arrSubtype, 16);
+    memcpy (arrHeader + 60, "data", 4);
+    odiolibsacd_PackageInt (arrHeader, 64, nSize - 68, 4);
+}
+
+static off_t odiolibsacd_PackageDsf(PcmOutput *pOutput, unsigned char *arrHeader, uint64_t nSamples)
+{
+    int nChannels = pOutput->pOdioLibSacd->nChannels;
+    int nChannelType = nChannels == 6 ? 7 : nChannels == 5 ? 6 : nChannels;
+    off_t nDataSize = (off_t)((nSamples + DSF_BLOCK_SIZE - 1) / DSF_BLOCK_SIZE) * DSF_BLOCK_SIZE * nChannels;
+    memcpy (arrHeader, "DSD ", 4);
+    odiolibsacd_PackageLong (arrHeader, 4, 28, 8, false);
+    odiolibsacd_PackageLong (arrHeader, 12, DSF_HEADER_SIZE + nDataSize, 8, false);
+    odiolibsacd_PackageLong (arrHeader, 20, 0, 8, false);
+    memcpy (arrHeader + 28, "fmt ", 4);
+    odiolibsacd_PackageLong (arrHeader, 32, 52, 8, false);
+    odiolibsacd_PackageLong (arrHeader, 40, 1, 4, false);
+    odiolibsacd_PackageLong (arrHeader, 44, 0, 4, false);
+    odiolibsacd_PackageLong (arrHeader, 48, nChannelType, 4, false);
+    odiolibsacd_PackageLong (arrHeader, 52, nChannels, 4, false);
+    odiolibsacd_PackageLong (arrHeader, 56, pOutput->nSampleRate, 4, false);
+    odiolibsacd_PackageLong (arrHeader, 60, 1, 4, false);
+    odiolibsacd_PackageLong (arrHeader, 64, nSamples * 8, 8, false);
+    odiolibsacd_PackageLong (arrHeader, 72, DSF_BLOCK_SIZE, 4, false);
+    odiolibsacd_PackageLong (arrHeader, 76, 0, 4, false);
+    memcpy (arrHeader + 80, "data", 4);
+    odiolibsacd_PackageLong (arrHeader, 84, 12 + nDataSize, 8, false);
+
+    return DSF_HEADER_SIZE + nDataSize;
+}
+
+/*
+    The DSDIFF header up to the compression type, where DSD and DST files start to differ.
+*/
+static void odiolibsacd_PackageDffSound(PcmOutput *pOutput, unsigned char *arrHeader, uint64_t nFormSize, uint64_t nPropSize)
+{
+    const char *lStereo[2] = {"SLFT", "SRGT"};
+    const char *lMulch[6][6] =
+    {
+        {"C   "},
+        {"MLFT", "MRGT"},
+        {"MLFT", "MRGT", "C   "},
+        {"MLFT", "MRGT", "LS  ", "RS  "},
+        {"MLFT", "MRGT", "C   ", "LS  ", "RS  "},
+        {"MLFT", "MRGT", "C   ", "LFE ", "LS  ", "RS  "}
+    };
+    int nChannels = pOutput->pOdioLibSacd->nChannels;
+    memcpy (arrHeader, "FRM8", 4);
+    odiolibsacd_PackageLong (arrHeader, 4, nFormSize, 8, true);
+    memcpy (arrHeader + 12, "DSD ", 4);
+    memcpy (arrHeader + 16, "FVER", 4);
+    odiolibsacd_PackageLong (arrHeader, 20, 4, 8, true);
+    odiolibsacd_PackageLong (arrHeader, 28, 0x01050000, 4, true);
+    memcpy (arrHeader + 32, "PROP", 4);
+    odiolibsacd_PackageLong (arrHeader, 36, nPropSize, 8, true);
+    memcpy (arrHeader + 44, "SND ", 4);
+    memcpy (arrHeader + 48, "FS  ", 4);
+    odiolibsacd_PackageLong (arrHeader, 52, 4, 8, true);
+    odiolibsacd_PackageLong (arrHeader, 60, pOutput->nSampleRate, 4, true);
+    memcpy (arrHeader + 64, "CHNL", 4);
+    odiolibsacd_PackageLong (arrHeader, 68, 2 + 4 * nChannels, 8, true);
+    odiolibsacd_PackageLong (arrHeader, 76, nChannels, 2, true);
+
+    for (int ch = 0; ch < nChannels; ch++)
+    {
+        memcpy (arrHeader + 78 + 4 * ch, nChannels == 2 ? lStereo[ch] : lMulch[nChannels - 1][ch], 4);
+    }
+}
+
+static off_t odiolibsacd_PackageDff(PcmOutput *pOutput, unsigned char *arrHeader, uint64_t nSamples)
+{
+    int nChannels = pOutput->pOdioLibSacd->nChannels;
+    int nHeaderSize = odiolibsacd_GetHeaderSize(pOutput);
+    int nOffset = 78 + 4 * nChannels;
+    off_t nDataSize = (off_t)nSamples * nChannels;
+    odiolibsacd_PackageDffSound(pOutput, arrHeader, nHeaderSize - 12 + nDataSize + (nDataSize & 1), nHeaderSize - 12 - 44);
+    memcpy (arrHeader + nOffset, "CMPR", 4);
+    odiolibsacd_PackageLong (arrHeader, nOffset + 4, 19, 8, true);
+    memcpy (arrHeader + nOffset + 12, "DSD ", 4);
+    arrHeader[nOffset + 16] = 14;
+    memcpy (arrHeader + nOffset + 17, "not compressed", 14);
+    arrHeader[nOffset + 31] = 0;
+    memcpy (arrHeader + nOffset + 32, "DSD ", 4);
+    odiolibsacd_PackageLong (arrHeader, nOffset + 36, nDataSize, 8, true);
+
+    return nHeaderSize + nDataSize + (nDataSize & 1);
+}
+
+/*
+    A DST file ends with the DSTI index, so its data ends where the index does.
+*/
+static off_t odiolibsacd_PackageDst(PcmOutput *pOutput, unsigned char *arrHeader, off_t nDataEnd)
+{
+    int nHeaderSize = odiolibsacd_GetHeaderSize(pOutput);
+    int nOffset = 78 + 4 * pOutput->pOdioLibSacd->nChannels;
+    off_t nIndexSize = 12 + (off_t)pOutput->nDstFrames * DSTI_ENTRY_SIZE;
+    off_t nFileSize = nDataEnd > 0 ? nDataEnd : nHeaderSize + nIndexSize;
+    odiolibsacd_PackageDffSound(pOutput, arrHeader, nFileSize - 12, nHeaderSize - 30 - 44);
+    memcpy (arrHeader + nOffset, "CMPR", 4);
+    odiolibsacd_PackageLong (arrHeader, nOffset + 4, 16, 8, true);
+    memcpy (arrHeader + nOffset + 12, "DST ", 4);
+    arrHeader[nOffset + 16] = 11;
+    memcpy (arrHeader + nOffset + 17, "DST Encoded", 11);
+    memcpy (arrHeader + nOffset + 28, "DST ", 4);
+    odiolibsacd_PackageLong (arrHeader, nOffset + 32, nFileSize - nIndexSize - (nOffset + 40), 8, true);
+    memcpy (arrHeader + nOffset + 40, "FRTE", 4);
+    odiolibsacd_PackageLong (arrHeader, nOffset + 44, 6, 8, true);
+    odiolibsacd_PackageLong (arrHeader, nOffset + 52, pOutput->nDstFrames, 4, true);
+    odiolibsacd_PackageLong (arrHeader, nOffset + 56, pOutput->pOdioLibSacd->nFrameRate, 2, true);
+
+    return nFileSize;
+}
+
+/*
+    Returns the final file size for data ending at nDataEnd. A zero nDataEnd gives the placeholder header.
+*/
+static off_t odiolibsacd_PackageOutput(PcmOutput *pOutput, unsigned char *arrHeader, off_t nDataEnd)
+{
+    int nChannels = pOutput->pOdioLibSacd->nChannels;
+
+    if (pOutput->nFormat == FORMAT_DSF)
+    {
+        return odiolibsacd_PackageDsf(pOutput, arrHeader, nDataEnd);
+    }
+    else if (pOutput->nFormat == FORMAT_DFF)
+    {
+        return odiolibsacd_PackageDff(pOutput, arrHeader, nDataEnd > 0 ? (nDataEnd - odiolibsacd_GetHeaderSize(pOutput)) / nChannels : 0);
+    }
+    else if (pOutput->nFormat == FORMAT_DST)
+    {
+        return odiolibsacd_PackageDst(pOutput, arrHeader, nDataEnd);
+    }
+
+    unsigned int nSize = nDataEnd > 0 ? nDataEnd - 30 * nChannels * pOutput->nSampleBytes : 0x7fffffff;
+    odiolibsacd_PackageHeader(pOutput, arrHeader, nSize);
+
+    return (off_t)nSize + 68;
+}
+
+static uint32_t odiolibsacd_GetFrameCount(OdioLibSacd *pOdioLibSacd, TrackInfo *pTrackInfo)
+{
+    if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+    {
+        dff_SetTrack(pOdioLibSacd->cReader.pDff, pTrackInfo->nTrack);
+
+        return dff_GetFrameCount(pOdioLibSacd->cReader.pDff);
+    }
+    else if (pOdioLibSacd->nMediaType == DSF_TYPE)
+    {
+        dsf_SetTrack(pOdioLibSacd->cReader.pDsf);
+
+        return dsf_GetFrameCount(pOdioLibSacd->cReader.pDsf);
+    }
+
+    return 0;
+}
+
+/*
+    Estimated decode cost of a track, used to start the longest tracks first so that a long track queued last does not
+    leave one thread running on its own at the end. Multichannel tracks weigh more than stereo ones of the same length.
+*/
+static uint64_t odiolibsacd_GetTrackCost(OdioLibSacd *pOdioLibSacd, TrackInfo *pTrackInfo, uint32_t nFrames)
+{
+    if (pOdioLibSacd->nMediaType == ISO_TYPE)
+    {
+        SacdArea *pSacdArea = disc_GetArea(pOdioLibSacd->cReader.pDisc, pTrackInfo->nArea);
+        int nChannels = pSacdArea ? pSacdArea->pAreaToc->nChannels : 2;
+
+        return (uint64_t)disc_GetTrackFrames(pOdioLibSacd->cReader.pDisc, pTrackInfo->nTrack, pTrackInfo->nArea) * nChannels;
+    }
+
+    return nFrames;
+}
+
+static int odiolibsacd_CompareCost(const void *pA, const void *pB)
+{
+    const TrackInfo *pTrackInfoA = pA;
+    const TrackInfo *pTrackInfoB = pB;
+
+    if (pTrackInfoA->nCost != pTrackInfoB->nCost)
+    {
+        return pTrackInfoA->nCost < pTrackInfoB->nCost ? 1 : -1;
+    }
+
+    if (pTrackInfoA->nTrackInfo != pTrackInfoB->nTrackInfo)
+    {
+        return pTrackInfoA->nTrackInfo - pTrackInfoB->nTrackInfo;
+    }
+
+    return pTrackInfoA->nPart - pTrackInfoB->nPart;
+}
+
+static bool odiolibsacd_SeekPart(OdioLibSacd *pOdioLibSacd, TrackInfo *pTrackInfo)
+{
+    if (pTrackInfo->nParts == 1)
+    {
+        return true;
+    }
+
+    uint32_t nPreroll = 0;
+
+    for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
+    {
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+
+        if (!odiolibsacd_IsDsd(pOutput))
+        {
+            nPreroll = MAX(nPreroll, ((uint32_t)(2 * converter_GetDelay(pOdioLibSacd->pConverter, pOutput->nConverterOutput)) + pOutput->nPcmSamples) / pOutput->nPcmSamples);
+        }
+    }
+
+    uint32_t nFrame = pTrackInfo->nFirstFrame > nPreroll ? pTrackInfo->nFirstFrame - nPreroll : 0;
+    pOdioLibSacd->nPartFrames = pTrackInfo->nFirstFrame - nFrame + pTrackInfo->nFrames;
+
+    if (pTrackInfo->nPart < pTrackInfo->nParts - 1)
+    {
+        pOdioLibSacd->nReadFrames = pOdioLibSacd->nPartFrames;
+    }
+
+    for (int nOutput = 0; nOutput < pOdioLibSacd->nOutputs; nOutput++)
+    {
+        PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+        pOutput->nSkipFrames = pTrackInfo->nFirstFrame - nFrame;
+
+        if (pTrackInfo->nPart == 0)
+        {
+            continue;
+        }
+        else if (pOutput->nFormat == FORMAT_DSF)
+        {
+            pOutput->nWriteOffset = (off_t)pTrackInfo->nFirstFrame * pOutput->nPcmSamples;
+        }
+        else if (pOutput->nFormat == FORMAT_DFF)
+        {
+            pOutput->nWriteOffset = odiolibsacd_GetHeaderSize(pOutput) + (off_t)pTrackInfo->nFirstFrame * pOutput->nPcmSamples * pOdioLibSacd->nChannels;
+        }
+        else
+        {
+            pOutput->bTrimmed = true;
+            pOutput->nWriteOffset = 68 + ((off_t)pTrackInfo->nFirstFrame * pOutput->nPcmSamples - pOutput->nPcmDelta - 30) * pOdioLibSacd->nChannels * pOutput->nSampleBytes;
+        }
+    }
+
+    if (nFrame == 0)
+    {
+        return true;
+    }
+    else if (pOdioLibSacd->nMediaType == DSDIFF_TYPE)
+    {
+        return dff_SeekFrame(pOdioLibSacd->cReader.pDff, nFrame);
+    }
+    else if (pOdioLibSacd->nMediaType == DSF_TYPE)
+    {
+        return dsf_SeekFrame(pOdioLibSacd->cReader.pDsf, nFrame);
+    }
+
+    return false;
+}
+
+static void odiolibsacd_FinishTrack(OdioLibSacd *pOdioLibSacd, TrackOutput *pTrackOutput, int nTrackInfo)
+{
+    OdioSacdSession *pSession = pOdioLibSacd->pSession;
+
+    for (int nOutput = 0; nOutput < pSession->nTargets; nOutput++)
+    {
+        if (pTrackOutput->lFiles[nOutput] != -1)
+        {
+            if (!pSession->bAbort && pTrackOutput->lDataEnds[nOutput] > 0)
+            {
+                PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+                unsigned char arrHeader[HEADER_SIZE_MAX];
+                int nHeaderSize = odiolibsacd_GetHeaderSize(pOutput);
+                off_t nFileSize = odiolibsacd_PackageOutput(pOutput, arrHeader, pTrackOutput->lDataEnds[nOutput]);
+
+                if (pwrite(pTrackOutput->lFiles[nOutput], arrHeader, nHeaderSize, 0) != nHeaderSize || ftruncate(pTrackOutput->lFiles[nOutput], nFileSize) == -1)
+                {
+                    printf("PANIC: Could not trim file end\n");
+                }
+            }
+
+            close(pTrackOutput->lFiles[nOutput]);
+            pTrackOutput->lFiles[nOutput] = -1;
+        }
+
+        if (pTrackOutput->lOutFiles[nOutput])
+        {
+            if (pSession->pOnProgress)
+            {
+                pSession->pOnProgress(pSession->fProgress, pTrackOutput->lOutFiles[nOutput], nTrackInfo, pSession->pUserData);
+            }
+
+            free(pTrackOutput->lOutFiles[nOutput]);
+            pTrackOutput->lOutFiles[nOutput] = NULL;
+        }
+    }
+}
+
+void odiolibsacd_OnDecode(void *pData)
+{
+    OdioLibSacd *pOdioLibSacd = (OdioLibSacd*)pData;
+    OdioSacdSession *pSession = pOdioLibSacd->pSession;
+
+    while(1)
+    {
+        int nQueueHead = atomic_fetch_add(&pSession->nQueueHead, 1);
+
+        if (nQueueHead >= pSession->nQueue)
+        {
+            break;
+        }
+
+        TrackInfo cTrackInfo = pSession->lQueue[nQueueHead];
+
+        TrackOutput *pTrackOutput = &pSession->lOutputs[cTrackInfo.nTrackInfo];
+
+        if (!pSession->bAbort)
+        {
+            char *sTrackName = odiolibsacd_Init(pOdioLibSacd, cTrackInfo.nTrack, pSession->lTargets, pSession->nTargets, cTrackInfo.nArea);
+            bool bOpened = sTrackName != NULL;
+
+            if (!bOpened)
+            {
+                printf("PANIC: Could not initialise track %u\n", cTrackInfo.nTrack + 1);
+            }
+
+            pthread_mutex_lock(&pSession->hMutex);
+
+            for (int nOutput = 0; sTrackName && nOutput < pSession->nTargets; nOutput++)
+            {
+                PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+                char *sOutDir = pSession->lTargets[nOutput].sOutDir;
+
+                if (!pTrackOutput->lOutFiles[nOutput])
+                {
+                    char *sOutFile = malloc(strlen(sOutDir) + strlen(sTrackName) + 1);
+                    strcpy(sOutFile, sOutDir);
+                    strcat(sOutFile, sTrackName);
+                    pTrackOutput->lOutFiles[nOutput] = sOutFile;
+
+                    strcpy(sOutFile + strlen(sOutFile) - 3, odiolibsacd_GetExtension(pOutput->nFormat));
+
+                    pTrackOutput->lFiles[nOutput] = open(sOutFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+                    if (pTrackOutput->lFiles[nOutput] != -1 && pTrackOutput->nFrames > 0 && pOutput->nFormat != FORMAT_DST)
+                    {
+                        fallocate(pTrackOutput->lFiles[nOutput], FALLOC_FL_KEEP_SIZE, 0, odiolibsacd_GetHeaderSize(pOutput) + (off_t)pTrackOutput->nFrames * pOutput->nPcmSamples * pOdioLibSacd->nChannels * pOutput->nSampleBytes);
+                    }
+                }
+
+                pOutput->nFile = pTrackOutput->lFiles[nOutput];
+
+                if (pOutput->nFile == -1)
+                {
+                    printf("PANIC: Could not create \"%s\"\n", pTrackOutput->lOutFiles[nOutput]);
+                    bOpened = false;
+                }
+            }
+
+            pthread_mutex_unlock(&pSession->hMutex);
+
+            if (bOpened && !odiolibsacd_SeekPart(pOdioLibSacd, &cTrackInfo))
+            {
+                printf("PANIC: Failed to seek to frame %u\n", cTrackInfo.nFirstFrame);
+            }
+            else if (bOpened)
+            {
+                for (int nOutput = 0; nOutput < pSession->nTargets && cTrackInfo.nPart == 0; nOutput++)
+                {
+                    PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+                    unsigned char arrHeader[HEADER_SIZE_MAX];
+                    int nHeaderSize = odiolibsacd_GetHeaderSize(pOutput);
+                    odiolibsacd_PackageOutput(pOutput, arrHeader, 0);
+
+                    if (pwrite(pOutput->nFile, arrHeader, nHeaderSize, 0) != nHeaderSize)
+                    {
+                        printf("PANIC: Could not write output file\n");
+                    }
+                }
+
+                bool bDone = false;
+
+                while (!bDone || !pOdioLibSacd->bTrackCompleted)
+                {
+                    if (pSession->bAbort)
+                    {
+                        break;
+                    }
+                    else
+                    {
+                        bDone = odiolibsacd_Decode(pOdioLibSacd);
+                    }
+                }
+
+                pool_StageWait(&pOdioLibSacd->cReadStage);
+
+                if (pOdioLibSacd->bFailed)
+                {
+                    pSession->bFailed = true;
+                }
+
+                for (int nOutput = 0; nOutput < pSession->nTargets; nOutput++)
+                {
+                    PcmOutput *pOutput = &pOdioLibSacd->lOutputs[nOutput];
+                    pool_StageWait(&pOutput->cWriteStage);
+
+                    if (pOutput->nFormat == FORMAT_DST && !pSession->bAbort)
+                    {
+                        odiolibsacd_FinishDst(pOutput);
+                    }
+
+                    odiolibsacd_FlushOutput(pOutput);
+
+                    if (cTrackInfo.nPart == cTrackInfo.nParts - 1)
+                    {
+                        pTrackOutput->lDataEnds[nOutput] = pOutput->nWriteOffset;
+                    }
+                }
+            }
+
+            for (int nOutput = 0; nOutput < pSession->nTargets; nOutput++)
+            {
+                pOdioLibSacd->lOutputs[nOutput].nFile = -1;
+            }
+        }
+
+        if (atomic_fetch_sub(&pTrackOutput->nPending, 1) == 1)
+        {
+            odiolibsacd_FinishTrack(pOdioLibSacd, pTrackOutput, cTrackInfo.nTrackInfo);
+        }
+
+        odiolibsacd_PartFinished(pOdioLibSacd);
+    }
+}
+
+static void odiolibsacd_FreeTargets(OdioSacdSession *pSession)
+{
+    for (int nTarget = 0; nTarget < pSession->nTargets; nTarget++)
+    {
+        free(pSession->lTargets[nTarget].sOutDir);
+    }
+
+    pSession->nTargets = 0;
+}
+
+static void odiolibsacd_FreeSession(OdioSacdSession *pSession)
+{
+    if (pSession->pOdioLibSacd)
+    {
+        odiolibsacd_DoClose(pSession->pOdioLibSacd);
+        free(pSession->pOdioLibSacd);
+    }
+
+    pthread_mutex_destroy(&pSession->hMutex);
+    pthread_cond_destroy(&pSession->hFinished);
+    free(pSession->lTrackInfos);
+    free(pSession->sInPath);
+    odiolibsacd_FreeTargets(pSession);
+    free(pSession);
+}
+
+OdioSacdSession* odiolibsacd_Open(char *sInFile, Area nArea)
+{
+    if (sInFile == NULL)
+    {
+        printf("PANIC: Invalid input file\n");
+
+        return NULL;
+    }
+
+    OdioSacdSession *pSession = malloc(sizeof(OdioSacdSession));
+    pSession->nCpus = MAX(sysconf(_SC_NPROCESSORS_ONLN), 2);
+    pSession->nThreads = 2;
+    pSession->lTrackInfos = NULL;
+    pSession->nTrackInfos = 0;
+    pSession->lQueue = NULL;
+    pSession->nQueue = 0;
+    atomic_init(&pSession->nQueueHead, 0);
+    pSession->lOutputs = NULL;
+    pSession->nParts = 0;
+    pSession->nChunks = 0;
+    pSession->nDecodeDepth = 0;
+    pSession->nDstEffort = 1;
+    pSession->bSinglePrecision = false;
+    pSession->bLockstep = true;
+    pSession->nTargets = 0;
+    pSession->sInPath = NULL;
+    atomic_init(&pSession->nFinished, 0);
+    pSession->nMediaType = UNK_TYPE;
+    pSession->nDsdSampleRate = 0;
+    pSession->nTracks = 0;
+    pSession->pOnProgress = NULL;
+    pSession->pDiscDetails = NULL;
+    pSession->pOdioLibSacd = NULL;
+    pSession->lOdioLibSacd = NULL;
+    pSession->bSameTrackCounts = true;
+    atomic_init(&pSession->bAbort, false);
+    atomic_init(&pSession->bFailed, false);
+    pSession->pUserData = NULL;
+    pSession->fProgress = 0.0;
+    pSession->nProgressInterval = 1000;
+    pthread_mutex_init(&pSession->hMutex, NULL);
+    pthread_condattr_t hAttr;
+    pthread_condattr_init(&hAttr);
+    pthread_condattr_setclock(&hAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&pSession->hFinished, &hAttr);
+    pthread_condattr_destroy(&hAttr);
+
+    pSession->sInPath = realpath(sInFile, NULL);
+    struct stat cStat;
+
+    if(!pSession->sInPath || stat(pSession->sInPath, &cStat) == -1 || !S_ISREG(cStat.st_mode))
+    {
+        printf("PANIC: \"%s\" is not a regular file\n", sInFile);
+        odiolibsacd_FreeSession(pSession);
+
+        return NULL;
+    }
+
+    pSession->pOdioLibSacd = malloc(sizeof(OdioLibSacd));
+
+    if (!odiolibsacd_DoOpen(pSession->pOdioLibSacd, pSession, pSession->sInPath))
+    {
+        odiolibsacd_FreeSession(pSession);
+
+        return NULL;
+    }
+
+    OdioLibSacd *pOdioLibSacd = pSession->pOdioLibSacd;
+    pSession->nMediaType = pOdioLibSacd->nMediaType;
+    pOdioLibSacd->nTwoch = 0;
+    pOdioLibSacd->nMulch = 0;
+
+    if (pSession->nMediaType == ISO_TYPE)
+    {
+        pOdioLibSacd->nTwoch = disc_GetTrackCount(pOdioLibSacd->cReader.pDisc, AREA_TWOCH);
+        pOdioLibSacd->nMulch = disc_GetTrackCount(pOdioLibSacd->cReader.pDisc, AREA_MULCH);
+        pSession->pDiscDetails = disc_GetDiscDetails(pOdioLibSacd->cReader.pDisc);
+        pSession->nDsdSampleRate = disc_GetSampleRate();
+    }
+    else if (pSession->nMediaType == DSDIFF_TYPE)
+    {
+        pOdioLibSacd->nTwoch = dff_GetTrackCount(pOdioLibSacd->cReader.pDff, AREA_TWOCH);
+        pOdioLibSacd->nMulch = dff_GetTrackCount(pOdioLibSacd->cReader.pDff, AREA_MULCH);
+        pSession->nDsdSampleRate = dff_GetSampleRate(pOdioLibSacd->cReader.pDff);
+    }
+    else if (pSession->nMediaType == DSF_TYPE)
+    {
+        pOdioLibSacd->nTwoch = dsf_GetTrackCount(pOdioLibSacd->cReader.pDsf, AREA_TWOCH);
+        pOdioLibSacd->nMulch = dsf_GetTrackCount(pOdioLibSacd->cReader.pDsf, AREA_MULCH);
+        pSession->nDsdSampleRate = dsf_GetSampleRate(pOdioLibSacd->cReader.pDsf);
+    }
+
+    if (nArea == AREA_AUTO)
+    {
+        if (pOdioLibSacd->nMulch > 0 && pOdioLibSacd->nTwoch > 0 && pOdioLibSacd->nMulch != pOdioLibSacd->nTwoch)
+        {
+            nArea = AREA_BOTH;
+            pSession->bSameTrackCounts = false;
+        }
+        else if (pOdioLibSacd->nMulch > 0)
+        {
+            nArea = AREA_MULCH;
+        }
+        else if (pOdioLibSacd->nTwoch > 0)
+        {
+            nArea = AREA_TWOCH;
+        }
+    }
+
+    if (nArea == AREA_MULCH || nArea == AREA_BOTH)
+    {
+        if (nArea == AREA_MULCH && pOdioLibSacd->nMulch == 0)
+        {
+            printf("PANIC: The multichannel area has no tracks\n");
+            odiolibsacd_FreeSession(pSession);
+
+            return NULL;
+        }
+
+        for (int i = 0; i < pOdioLibSacd->nMulch; i++)
+        {
+            pSession->lTrackInfos = realloc(pSession->lTrackInfos, ++pSession->nTrackInfos * sizeof(TrackInfo));
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nArea = AREA_MULCH;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nTrack = i;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nTrackInfo = pSession->nTrackInfos - 1;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nPart = 0;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nParts = 1;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nFirstFrame = 0;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nFrames = 0;
+            pSession->nTracks++;
+        }
+    }
+
+    if (nArea == AREA_TWOCH || nArea == AREA_BOTH)
+    {
+        if (nArea == AREA_TWOCH && pOdioLibSacd->nTwoch == 0)
+        {
+            printf("PANIC: The stereo area has no tracks\n");
+            odiolibsacd_FreeSession(pSession);
+
+            return NULL;
+        }
+
+        for (int i = 0; i < pOdioLibSacd->nTwoch; i++)
+        {
+            pSession->lTrackInfos = realloc(pSession->lTrackInfos, ++pSession->nTrackInfos * sizeof(TrackInfo));
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nArea = AREA_TWOCH;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nTrack = i;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nTrackInfo = pSession->nTrackInfos - 1;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nPart = 0;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nParts = 1;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nFirstFrame = 0;
+            pSession->lTrackInfos[pSession->nTrackInfos - 1].nFrames = 0;
+            pSession->nTracks++;
+        }
+    }
+
+    return pSession;
+}
+
+DiscDetails* odiolibsacd_GetDiscDetails(OdioSacdSession *pSession)
+{
+    if (pSession->nMediaType != ISO_TYPE)
+    {
+        printf("PANIC: Media is not an SACD disc\n");
+
+        return NULL;
+    }
+
+    return pSession->pDiscDetails;
+}
+
+int odiolibsacd_GetTrackCount(OdioSacdSession *pSession, Area nArea)
+{
+    if (nArea == AREA_TWOCH)
+    {
+        return pSession->pOdioLibSacd->nTwoch;
+    }
+    else if (nArea == AREA_MULCH)
+    {
+        return pSession->pOdioLibSacd->nMulch;
+    }
+    else if (nArea == AREA_AUTO)
+    {
+        return pSession->nTracks;
+    }
+
+    printf("PANIC: Invalid area\n");
+
+    return -1;
+}
+
+static char* odiolibsacd_GetOutPath(OdioSacdSession *pSession, char *sOutDir)
+{
+    char *sOutPath;
+
+    if (sOutDir == NULL)
+    {
+        char *pSlashPos = strrchr(pSession->sInPath, '/');
+        sOutPath = strndup(pSession->sInPath, (int)(pSlashPos - pSession->sInPath) + 1);
+    }
+    else
+    {
+        sOutPath = strdup(sOutDir);
+    }
+
+    struct stat cStat;
+
+    if (strlen(sOutPath) == 0 || stat(sOutPath, &cStat) == -1 || !S_ISDIR(cStat.st_mode))
+    {
+        printf("PANIC: Directory \"%s\" does not exist\n", sOutPath);
+        free(sOutPath);
+
+        return NULL;
+    }
+
+    char *sOutPathTmp = sOutPath;
+    sOutPath = realpath(sOutPathTmp, NULL);
+    free(sOutPathTmp);
+
+    if (sOutPath[strlen(sOutPath) - 1] != '/')
+    {
+        sOutPath = realloc(sOutPath, strlen(sOutPath) + 2);
+        strcat(sOutPath, "/");
+    }
+
+    return sOutPath;
+}
+
+bool odiolibsacd_Convert(OdioSacdSession *pSession, char *sOutDir, int nSampleRate, OnProgress pOnProgress, void *pUserData)
+{
+    OutputTarget cTarget = {nSampleRate, FORMAT_INT24, sOutDir};
+
+    return odiolibsacd_ConvertTargets(pSession, &cTarget, 1, pOnProgress, pUserData);
+}
+
+bool odiolibsacd_Extract(OdioSacdSession *pSession, char *sOutDir, OutputFormat nFormat, OnProgress pOnProgress, void *pUserData)
+{
+    if (nFormat != FORMAT_DSF && nFormat != FORMAT_DFF && nFormat != FORMAT_DST)
+    {
+        printf("PANIC: Invalid output format\n");
+
+        return true;
+    }
+
+    OutputTarget cTarget = {0, nFormat, sOutDir};
+
+    return odiolibsacd_ConvertTargets(pSession, &cTarget, 1, pOnProgress, pUserData);
+}
+
+/*
+    Writes every track once per target from a single read and DST decode. Targets writing the same file type need
+    their own directory, since the file names are the same.
+*/
+bool odiolibsacd_ConvertTargets(OdioSacdSession *pSession, OutputTarget *lTargets, int nTargets, OnProgress pOnProgress, void *pUserData)
+{
+    if (nTargets < 1 || nTargets > CONVERTER_MAX_OUTPUTS)
+    {
+        printf("PANIC: Invalid target count\n");
+
+        return true;
+    }
+
+    odiolibsacd_FreeTargets(pSession);
+
+    for (int nTarget = 0; nTarget < nTargets; nTarget++)
+    {
+        OutputFormat nFormat = lTargets[nTarget].nFormat;
+
+        if (nFormat != FORMAT_INT24 && nFormat != FORMAT_FLOAT32 && nFormat != FORMAT_DSF && nFormat != FORMAT_DFF && nFormat != FORMAT_DST)
+        {
+            printf("PANIC: Invalid output format\n");
+            odiolibsacd_FreeTargets(pSession);
+
+            return true;
+        }
+
+        if (nFormat != FORMAT_DSF && nFormat != FORMAT_DFF && nFormat != FORMAT_DST && !odiolibsacd_IsPcmSampleRate(pSession, lTargets[nTarget].nSampleRate))
+        {
+            printf("PANIC: Invalid samplerate\n");
+            odiolibsacd_FreeTargets(pSession);
+
+            return true;
+        }
+
+        char *sOutPath = odiolibsacd_GetOutPath(pSession, lTargets[nTarget].sOutDir);
+
+        if (!sOutPath)
         {
-            bResult = dff_ReadFrame(pOdioLibSacd->cReader.pDff, pDstData, &nDstSize, &nFrameType);
+            odiolibsacd_FreeTargets(pSession);
+
+            return true;
         }
-        else if (m_nMediaType == DSF_TYPE)
+
+        if ((pSession->nMediaType == DSF_TYPE && nFormat == FORMAT_DSF) || (pSession->nMediaType == DSDIFF_TYPE && (nFormat == FORMAT_DFF || nFormat == FORMAT_DST)))
         {
-            bResult = dsf_ReadFrame(pOdioLibSacd->cReader.pDsf, pDstData, &nDstSize, &nFrameType);
+            char *pSlashPos = strrchr(pSession->sInPath, '/');
+
+            if (!strncmp(pSession->sInPath, sOutPath, pSlashPos - pSession->sInPath + 1) && strlen(sOutPath) == (size_t)(pSlashPos - pSession->sInPath + 1))
+            {
+                printf("PANIC: Extracting to \"%s\" would overwrite the input file\n", sOutPath);
+                free(sOutPath);
+                odiolibsacd_FreeTargets(pSession);
+
+                return true;
+            }
         }
 
-        if (bResult)
+        for (int nOther = 0; nOther < nTarget; nOther++)
         {
-            if (nDstSize > 0)
+            if (!strcmp(pSession->lTargets[nOther].sOutDir, sOutPath) && !strcmp(odiolibsacd_GetExtension(pSession->lTargets[nOther].nFormat), odiolibsacd_GetExtension(nFormat)))
             {
-                if (nFrameType == FRAME_INVALID)
-                {
-                    nDstSize = pOdioLibSacd->nDstBufSize;
-                    memset(pDstData, 0x69, nDstSize);
-                }
-
-                if (nFrameType == FRAME_DST)
-                {
-                    if (!pOdioLibSacd->pDecoder)
-                    {
-                        pOdioLibSacd->pDecoder = decoder_New(m_nCpus);
+                printf("PANIC: Targets share the directory \"%s\"\n", sOutPath);
+                free(sOutPath);
+                odiolibsacd_FreeTargets(pSession);
 
-                        if (!pOdioLibSacd->pDecoder || decoder_Init(pOdioLibSacd->pDecoder, pOdioLibSacd->nChannels, pOdioLibSacd->nSampleRate, pOdioLibSacd->nFrameRate) != 0)
-                        {
-                            return true;
-                        }
-                    }
+                return true;
+            }
+        }
 
-                    decoder_Decode(pOdioLibSacd->pDecoder, pDstData, nDstSize, &pDsdData, &nDsdSize);
-                }
-                else
-                {
-                    pDsdData = pDstData;
-                    nDsdSize = nDstSize;
-                }
+        pSession->lTargets[nTarget] = lTargets[nTarget];
+        pSession->lTargets[nTarget].sOutDir = sOutPath;
+        pSession->nTargets++;
+    }
 
-                if (nDsdSize > 0)
-                {
-                    int nRemoveSamples = 0;
+    pSession->pOnProgress = pOnProgress;
+    pSession->pUserData = pUserData;
+    pSession->nFinished = 0;
+    pSession->bAbort = false;
+    pSession->bFailed = false;
+    pSession->fProgress = 0.0;
+    pSession->nQueue = 0;
+    atomic_store(&pSession->nQueueHead, 0);
+    pSession->lQueue = NULL;
+    pSession->lOutputs = malloc(pSession->nTrackInfos * sizeof(TrackOutput));
 
-                    if (pOdioLibSacd->pConverter && !converter_IsConvertCalled(pOdioLibSacd->pConverter))
-                    {
-                        nRemoveSamples = pOdioLibSacd->nPcmDelta;
-                    }
+    int nChunks = pSession->nChunks;
+    bool bDst = false;
 
-                    odiolibsacd_DoConvert(pOdioLibSacd, pDsdData, nDsdSize, pOdioLibSacd->lPcmBuf);
+    // DST frames vary in size, so a DST file can only be written from the start of the track
+    for (int nTarget = 0; nTarget < nTargets; nTarget++)
+    {
+        bDst |= lTargets[nTarget].nFormat == FORMAT_DST;
+    }
 
-                    if (nRemoveSamples > 0)
-                    {
-                        odiolibsacd_FixPcmStream(pOdioLibSacd, false, pOdioLibSacd->lPcmBuf + pOdioLibSacd->nChannels * nRemoveSamples, pOdioLibSacd->nPcmSamples - nRemoveSamples);
-                    }
+    if (nChunks == 0)
+    {
+        nChunks = pSession->nTrackInfos < pool_GetThreads() ? (pool_GetThreads() + pSession->nTrackInfos - 1) / pSession->nTrackInfos : 1;
+    }
 
-                    odiolibsacd_WriteData(pOdioLibSacd, pFile, nRemoveSamples, pOdioLibSacd->nPcmSamples - nRemoveSamples);
+    for (int nTrackInfo = 0; nTrackInfo < pSession->nTrackInfos; nTrackInfo++)
+    {
+        uint32_t nFrames = odiolibsacd_GetFrameCount(pSession->pOdioLibSacd, &pSession->lTrackInfos[nTrackInfo]);
+        uint64_t nCost = odiolibsacd_GetTrackCost(pSession->pOdioLibSacd, &pSession->lTrackInfos[nTrackInfo], nFrames);
+        int nParts = bDst ? 1 : MAX(MIN(nChunks, (int)(nFrames / CHUNK_MIN_FRAMES)), 1);
+        TrackOutput *pOutput = &pSession->lOutputs[nTrackInfo];
+        atomic_init(&pOutput->nPending, nParts);
+        pOutput->nFrames = nFrames;
 
-                    return false;
-                }
-            }
+        for (int nTarget = 0; nTarget < nTargets; nTarget++)
+        {
+            pOutput->lFiles[nTarget] = -1;
+            pOutput->lDataEnds[nTarget] = 0;
+            pOutput->lOutFiles[nTarget] = NULL;
         }
-        else
+
+        pSession->lQueue = realloc(pSession->lQueue, (pSession->nQueue + nParts) * sizeof(TrackInfo));
+
+        for (int nPart = 0; nPart < nParts; nPart++)
         {
-            break;
+            TrackInfo *pTrackInfo = &pSession->lQueue[pSession->nQueue++];
+            *pTrackInfo = pSession->lTrackInfos[nTrackInfo];
+            pTrackInfo->nPart = nPart;
+            pTrackInfo->nParts = nParts;
+            pTrackInfo->nFirstFrame = (uint64_t)nFrames * nPart / nParts;
+            pTrackInfo->nFrames = (uint64_t)nFrames * (nPart + 1) / nParts - pTrackInfo->nFirstFrame;
+            pTrackInfo->nCost = nFrames > 0 ? nCost * pTrackInfo->nFrames / nFrames : nCost;
         }
     }
 
-    pDsdData = NULL;
-    pDstData = NULL;
-    nDstSize = 0;
+    qsort(pSession->lQueue, pSession->nQueue, sizeof(TrackInfo), odiolibsacd_CompareCost);
+    pSession->nParts = pSession->nQueue;
 
-    if (pOdioLibSacd->pDecoder)
+    if (!pSession->bSameTrackCounts)
     {
-        decoder_Decode(pOdioLibSacd->pDecoder, pDstData, nDstSize, &pDsdData, &nDsdSize);
+        printf("WARNING: The multichannel and stereo areas have a different track count: extracting both.\n\n");
     }
 
-    if (nDsdSize > 0)
+    pSession->nThreads = MIN(pool_GetThreads(), pSession->nQueue);
+    pthread_t hThreadProgress;
+    PoolGroup cJobs;
+    pool_GroupInit(&cJobs);
+    pSession->lOdioLibSacd = malloc(pSession->nThreads * sizeof(OdioLibSacd));
+    bool bOpened = true;
+
+    for (int i = 0; i < pSession->nThreads && bOpened; i++)
+    {
+        if (!odiolibsacd_DoOpen(&pSession->lOdioLibSacd[i], pSession, pSession->sInPath))
+        {
+            // Only the slots opened so far, the failed one included, need closing
+            pSession->nThreads = i + 1;
+            bOpened = false;
+        }
+    }
+
+    if (bOpened)
     {
-        odiolibsacd_DoConvert(pOdioLibSacd, pDsdData, nDsdSize, pOdioLibSacd->lPcmBuf);
-        odiolibsacd_WriteData(pOdioLibSacd, pFile, 0, pOdioLibSacd->nPcmSamples);
+        for (int i = 0; i < pSession->nThreads; i++)
+        {
+            pool_SubmitJob(&cJobs, odiolibsacd_OnDecode, &pSession->lOdioLibSacd[i]);
+        }
 
-        return false;
+        pthread_create(&hThreadProgress, NULL, odiolibsacd_OnProgress, pSession);
+        pool_Wait(&cJobs);
+        pthread_join(hThreadProgress, NULL);
     }
 
-    if (pOdioLibSacd->nPcmDelta > 0)
+    for (int i = 0; i < pSession->nThreads; i++)
     {
-        odiolibsacd_DoConvert(pOdioLibSacd, NULL, 0, pOdioLibSacd->lPcmBuf);
-        odiolibsacd_FixPcmStream(pOdioLibSacd, true, pOdioLibSacd->lPcmBuf, pOdioLibSacd->nPcmDelta);
-        odiolibsacd_WriteData(pOdioLibSacd, pFile, 0, pOdioLibSacd->nPcmDelta);
+        odiolibsacd_DoClose(&pSession->lOdioLibSacd[i]);
     }
 
-    pOdioLibSacd->bTrackCompleted = true;
+    free(pSession->lOdioLibSacd);
+    pSession->lOdioLibSacd = NULL;
+    free(pSession->lOutputs);
+    pSession->lOutputs = NULL;
 
-    return true;
+    if (pSession->lQueue)
+    {
+        free(pSession->lQueue);
+        pSession->lQueue = NULL;
+    }
+
+    return !bOpened || pSession->bFailed;
 }
 
-void* odiolibsacd_OnProgress(void *pData)
+OdioSacdTrack* odiolibsacd_OpenTrack(OdioSacdSession *pSession, Area nArea, int nTrack, int nSampleRate)
 {
-    OdioLibSacd *lOdioLibSacd = (OdioLibSacd*)pData;
-
-    while(1)
+    if (!odiolibsacd_IsPcmSampleRate(pSession, nSampleRate))
     {
-        float fProgress = 0;
-
-        for (int i = 0; i < m_nThreads; i++)
-        {
-            fProgress += lOdioLibSacd[i].fProgress;
-        }
+        printf("PANIC: Invalid samplerate\n");
 
-        m_fProgress = MAX(((((float)m_nTracks - (float)MIN(m_nThreads, m_nTracks) - (float)m_nTrackInfos) * 100.0) + fProgress) / (float)m_nTracks, 0);
+        return NULL;
+    }
 
-        if (m_pOnProgress)
+    if (nArea == AREA_AUTO)
+    {
+        if (nTrack < 0 || nTrack >= pSession->nTrackInfos)
         {
-            m_bAbort = !m_pOnProgress(m_fProgress, NULL, -1, m_pUserData);
-
-            if (m_bAbort)
-            {
-                while (m_nFinished != m_nTracks)
-                {
-                    sleep(1);
-                }
+            printf("PANIC: Invalid track\n");
 
-                return 0;
-            }
+            return NULL;
         }
 
-        if (m_nFinished == m_nTracks)
-        {
-            break;
-        }
+        nArea = pSession->lTrackInfos[nTrack].nArea;
+        nTrack = pSession->lTrackInfos[nTrack].nTrack;
+    }
+    else if (nArea != AREA_TWOCH && nArea != AREA_MULCH)
+    {
+        printf("PANIC: Invalid area\n");
 
-        sleep(1);
+        return NULL;
     }
+    else if (nTrack < 0 || nTrack >= odiolibsacd_GetTrackCount(pSession, nArea))
+    {
+        printf("PANIC: Invalid track\n");
 
-    return 0;
-}
+        return NULL;
+    }
 
-void* odiolibsacd_OnDecode(void *pData)
-{
-    OdioLibSacd *pOdioLibSacd = (OdioLibSacd*)pData;
+    OdioSacdTrack *pTrack = malloc(sizeof(OdioSacdTrack));
+    pTrack->pPcmFrame = NULL;
 
-    while(m_nTrackInfos)
+    if (!odiolibsacd_DoOpen(&pTrack->cOdioLibSacd, pSession, pSession->sInPath))
     {
-        pthread_mutex_lock(&m_hMutex);
+        odiolibsacd_DoClose(&pTrack->cOdioLibSacd);
+        free(pTrack);
 
-        TrackInfo cTrackInfo = m_lTrackInfos[0];
+        return NULL;
+    }
 
-        for (int nTrackInfo = 1; nTrackInfo < m_nTrackInfos; nTrackInfo++)
-        {
-             m_lTrackInfos[nTrackInfo - 1] = m_lTrackInfos[nTrackInfo];
-        }
+    pTrack->cOdioLibSacd.bStream = true;
+    OutputTarget cTarget = {nSampleRate, FORMAT_FLOAT32, NULL};
 
-        m_lTrackInfos = realloc(m_lTrackInfos, --m_nTrackInfos * sizeof(TrackInfo));
+    if (!odiolibsacd_Init(&pTrack->cOdioLibSacd, nTrack, &cTarget, 1, nArea))
+    {
+        odiolibsacd_DoClose(&pTrack->cOdioLibSacd);
+        free(pTrack);
 
-        pthread_mutex_unlock(&m_hMutex);
+        return NULL;
+    }
 
-        if (m_bAbort)
-        {
-            m_nFinished++;
+    return pTrack;
+}
 
-            continue;
-        }
+int odiolibsacd_GetTrackChannels(OdioSacdTrack *pTrack)
+{
+    return pTrack->cOdioLibSacd.nChannels;
+}
+
+/*
+    Returns the number of interleaved frames written to lBuffer, 0 once the track has ended or -1 on a decoding error.
+    The last 30 frames of a track are dropped, like the WAV writer does.
+*/
+int odiolibsacd_ReadPcm(OdioSacdTrack *pTrack, float *lBuffer, int nFrames)
+{
+    OdioLibSacd *pOdioLibSacd = &pTrack->cOdioLibSacd;
+    PcmOutput *pOutput = &pOdioLibSacd->lOutputs[0];
+    int nChannels = pOdioLibSacd->nChannels;
+    int nRead = 0;
+
+    if (pOdioLibSacd->bFailed)
+    {
+        return -1;
+    }
 
-        char *sTrackName = odiolibsacd_Init(pOdioLibSacd, cTrackInfo.nTrack, m_nSampleRate, cTrackInfo.nArea);
-        char *strOutFile = malloc(strlen(m_sOutPath) + strlen(sTrackName) + 1);
-        strcpy(strOutFile, m_sOutPath);
-        strcat(strOutFile, sTrackName);
-        unsigned int nSize = 0x7fffffff;
-        unsigned char arrHeader[68];
-        unsigned char arrFormat[2] = {0xFE, 0xFF};
-        unsigned char arrSubtype[16] = {0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
-        memcpy (arrHeader, "RIFF", 4);
-        odiolibsacd_PackageInt (arrHeader, 4, nSize - 8, 4);
-        memcpy (arrHeader + 8, "WAVE", 4);
-        memcpy (arrHeader + 12, "fmt ", 4);
-        odiolibsacd_PackageInt (arrHeader, 16, 40, 4);
-        memcpy (arrHeader + 20, arrFormat, 2);
-        odiolibsacd_PackageInt (arrHeader, 22, pOdioLibSacd->nChannels, 2);
-        odiolibsacd_PackageInt (arrHeader, 24, m_nSampleRate, 4);
-        odiolibsacd_PackageInt (arrHeader, 28, (m_nSampleRate * 24 * pOdioLibSacd->nChannels) / 8, 4);
-        odiolibsacd_PackageInt (arrHeader, 32, pOdioLibSacd->nChannels * 3, 2);
-        odiolibsacd_PackageInt (arrHeader, 34, 24, 2);
-        odiolibsacd_PackageInt (arrHeader, 36, 22, 2);
-        odiolibsacd_PackageInt (arrHeader, 38, 24, 2);
-        odiolibsacd_PackageInt (arrHeader, 40, pOdioLibSacd->nChannelMap, 4);
-        memcpy (arrHeader + 44, arrSubtype, 16);
-        memcpy (arrHeader + 60, "data", 4);
-        odiolibsacd_PackageInt (arrHeader, 64, nSize - 68, 4);
-        FILE *pFile = fopen(strOutFile, "wb");
-        fwrite(arrHeader, 1, 68, pFile);
-
-        bool bDone = false;
-
-        while (!bDone || !pOdioLibSacd->bTrackCompleted)
-        {
-            if (m_bAbort)
+    while (nRead < nFrames)
+    {
+        if (pOutput->nBuffered <= 30)
+        {
+            if (pOdioLibSacd->bTrackCompleted)
             {
                 break;
             }
-            else
+
+            if (odiolibsacd_Decode(pOdioLibSacd) && (pOdioLibSacd->bFailed || !pOdioLibSacd->bTrackCompleted))
             {
-                bDone = odiolibsacd_Decode(pOdioLibSacd, pFile);
+                return -1;
             }
+
+            continue;
         }
 
-        if (!m_bAbort)
+        while (!pTrack->pPcmFrame || pTrack->pPcmFrame->nFrames == 0)
         {
-            nSize = ftell(pFile);
-            nSize -= 30 * pOdioLibSacd->nChannels * 3;
-            odiolibsacd_PackageInt(arrHeader, 4, nSize - 8, 4);
-            odiolibsacd_PackageInt(arrHeader, 64, nSize - 68, 4);
-            fseek(pFile, 0, SEEK_SET);
-            fwrite(arrHeader, 1, 68, pFile);
-            fflush(pFile);
-            int nFile = fileno(pFile);
-            int nResult = ftruncate(nFile, nSize + 68);
+            void *pItem;
 
-            if (nResult == -1)
+            if (pTrack->pPcmFrame)
             {
-                printf("PANIC: Could not trim file end\n");
+                ring_Push(&pOutput->cPcmFree, pTrack->pPcmFrame);
             }
-        }
-
-        fclose(pFile);
 
-        if (m_pOnProgress)
-        {
-            m_pOnProgress(m_fProgress, strOutFile, cTrackInfo.nTrackInfo, m_pUserData);
+            ring_Pop(&pOutput->cPcmFull, &pItem);
+            pTrack->pPcmFrame = (PcmFrame*)pItem;
         }
 
-        free(strOutFile);
-        m_nFinished++;
+        PcmFrame *pPcmFrame = pTrack->pPcmFrame;
+        int nCopy = MIN(nFrames - nRead, MIN(pPcmFrame->nFrames, pOutput->nBuffered - 30));
+        memcpy(lBuffer + nRead * nChannels, pPcmFrame->lPcmData + pPcmFrame->nOffset * nChannels, nCopy * nChannels * sizeof(float));
+        pPcmFrame->nOffset += nCopy;
+        pPcmFrame->nFrames -= nCopy;
+        pOutput->nBuffered -= nCopy;
+        nRead += nCopy;
     }
 
-    return 0;
+    return nRead;
 }
 
-bool odiolibsacd_Open(char *sInFile, Area nArea)
-{
-    m_nCpus = 2;
-    m_nThreads = 2;
-    m_lTrackInfos = NULL;
-    m_nTrackInfos = 0;
-    m_sOutPath = NULL;
-    m_sInPath = NULL;
-    m_nSampleRate = 88200;
-    m_nFinished = 0;
-    m_nTracks = 0;
-    m_pOnProgress = NULL;
-    m_pDiscDetails = NULL;
-    m_pOdioLibSacd = NULL;
-    m_bSameTrackCounts = true;
-    m_bAbort = false;
-    m_pUserData = NULL;
-    m_fProgress = 0.0;
-    pthread_mutex_init(&m_hMutex, NULL);
+/*
+    The share of DST prediction filters read so far whose lookup tables came from the decoder's cache, 0 for a track
+    that is not DST coded.
+*/
+float odiolibsacd_GetTrackDstCoefHitRate(OdioSacdTrack *pTrack)
+{
+    return pTrack->cOdioLibSacd.pDecoder ? decoder_GetCoefCacheHitRate(pTrack->cOdioLibSacd.pDecoder) : 0.0f;
+}
 
-    if (sInFile == NULL)
+void odiolibsacd_CloseTrack(OdioSacdTrack *pTrack)
+{
+    if (pTrack)
     {
-        printf("PANIC: Invalid input file\n");
-
-        return true;
+        odiolibsacd_DoClose(&pTrack->cOdioLibSacd);
+        free(pTrack);
     }
+}
 
-    m_sInPath = realpath(sInFile, NULL);
-    struct stat cStat;
-
-    if(stat(m_sInPath, &cStat) == -1 || !S_ISREG(cStat.st_mode))
+OdioSacdDst* odiolibsacd_OpenDst(int nChannels, int nSampleRate, int nFrameRate)
+{
+    if (nChannels < 1 || nChannels > 6)
     {
-        printf("PANIC: \"%s\" is not a regular file\n", m_sInPath);
-        free(m_sInPath);
+        printf("PANIC: Invalid channel count\n");
 
-        return true;
+        return NULL;
     }
 
-    m_pOdioLibSacd = malloc(sizeof(OdioLibSacd));
-
-    if (!odiolibsacd_DoOpen(m_pOdioLibSacd, m_sInPath))
+    if (nFrameRate <= 0 || nSampleRate < 44100 * 64 || nSampleRate % 44100 != 0 || (nSampleRate / 8) % nFrameRate != 0)
     {
-        free(m_sInPath);
+        printf("PANIC: Invalid samplerate\n");
 
-        return true;
+        return NULL;
     }
 
-    m_pOdioLibSacd->nTwoch = 0;
-    m_pOdioLibSacd->nMulch = 0;
+    OdioSacdDst *pDst = malloc(sizeof(OdioSacdDst));
+    pDst->pDecoder = decoder_New(pool_GetThreads(), 0);
+    pDst->nDsdSize = (size_t)(nSampleRate / 8 / nFrameRate * nChannels);
 
-    if (m_nMediaType == ISO_TYPE)
-    {
-        m_pOdioLibSacd->nTwoch = disc_GetTrackCount(m_pOdioLibSacd->cReader.pDisc, AREA_TWOCH);
-        m_pOdioLibSacd->nMulch = disc_GetTrackCount(m_pOdioLibSacd->cReader.pDisc, AREA_MULCH);
-        m_pDiscDetails = disc_GetDiscDetails(m_pOdioLibSacd->cReader.pDisc);
-    }
-    else if (m_nMediaType == DSDIFF_TYPE)
-    {
-        m_pOdioLibSacd->nTwoch = dff_GetTrackCount(m_pOdioLibSacd->cReader.pDff, AREA_TWOCH);
-        m_pOdioLibSacd->nMulch = dff_GetTrackCount(m_pOdioLibSacd->cReader.pDff, AREA_MULCH);
-    }
-    else if (m_nMediaType == DSF_TYPE)
+    if (decoder_Init(pDst->pDecoder, nChannels, nSampleRate, nFrameRate) != 0)
     {
-        m_pOdioLibSacd->nTwoch = dsf_GetTrackCount(m_pOdioLibSacd->cReader.pDsf, AREA_TWOCH);
-        m_pOdioLibSacd->nMulch = dsf_GetTrackCount(m_pOdioLibSacd->cReader.pDsf, AREA_MULCH);
+        printf("PANIC: Failed to initialise decoder\n");
+        odiolibsacd_CloseDst(pDst);
+
+        return NULL;
     }
 
-    if (nArea == AREA_AUTO)
+    return pDst;
+}
+
+size_t odiolibsacd_GetDsdFrameSize(OdioSacdDst *pDst)
+{
+    return pDst->nDsdSize;
+}
+
+/*
+    A DST frame holds at most a DSD frame and the byte with its header bit, so larger frames never reach the decoder.
+    Their place in the output is filled with silence here, from the next frame to be written on.
+*/
+static int odiolibsacd_SkipOversized(OdioSacdDst *pDst, size_t *lSizes, int nFrames, int nDone, uint8_t *lDsdData)
+{
+    while (nDone < nFrames && lSizes[nDone] > pDst->nDsdSize + 1)
     {
-        if (m_pOdioLibSacd->nMulch > 0 && m_pOdioLibSacd->nTwoch > 0 && m_pOdioLibSacd->nMulch != m_pOdioLibSacd->nTwoch)
-        {
-            nArea = AREA_BOTH;
-            m_bSameTrackCounts = false;
-        }
-        else if (m_pOdioLibSacd->nMulch > 0)
-        {
-            nArea = AREA_MULCH;
-        }
-        else if (m_pOdioLibSacd->nTwoch > 0)
-        {
-            nArea = AREA_TWOCH;
-        }
+        memset(lDsdData + pDst->nDsdSize * nDone++, 0x69, pDst->nDsdSize);
     }
 
-    if (nArea == AREA_MULCH || nArea == AREA_BOTH)
-    {
-        if (nArea == AREA_MULCH && m_pOdioLibSacd->nMulch == 0)
-        {
-            printf("PANIC: The multichannel area has no tracks\n");
-            free(m_sInPath);
-            odiolibsacd_DoClose(m_pOdioLibSacd);
-            free(m_pOdioLibSacd);
+    return nDone;
+}
 
-            return true;
-        }
+int odiolibsacd_DecodeDst(OdioSacdDst *pDst, uint8_t **lFrames, size_t *lSizes, int nFrames, uint8_t *lDsdData)
+{
+    uint8_t *pDsdData;
+    size_t nDsdSize;
+    int nFailed = 0;
+    int nDone = 0;
 
-        for (int i = 0; i < m_pOdioLibSacd->nMulch; i++)
+    for (int i = 0; i < nFrames; i++)
+    {
+        if (lSizes[i] == 0)
         {
-            m_lTrackInfos = realloc(m_lTrackInfos, ++m_nTrackInfos * sizeof(TrackInfo));
-            m_lTrackInfos[m_nTrackInfos - 1].nArea = AREA_MULCH;
-            m_lTrackInfos[m_nTrackInfos - 1].nTrack = i;
-            m_lTrackInfos[m_nTrackInfos - 1].nTrackInfo = m_nTrackInfos - 1;
-            m_nTracks++;
+            printf("PANIC: Empty DST frame\n");
+
+            return -1;
         }
     }
 
-    if (nArea == AREA_TWOCH || nArea == AREA_BOTH)
+    // The decoder hands frames back in order, some frames behind the ones queued, and the rest once it is drained
+    for (int i = 0; i <= nFrames; i++)
     {
-        if (nArea == AREA_MULCH && m_pOdioLibSacd->nMulch == 0)
+        if (i < nFrames && lSizes[i] > pDst->nDsdSize + 1)
         {
-            printf("PANIC: The stereo area has no tracks\n");
-            free(m_sInPath);
-            odiolibsacd_DoClose(m_pOdioLibSacd);
-            free(m_pOdioLibSacd);
+            printf("PANIC: Oversized DST frame - inserting silence\n");
+            nFailed++;
 
-            return true;
+            continue;
         }
 
-        for (int i = 0; i < m_pOdioLibSacd->nTwoch; i++)
+        do
         {
-            m_lTrackInfos = realloc(m_lTrackInfos, ++m_nTrackInfos * sizeof(TrackInfo));
-            m_lTrackInfos[m_nTrackInfos - 1].nArea = AREA_TWOCH;
-            m_lTrackInfos[m_nTrackInfos - 1].nTrack = i;
-            m_lTrackInfos[m_nTrackInfos - 1].nTrackInfo = m_nTrackInfos - 1;
-            m_nTracks++;
+            if (decoder_Decode(pDst->pDecoder, i < nFrames ? lFrames[i] : NULL, i < nFrames ? lSizes[i] : 0, &pDsdData, &nDsdSize) != 0)
+            {
+                nFailed++;
+            }
+
+            if (nDsdSize > 0)
+            {
+                nDone = odiolibsacd_SkipOversized(pDst, lSizes, nFrames, nDone, lDsdData);
+                memcpy(lDsdData + pDst->nDsdSize * nDone++, pDsdData, pDst->nDsdSize);
+            }
         }
+        while (i == nFrames && nDsdSize > 0);
     }
 
-    return false;
+    odiolibsacd_SkipOversized(pDst, lSizes, nFrames, nDone, lDsdData);
+
+    return nFailed;
+}
+
+void odiolibsacd_CloseDst(OdioSacdDst *pDst)
+{
+    decoder_Free(pDst->pDecoder);
+    free(pDst);
 }
 
-DiscDetails* odiolibsacd_GetDiscDetails()
+void odiolibsacd_SetChunks(OdioSacdSession *pSession, int nChunks)
 {
-    if (m_nMediaType != ISO_TYPE)
+    if (nChunks < 0)
     {
-        printf("PANIC: Media is not an SACD disc\n");
+        printf("PANIC: Invalid chunk count\n");
 
-        return NULL;
+        return;
     }
 
-    return m_pDiscDetails;
+    pSession->nChunks = nChunks;
 }
 
-int odiolibsacd_GetTrackCount(Area nArea)
+void odiolibsacd_SetDecodeDepth(OdioSacdSession *pSession, int nFrames)
 {
-    if (nArea == AREA_TWOCH)
-    {
-        return m_pOdioLibSacd->nTwoch;
-    }
-    else if (nArea == AREA_MULCH)
-    {
-        return m_pOdioLibSacd->nMulch;
-    }
-    else if (nArea == AREA_AUTO)
+    if (nFrames < 0)
     {
-        return m_nTracks;
-    }
+        printf("PANIC: Invalid decode depth\n");
 
-    printf("PANIC: Invalid area\n");
+        return;
+    }
 
-    return -1;
+    pSession->nDecodeDepth = nFrames;
 }
 
-bool odiolibsacd_Convert(char *sOutDir, int nSampleRate, OnProgress pOnProgress, void *pUserData)
+/*
+    The DST encoder effort goes from 0, the fastest, to 2, the smallest files.
+*/
+void odiolibsacd_SetDstEffort(OdioSacdSession *pSession, int nEffort)
 {
-    if (m_pOdioLibSacd)
+    if (nEffort < 0 || nEffort > 2)
     {
-        odiolibsacd_DoClose(m_pOdioLibSacd);
-        free(m_pOdioLibSacd);
-        m_pOdioLibSacd = NULL;
-    }
+        printf("PANIC: Invalid DST effort\n");
 
-    if (nSampleRate == 88200 || nSampleRate == 176400)
-    {
-        m_nSampleRate = nSampleRate;
+        return;
     }
-    else
-    {
-        printf("PANIC: Invalid samplerate\n");
 
-        return true;
-    }
+    pSession->nDstEffort = nEffort;
+}
 
-    if (sOutDir == NULL)
-    {
-        char *pSlashPos = strrchr(m_sInPath, '/');
-        m_sOutPath = strndup(m_sInPath, (int)(pSlashPos - m_sInPath) + 1);
-    }
-    else
-    {
-        m_sOutPath = strdup(sOutDir);
-    }
+/*
+    The single precision engine runs the DSD to PCM filters on float tables and buffers instead of double ones. It is
+    faster and stays far below the LSB of 24-bit output (see doc/float32-accuracy.md). The default is double.
+*/
+void odiolibsacd_SetSinglePrecision(OdioSacdSession *pSession, bool bSinglePrecision)
+{
+    pSession->bSinglePrecision = bSinglePrecision;
+}
 
-    struct stat cStat;
+/*
+    In lockstep mode, the default, the converter filters the channels of a track side by side on one thread, up to
+    eight at a time, with the channels in the lanes of the vector registers. Switching it off gives every channel its
+    own task on the worker pool instead. That can finish a single track sooner on an otherwise idle machine with many
+    cores, but takes two to three times the CPU time.
+*/
+void odiolibsacd_SetLockstep(OdioSacdSession *pSession, bool bLockstep)
+{
+    pSession->bLockstep = bLockstep;
+}
 
-    if (strlen(m_sOutPath) == 0 || stat(m_sOutPath, &cStat) == -1 || !S_ISDIR(cStat.st_mode))
+void odiolibsacd_SetProgressInterval(OdioSacdSession *pSession, int nMilliseconds)
+{
+    if (nMilliseconds <= 0)
     {
-        printf("PANIC: Directory \"%s\" does not exist\n", m_sOutPath);
-        free(m_sInPath);
-
-        if (m_sOutPath != NULL)
-        {
-            free(m_sOutPath);
-            m_sOutPath = NULL;
-        }
+        printf("PANIC: Invalid progress interval\n");
 
-        return true;
+        return;
     }
 
-    char *sOutPathTmp = strdup(m_sOutPath);
-    free(m_sOutPath);
-    m_sOutPath = realpath(sOutPathTmp, NULL);
-    free(sOutPathTmp);
+    pSession->nProgressInterval = nMilliseconds;
+}
 
-    if (m_sOutPath[strlen(m_sOutPath) - 1] != '/')
+/*
+    Sets up a one channel converter for the filter chain that a target at nSampleRate would use. The frame rate only
+    sizes the buffers, so the SACD one serves for every input.
+*/
+static Converter* odiolibsacd_NewTargetConverter(OdioSacdSession *pSession, int nSampleRate)
+{
+    if (!odiolibsacd_IsPcmSampleRate(pSession, nSampleRate))
     {
-        m_sOutPath = realloc(m_sOutPath, strlen(m_sOutPath) + 2);
-        strcat(m_sOutPath, "/");
+        return NULL;
     }
 
-    m_pOnProgress = pOnProgress;
-    m_pUserData = pUserData;
+    Converter *pConverter = converter_New();
 
-    if (!m_bSameTrackCounts)
+    if (converter_Init(pConverter, 1, disc_GetFrameRate(), pSession->nDsdSampleRate, &nSampleRate, 1, false, false) != 0)
     {
-        printf("WARNING: The multichannel and stereo areas have a different track count: extracting both.\n\n");
-    }
+        converter_Free(pConverter);
 
-    int nCpus = sysconf(_SC_NPROCESSORS_ONLN);
-
-    if (nCpus > 2)
-    {
-        m_nCpus = nCpus;
+        return NULL;
     }
 
-    m_nThreads = MIN(m_nCpus, m_nTrackInfos);
-    pthread_t hThreadProgress;
-    OdioLibSacd *lOdioLibSacd = malloc(m_nThreads * sizeof(OdioLibSacd));
-    pthread_t *lThreads = malloc(m_nThreads * sizeof(pthread_t));
+    return pConverter;
+}
+
+/*
+    The multiply-adds per output sample and channel of the filter chain that converts the input to nSampleRate, or -1
+    if the rate can not be reached.
+*/
+int odiolibsacd_GetTargetCost(OdioSacdSession *pSession, int nSampleRate)
+{
+    Converter *pConverter = odiolibsacd_NewTargetConverter(pSession, nSampleRate);
 
-    for (int i = 0; i < m_nThreads; i++)
+    if (!pConverter)
     {
-        odiolibsacd_DoOpen(&lOdioLibSacd[i], m_sInPath);
-        pthread_create(&lThreads[i], NULL, odiolibsacd_OnDecode, &lOdioLibSacd[i]);
-        pthread_detach(lThreads[i]);
+        return -1;
     }
 
-    pthread_create(&hThreadProgress, NULL, odiolibsacd_OnProgress, lOdioLibSacd);
-    pthread_join(hThreadProgress, NULL);
-    pthread_mutex_destroy(&m_hMutex);
+    int nCost = converter_GetCost(pConverter, 0);
+    converter_Free(pConverter);
 
-    for (int i = 0; i < m_nThreads; i++)
-    {
-        odiolibsacd_DoClose(&lOdioLibSacd[i]);
-    }
+    return nCost;
+}
 
-    free(lOdioLibSacd);
-    free(lThreads);
+/*
+    The group delay of that chain in samples at nSampleRate, or -1 if the rate can not be reached. The converted files
+    start after the whole samples of this delay, so they line up with the DSD input.
+*/
+float odiolibsacd_GetTargetDelay(OdioSacdSession *pSession, int nSampleRate)
+{
+    Converter *pConverter = odiolibsacd_NewTargetConverter(pSession, nSampleRate);
 
-    if (m_lTrackInfos)
+    if (!pConverter)
     {
-        free(m_lTrackInfos);
+        return -1.0f;
     }
 
-    return false;
+    float fDelay = converter_GetDelay(pConverter, 0);
+    converter_Free(pConverter);
+
+    return fDelay;
 }
 
-void odiolibsacd_Close()
+void odiolibsacd_Close(OdioSacdSession *pSession)
 {
-    if (m_pOdioLibSacd)
+    if (pSession)
     {
-        odiolibsacd_DoClose(m_pOdioLibSacd);
-        free(m_pOdioLibSacd);
-        m_pOdioLibSacd = NULL;
+        odiolibsacd_FreeSession(pSession);
     }
-
-    free(m_sInPath);
-    free(m_sOutPath);
 }
@@ -23,12 +23,66 @@
 #include "reader/disc.h"
 #include "stdbool.h"
 
+typedef struct OdioSacdSession OdioSacdSession;
+typedef struct OdioSacdTrack OdioSacdTrack;
+typedef struct OdioSacdDst OdioSacdDst;
 typedef bool (*OnProgress)(float fProgress, char *sFilePath, int nTrack, void *pUserData);
 
-bool odiolibsacd_Open(char *sInFile, Area nArea);
-DiscDetails* odiolibsacd_GetDiscDetails();
-int odiolibsacd_GetTrackCount(Area nArea);
-bool odiolibsacd_Convert(char *sOutDir, int nSampleRate, OnProgress pOnProgress, void *pUserData);
-void odiolibsacd_Close();
+typedef enum
+{
+    FORMAT_INT24 = 0,
+    FORMAT_FLOAT32 = 1,
+    FORMAT_DSF = 2,
+    FORMAT_DFF = 3,
+    FORMAT_DST = 4
+
+} OutputFormat;
+
+typedef struct
+{
+    int nSampleRate;
+    OutputFormat nFormat;
+    char *sOutDir;
+
+} OutputTarget;
+
+OdioSacdSession* odiolibsacd_Open(char *sInFile, Area nArea);
+DiscDetails* odiolibsacd_GetDiscDetails(OdioSacdSession *pSession);
+int odiolibsacd_GetTrackCount(OdioSacdSession *pSession, Area nArea);
+bool odiolibsacd_Convert(OdioSacdSession *pSession, char *sOutDir, int nSampleRate, OnProgress pOnProgress, void *pUserData);
+bool odiolibsacd_ConvertTargets(OdioSacdSession *pSession, OutputTarget *lTargets, int nTargets, OnProgress pOnProgress, void *pUserData);
+bool odiolibsacd_Extract(OdioSacdSession *pSession, char *sOutDir, OutputFormat nFormat, OnProgress pOnProgress, void *pUserData);
+void odiolibsacd_SetChunks(OdioSacdSession *pSession, int nChunks);
+void odiolibsacd_SetDecodeDepth(OdioSacdSession *pSession, int nFrames);
+void odiolibsacd_SetDstEffort(OdioSacdSession *pSession, int nEffort);
+void odiolibsacd_SetSinglePrecision(OdioSacdSession *pSession, bool bSinglePrecision);
+void odiolibsacd_SetLockstep(OdioSacdSession *pSession, bool bLockstep);
+void odiolibsacd_SetProgressInterval(OdioSacdSession *pSession, int nMilliseconds);
+int odiolibsacd_GetTargetCost(OdioSacdSession *pSession, int nSampleRate);
+float odiolibsacd_GetTargetDelay(OdioSacdSession *pSession, int nSampleRate);
+OdioSacdTrack* odiolibsacd_OpenTrack(OdioSacdSession *pSession, Area nArea, int nTrack, int nSampleRate);
+int odiolibsacd_GetTrackChannels(OdioSacdTrack *pTrack);
+float odiolibsacd_GetTrackDstCoefHitRate(OdioSacdTrack *pTrack);
+int odiolibsacd_ReadPcm(OdioSacdTrack *pTrack, float *lBuffer, int nFrames);
+void odiolibsacd_CloseTrack(OdioSacdTrack *pTrack);
+void odiolibsacd_Close(OdioSacdSession *pSession);
+
+/*
+    Standalone DST decoding, for frames that come from a demuxer of your own.
+
+    odiolibsacd_OpenDst creates a decoder for a stream of nChannels (1 to 6) at the DSD rate nSampleRate (for example
+    2822400) with nFrameRate frames per second (75 on SACD). odiolibsacd_GetDsdFrameSize gives the size of one decoded
+    frame: nSampleRate / 8 / nFrameRate bytes per channel, interleaved byte by byte like a DSDIFF sound chunk.
+
+    odiolibsacd_DecodeDst decodes the nFrames DST frames lFrames[i] of lSizes[i] bytes on the library's worker
+    threads and writes the DSD frames to lDsdData in the same order, nFrames * odiolibsacd_GetDsdFrameSize bytes. It
+    returns the number of frames that could not be decoded, or were larger than a DSD frame plus one byte, and were
+    replaced by silence, or -1 on invalid arguments. Every DST frame is decoded on its own, so a stream can be split
+    into batches of any size. A decoder may be used by one thread at a time.
+*/
+OdioSacdDst* odiolibsacd_OpenDst(int nChannels, int nSampleRate, int nFrameRate);
+size_t odiolibsacd_GetDsdFrameSize(OdioSacdDst *pDst);
+int odiolibsacd_DecodeDst(OdioSacdDst *pDst, uint8_t **lFrames, size_t *lSizes, int nFrames, uint8_t *lDsdData);
+void odiolibsacd_CloseDst(OdioSacdDst *pDst);
 
 #endif
@@ -75,14 +75,34 @@ static bool dff_IdEquals(const char *sId1, const char *sId2)
 
 static uint64_t dff_GetDstForFrame(Dff *pDff, uint32_t nFrame)
 {
-    FrameIndex frame_index;
-    nFrame = MIN(nFrame, (uint32_t)(pDff->nDstSize / sizeof(FrameIndex) - 1));
-    media_Seek(pDff->pMedia, pDff->nDstOffset + nFrame * sizeof(FrameIndex), SEEK_SET);
-    uint64_t cur_offset = media_GetPosition (pDff->pMedia);
-    media_Read(pDff->pMedia, &frame_index, sizeof(FrameIndex));
-    media_Seek(pDff->pMedia, cur_offset, SEEK_SET);
-
-    return hton64(frame_index.nOffset) - sizeof(Chunk);
+    nFrame = MIN(nFrame, pDff->nIndexFrames - 1);
+
+    return pDff->lFrameIndex[nFrame].nOffset - sizeof(Chunk);
+}
+
+/*
+    Keeps the DSTI index in memory, with the offset and length of the DST data of every frame, so a frame can be read
+    or sought to without walking the chunks in front of it.
+*/
+static void dff_LoadFrameIndex(Dff *pDff, uint64_t nSize)
+{
+    uint32_t nFrames = (uint32_t)(nSize / sizeof(FrameIndex));
+    FrameIndex *lFrames = malloc(nFrames * sizeof(FrameIndex));
+    pDff->lFrameIndex = realloc(pDff->lFrameIndex, nFrames * sizeof(DffFrame));
+    pDff->nIndexFrames = 0;
+
+    if (lFrames && pDff->lFrameIndex && media_Read(pDff->pMedia, lFrames, nFrames * sizeof(FrameIndex)) == nFrames * sizeof(FrameIndex))
+    {
+        for (uint32_t i = 0; i < nFrames; i++)
+        {
+            pDff->lFrameIndex[i].nOffset = hton64(lFrames[i].nOffset);
+            pDff->lFrameIndex[i].nLength = hton32(lFrames[i].nLength);
+        }
+
+        pDff->nIndexFrames = nFrames;
+    }
+
+    free(lFrames);
 }
 
 Dff* dff_New()
@@ -91,6 +111,8 @@ Dff* dff_New()
     pDff->nCurrentSubsong = 0;
     pDff->nDstEncoded = 0;
     pDff->lSubsongs = NULL;
+    pDff->lFrameIndex = NULL;
+    pDff->nIndexFrames = 0;
 
     return pDff;
 }
@@ -128,13 +150,18 @@ int dff_GetFrameRate(Dff *pDff)
 
 float dff_GetProgress(Dff *pDff)
 {
+    if (dff_HasFrameIndex(pDff))
+    {
+        return pDff->nEndFrame > pDff->nFirstFrame ? (float)(pDff->nCurrentFrame - pDff->nFirstFrame) * 100.0f / (float)(pDff->nEndFrame - pDff->nFirstFrame) : 100.0f;
+    }
+
     return ((float)(media_GetPosition(pDff->pMedia) - pDff->nCurrentOffset) * 100.0) / (float)pDff->nCurrentSize;
 }
 
 int dff_Open(Dff *pDff, Media *pMedia)
 {
     pDff->pMedia = pMedia;
-    pDff->nDstSize = 0;
+    pDff->nIndexFrames = 0;
     Chunk ck;
     char sId[4];
     uint32_t start_mark_count = 0;
@@ -281,9 +308,9 @@ int dff_Open(Dff *pDff, Media *pMedia)
         }
         else if (dff_IdEquals(ck.sId, "DSTI"))
         {
-            pDff->nDstOffset = media_GetPosition(pDff->pMedia);
-            pDff->nDstSize = hton64(ck.nDataSize);
-            media_Skip(pDff->pMedia, hton64(ck.nDataSize));
+            int64_t nIndexEnd = media_GetPosition(pDff->pMedia) + hton64(ck.nDataSize);
+            dff_LoadFrameIndex(pDff, hton64(ck.nDataSize));
+            media_Seek(pDff->pMedia, nIndexEnd, SEEK_SET);
         }
         else if (dff_IdEquals(ck.sId, "DIIN"))
         {
@@ -381,7 +408,9 @@ bool dff_Close(Dff *pDff)
         free(pDff->lSubsongs);
     }
 
-    pDff->nDstSize = 0;
+    free(pDff->lFrameIndex);
+    pDff->lFrameIndex = NULL;
+    pDff->nIndexFrames = 0;
     pDff->nSubsongs = 0;
 
     return true;
@@ -397,33 +426,21 @@ char* dff_SetTrack(Dff *pDff, uint32_t nTrack)
         uint64_t nOffset = (uint64_t)(t0 * pDff->nFrameRate / pDff->nFrames * pDff->nDataSize);
         uint64_t nSize = (uint64_t)(t1 * pDff->nFrameRate / pDff->nFrames * pDff->nDataSize) - nOffset;
 
-        if (pDff->nDstEncoded)
+        if (dff_HasFrameIndex(pDff))
         {
-            if (pDff->nDstSize > 0)
-            {
-                if ((uint32_t)(t0 * pDff->nFrameRate) < (uint32_t)(pDff->nDstSize / sizeof(FrameIndex) - 1))
-                {
-                    pDff->nCurrentOffset = dff_GetDstForFrame(pDff, (uint32_t)(t0 * pDff->nFrameRate));
-                }
-                else
-                {
-                    pDff->nCurrentOffset = pDff->nDataOffset + nOffset;
-                }
-
-                if ((uint32_t)(t1 * pDff->nFrameRate) < (uint32_t)(pDff->nDstSize / sizeof(FrameIndex) - 1))
-                {
-                    pDff->nCurrentSize = dff_GetDstForFrame(pDff, (uint32_t)(t1 * pDff->nFrameRate)) - pDff->nCurrentOffset;
-                }
-                else
-                {
-                    pDff->nCurrentSize = nSize;
-                }
-            }
-            else
-            {
-                pDff->nCurrentOffset = pDff->nDataOffset + nOffset;
-                pDff->nCurrentSize = nSize;
-            }
+            uint32_t nLast = (uint32_t)(t1 * pDff->nFrameRate);
+
+            // A track that ends at the last indexed frame runs on to the end of the sound data
+            pDff->nEndFrame = nLast < pDff->nIndexFrames - 1 ? nLast : pDff->nIndexFrames;
+            pDff->nFirstFrame = MIN((uint32_t)(t0 * pDff->nFrameRate), pDff->nEndFrame);
+            pDff->nCurrentFrame = pDff->nFirstFrame;
+            pDff->nCurrentOffset = dff_GetDstForFrame(pDff, pDff->nFirstFrame);
+            pDff->nCurrentSize = 0;
+        }
+        else if (pDff->nDstEncoded)
+        {
+            pDff->nCurrentOffset = pDff->nDataOffset + nOffset;
+            pDff->nCurrentSize = nSize;
         }
         else
         {
@@ -437,9 +454,100 @@ char* dff_SetTrack(Dff *pDff, uint32_t nTrack)
     return media_GetFileName(pDff->pMedia);
 }
 
-bool dff_ReadFrame(Dff *pDff, uint8_t *lFrameData, size_t *pFrameSize, FrameType *pFrameType)
+uint32_t dff_GetFrameCount(Dff *pDff)
+{
+    if (!pDff->nDstEncoded)
+    {
+        return (uint32_t)(pDff->nCurrentSize / pDff->nFrameSize);
+    }
+
+    if (pDff->nIndexFrames == 0)
+    {
+        return 0;
+    }
+
+    uint32_t nIndexFrames = pDff->nIndexFrames;
+    uint32_t nFirst = (uint32_t)(pDff->lSubsongs[pDff->nCurrentSubsong].fStartTime * pDff->nFrameRate);
+    uint32_t nLast = MIN((uint32_t)(pDff->lSubsongs[pDff->nCurrentSubsong].fStopTime * pDff->nFrameRate), nIndexFrames - 1);
+
+    if (nFirst + 1 >= nIndexFrames || nLast <= nFirst)
+    {
+        return 0;
+    }
+
+    return nLast - nFirst;
+}
+
+bool dff_SeekFrame(Dff *pDff, uint32_t nFrame)
 {
     if (pDff->nDstEncoded)
+    {
+        if (pDff->nIndexFrames == 0)
+        {
+            return false;
+        }
+
+        pDff->nCurrentFrame = MIN(pDff->nFirstFrame + nFrame, pDff->nEndFrame);
+
+        return true;
+    }
+
+    return media_Seek(pDff->pMedia, pDff->nCurrentOffset + (uint64_t)nFrame * pDff->nFrameSize, SEEK_SET);
+}
+
+bool dff_HasFrameIndex(Dff *pDff)
+{
+    return pDff->nDstEncoded && pDff->nIndexFrames > 0;
+}
+
+/*
+    Moves past the next DST frame of the track without reading it and gives its number and size, for callers that
+    read the frame later with dff_ReadDstFrame.
+*/
+bool dff_NextDstFrame(Dff *pDff, uint32_t *pFrame, size_t *pFrameSize)
+{
+    if (pDff->nCurrentFrame >= pDff->nEndFrame)
+    {
+        return false;
+    }
+
+    *pFrame = pDff->nCurrentFrame++;
+    *pFrameSize = pDff->lFrameIndex[*pFrame].nLength;
+
+    return true;
+}
+
+/*
+    Reads DST frame nFrame of the file from where the index puts it. The file position is left alone, so decoder
+    workers can each read their own frames while the reader goes on.
+*/
+bool dff_ReadDstFrame(Dff *pDff, uint32_t nFrame, uint8_t *lFrameData, size_t *pFrameSize)
+{
+    if (nFrame >= pDff->nIndexFrames || pDff->lFrameIndex[nFrame].nLength > *pFrameSize)
+    {
+        return false;
+    }
+
+    *pFrameSize = pDff->lFrameIndex[nFrame].nLength;
+
+    return media_ReadAt(pDff->pMedia, lFrameData, *pFrameSize, pDff->lFrameIndex[nFrame].nOffset) == *pFrameSize;
+}
+
+bool dff_ReadFrame(Dff *pDff, uint8_t *lFrameData, size_t *pFrameSize, FrameType *pFrameType)
+{
+    if (dff_HasFrameIndex(pDff))
+    {
+        uint32_t nFrame;
+        size_t nFrameSize;
+
+        if (dff_NextDstFrame(pDff, &nFrame, &nFrameSize) && dff_ReadDstFrame(pDff, nFrame, lFrameData, pFrameSize))
+        {
+            *pFrameType = FRAME_DST;
+
+            return true;
+        }
+    }
+    else if (pDff->nDstEncoded)
     {
         Chunk ck;
 
@@ -477,7 +585,7 @@ bool dff_ReadFrame(Dff *pDff, uint8_t *lFrameData, size_t *pFrameSize, FrameType
             }
             else
             {
-                media_Seek(pDff->pMedia, 1 - (int)sizeof(ck), SEEK_CUR);
+                media_Skip(pDff->pMedia, hton64(ck.nDataSize) + (hton64(ck.nDataSize) & 1));
             }
         }
     }
@@ -31,14 +31,21 @@ typedef struct
 
 } Subsong;
 
+typedef struct
+{
+    uint64_t nOffset;
+    uint32_t nLength;
+
+} DffFrame;
+
 typedef struct
 {
     Media* pMedia;
     uint32_t nSampleRate;
     uint16_t nChannels;
     int nDstEncoded;
-    uint64_t nDstOffset;
-    uint64_t nDstSize;
+    DffFrame *lFrameIndex;
+    uint32_t nIndexFrames;
     uint64_t nDataOffset;
     uint64_t nDataSize;
     uint16_t nFrameRate;
@@ -49,6 +56,9 @@ typedef struct
     uint32_t nCurrentSubsong;
     uint64_t nCurrentOffset;
     uint64_t nCurrentSize;
+    uint32_t nFirstFrame;
+    uint32_t nEndFrame;
+    uint32_t nCurrentFrame;
 
 } Dff;
 
@@ -62,6 +72,11 @@ float dff_GetProgress(Dff *pDff);
 int dff_Open(Dff *pDff, Media *pMedia);
 bool dff_Close(Dff *pDff);
 char* dff_SetTrack(Dff *pDff, uint32_t nTrack);
+uint32_t dff_GetFrameCount(Dff *pDff);
+bool dff_SeekFrame(Dff *pDff, uint32_t nFrame);
 bool dff_ReadFrame(Dff *pDff, uint8_t *lFrameData, size_t *nFrameSize, FrameType *nFrameType);
+bool dff_HasFrameIndex(Dff *pDff);
+bool dff_NextDstFrame(Dff *pDff, uint32_t *pFrame, size_t *pFrameSize);
+bool dff_ReadDstFrame(Dff *pDff, uint32_t nFrame, uint8_t *lFrameData, size_t *pFrameSize);
 
 #endif
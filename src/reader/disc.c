@@ -284,6 +284,7 @@ static bool disc_ReadAreaToc(Disc *pDisc, int area_idx)
 
     p = pAreaData = pSacdArea->pAreaData;
     pAreaToc = pSacdArea->pAreaToc = (AreaToc*)pAreaData;
+    pSacdArea->pAreaTracklistTime = NULL;
 
     if (strncmp("TWOCHTOC", pAreaToc->sId, 8) == 0)
     {
@@ -781,6 +782,24 @@ uint32_t disc_GetTrackCount(Disc *pDisc, Area nArea)
     return 0;
 }
 
+/*
+    The SACDTRL2 list of the area TOC holds the duration of every track as an m:s:f time code, which lets a track be
+    sized without reading it.
+*/
+uint32_t disc_GetTrackFrames(Disc *pDisc, uint32_t nTrack, Area nArea)
+{
+    SacdArea *pSacdArea = disc_GetArea(pDisc, nArea);
+
+    if (!pSacdArea || !pSacdArea->pAreaTracklistTime || nTrack >= pSacdArea->pAreaToc->nTrackCount)
+    {
+        return 0;
+    }
+
+    AreaTracklistTimeDuration *pDuration = &pSacdArea->pAreaTracklistTime->lAreaTracklistTimeDuration[nTrack];
+
+    return (pDuration->nMinutes * 60 + pDuration->nSeconds) * disc_GetFrameRate() + pDuration->nFrames;
+}
+
 int disc_GetChannels(Disc *pDisc)
 {
     return disc_GetArea(pDisc, pDisc->nArea) ? disc_GetArea(pDisc, pDisc->nArea)->pAreaToc->nChannels : 0;
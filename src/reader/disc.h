@@ -81,6 +81,7 @@ Disc* disc_New();
 void disc_Free(Disc *pDisc);
 SacdArea* disc_GetArea(Disc *pDisc, Area nArea);
 uint32_t disc_GetTrackCount(Disc *pDisc, Area nArea);
+uint32_t disc_GetTrackFrames(Disc *pDisc, uint32_t nTrack, Area nArea);
 int disc_GetChannels(Disc *pDisc);
 int disc_GetSampleRate();
 int disc_GetFrameRate();
@@ -193,10 +193,44 @@ int dsf_Open(Dsf *pDsf, Media* pMedia)
 char* dsf_SetTrack(Dsf *pDsf)
 {
     media_Seek(pDsf->pMedia, pDsf->nDataOffset, SEEK_SET);
+    pDsf->nBlockOffset = pDsf->nBlockSize;
+    pDsf->nBlockDataEnd = 0;
 
     return media_GetFileName(pDsf->pMedia);
 }
 
+static int dsf_ReadBlock(Dsf *pDsf)
+{
+    int64_t nRemaining = (int64_t)pDsf->nDataEndOffset - media_GetPosition(pDsf->pMedia);
+    int nBlockDataEnd = (int)MIN(nRemaining, (int64_t)(pDsf->nChannels * pDsf->nBlockSize));
+
+    if (nBlockDataEnd <= 0)
+    {
+        return 0;
+    }
+
+    // The last group is zero padded to whole blocks, so read all of it to get the tail of every channel
+    int nRead = (int)media_Read(pDsf->pMedia, pDsf->lBlockData, pDsf->nChannels * pDsf->nBlockSize);
+
+    return MIN(nBlockDataEnd, nRead);
+}
+
+uint32_t dsf_GetFrameCount(Dsf *pDsf)
+{
+    return (uint32_t)(pDsf->nSamples / 8 / (pDsf->nSampleRate / 8 / dsf_GetFrameRate()));
+}
+
+bool dsf_SeekFrame(Dsf *pDsf, uint32_t nFrame)
+{
+    uint64_t nOffset = (uint64_t)nFrame * (pDsf->nSampleRate / 8 / dsf_GetFrameRate());
+
+    media_Seek(pDsf->pMedia, pDsf->nDataOffset + (nOffset / pDsf->nBlockSize) * pDsf->nBlockSize * pDsf->nChannels, SEEK_SET);
+    pDsf->nBlockDataEnd = dsf_ReadBlock(pDsf);
+    pDsf->nBlockOffset = nOffset % pDsf->nBlockSize;
+
+    return pDsf->nBlockDataEnd > 0;
+}
+
 bool dsf_ReadFrame(Dsf *pDsf, uint8_t *lFrameData, size_t *nFrameSize, FrameType *nFrameType)
 {
     int samples_read = 0;
@@ -205,12 +239,7 @@ bool dsf_ReadFrame(Dsf *pDsf, uint8_t *lFrameData, size_t *nFrameSize, FrameType
     {
         if (pDsf->nBlockOffset * pDsf->nChannels >= pDsf->nBlockDataEnd)
         {
-                pDsf->nBlockDataEnd = (int)MIN(pDsf->nDataEndOffset - media_GetPosition(pDsf->pMedia), (uint64_t)(pDsf->nChannels * pDsf->nBlockSize));
-
-            if (pDsf->nBlockDataEnd > 0)
-            {
-                pDsf->nBlockDataEnd = media_Read(pDsf->pMedia, pDsf->lBlockData, pDsf->nBlockDataEnd);
-            }
+            pDsf->nBlockDataEnd = dsf_ReadBlock(pDsf);
 
             if (pDsf->nBlockDataEnd > 0)
             {
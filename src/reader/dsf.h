@@ -53,6 +53,8 @@ int dsf_GetFrameRate();
 float dsf_GetProgress(Dsf *pDsf);
 int dsf_Open(Dsf *pDsf, Media* pMedia);
 char* dsf_SetTrack(Dsf *pDsf);
+uint32_t dsf_GetFrameCount(Dsf *pDsf);
+bool dsf_SeekFrame(Dsf *pDsf, uint32_t nFrame);
 bool dsf_ReadFrame(Dsf *pDsf, uint8_t* lFrameData, size_t* nFrameSize, FrameType* nFrameType);
 
 #endif
@@ -21,6 +21,7 @@
 #include "media.h"
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 
@@ -63,13 +64,32 @@ size_t media_Read(Media *pMedia, void *lData, size_t nSize)
     return fread(lData, 1, nSize, pMedia->pFile);
 }
 
+/*
+    Reads at nPosition without moving the file position, so any thread can read while another one walks the file.
+*/
+size_t media_ReadAt(Media *pMedia, void *lData, size_t nSize, int64_t nPosition)
+{
+    ssize_t nRead = pread(fileno(pMedia->pFile), lData, nSize, nPosition);
+
+    return nRead > 0 ? (size_t)nRead : 0;
+}
+
 int64_t media_Skip(Media *pMedia, int64_t nBytes)
 {
     return fseek(pMedia->pFile, nBytes, SEEK_CUR);
 }
 
+/*
+    The name only depends on the path, so it is built on the first call and every later part of the track gets the
+    same string back.
+*/
 char* media_GetFileName(Media *pMedia)
 {
+    if (pMedia->sFileName)
+    {
+        return pMedia->sFileName;
+    }
+
     char *pSlashPos = strrchr(pMedia->sFilePath, '/') + 1;
     pMedia->sFileName = strdup(pSlashPos);
     int nLen = strlen(pMedia->sFileName);
@@ -38,6 +38,7 @@ void media_Free(Media *pMedia);
 bool media_Seek(Media *pMedia, int64_t nPosition, int nMode);
 int64_t media_GetPosition(Media *pMedia);
 size_t media_Read(Media *pMedia, void *data, size_t nSize);
+size_t media_ReadAt(Media *pMedia, void *lData, size_t nSize, int64_t nPosition);
 int64_t media_Skip(Media *pMedia, int64_t nBytes);
 char* media_GetFileName(Media *pMedia);
 
@@ -0,0 +1,354 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "pool.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+
+typedef struct
+{
+    int nThreads;
+    pthread_t *lThreads;
+    PoolQueue *lQueues;
+    PoolQueue cShared;
+    PoolQueue cJobs;
+    pthread_mutex_t hMutex;
+    pthread_cond_t hEventWork;
+    pthread_cond_t hEventWait;
+    atomic_uint nEpoch;
+    atomic_int nIdle;
+    atomic_int nWaiting;
+
+} Pool;
+
+static Pool m_cPool;
+static pthread_once_t m_hPoolOnce = PTHREAD_ONCE_INIT;
+static _Thread_local int m_nWorker = -1;
+
+static void pool_InitQueue(PoolQueue *pQueue)
+{
+    pQueue->nSize = 64;
+    pQueue->lTasks = malloc(pQueue->nSize * sizeof(PoolTask));
+    pQueue->nHead = 0;
+    atomic_init(&pQueue->nCount, 0);
+    pthread_mutex_init(&pQueue->hMutex, NULL);
+}
+
+static void pool_Push(PoolQueue *pQueue, PoolTask *pTask)
+{
+    pthread_mutex_lock(&pQueue->hMutex);
+
+    int nCount = atomic_load_explicit(&pQueue->nCount, memory_order_relaxed);
+
+    if (nCount == pQueue->nSize)
+    {
+        PoolTask *lTasks = malloc(pQueue->nSize * 2 * sizeof(PoolTask));
+
+        for (int i = 0; i < nCount; i++)
+        {
+            lTasks[i] = pQueue->lTasks[(pQueue->nHead + i) & (pQueue->nSize - 1)];
+        }
+
+        free(pQueue->lTasks);
+        pQueue->lTasks = lTasks;
+        pQueue->nHead = 0;
+        pQueue->nSize *= 2;
+    }
+
+    pQueue->lTasks[(pQueue->nHead + nCount) & (pQueue->nSize - 1)] = *pTask;
+    atomic_store(&pQueue->nCount, nCount + 1);
+    pthread_mutex_unlock(&pQueue->hMutex);
+}
+
+static bool pool_Pop(PoolQueue *pQueue, PoolTask *pTask, bool bTail)
+{
+    if (atomic_load_explicit(&pQueue->nCount, memory_order_relaxed) == 0)
+    {
+        return false;
+    }
+
+    bool bFound = false;
+
+    pthread_mutex_lock(&pQueue->hMutex);
+
+    int nCount = atomic_load_explicit(&pQueue->nCount, memory_order_relaxed);
+
+    if (nCount > 0)
+    {
+        if (bTail)
+        {
+            *pTask = pQueue->lTasks[(pQueue->nHead + nCount - 1) & (pQueue->nSize - 1)];
+        }
+        else
+        {
+            *pTask = pQueue->lTasks[pQueue->nHead];
+            pQueue->nHead = (pQueue->nHead + 1) & (pQueue->nSize - 1);
+        }
+
+        atomic_store(&pQueue->nCount, nCount - 1);
+        bFound = true;
+    }
+
+    pthread_mutex_unlock(&pQueue->hMutex);
+
+    return bFound;
+}
+
+static void pool_Notify(bool bWork)
+{
+    atomic_fetch_add(&m_cPool.nEpoch, 1);
+
+    if (bWork && atomic_load(&m_cPool.nIdle) > 0)
+    {
+        pthread_mutex_lock(&m_cPool.hMutex);
+        pthread_cond_signal(&m_cPool.hEventWork);
+        pthread_mutex_unlock(&m_cPool.hMutex);
+    }
+    else if (atomic_load(&m_cPool.nWaiting) > 0)
+    {
+        pthread_mutex_lock(&m_cPool.hMutex);
+        pthread_cond_broadcast(&m_cPool.hEventWait);
+        pthread_mutex_unlock(&m_cPool.hMutex);
+    }
+}
+
+static bool pool_RunTask(bool bJobs)
+{
+    PoolTask cTask;
+    bool bFound = false;
+
+    if (m_nWorker != -1)
+    {
+        bFound = pool_Pop(&m_cPool.lQueues[m_nWorker], &cTask, true);
+    }
+
+    if (!bFound)
+    {
+        bFound = pool_Pop(&m_cPool.cShared, &cTask, false);
+    }
+
+    for (int i = 1; !bFound && i <= m_cPool.nThreads; i++)
+    {
+        int nVictim = (m_nWorker + i) % m_cPool.nThreads;
+
+        if (nVictim != m_nWorker)
+        {
+            bFound = pool_Pop(&m_cPool.lQueues[nVictim], &cTask, false);
+        }
+    }
+
+    if (!bFound && bJobs)
+    {
+        bFound = pool_Pop(&m_cPool.cJobs, &cTask, false);
+    }
+
+    if (!bFound)
+    {
+        return false;
+    }
+
+    cTask.pFunc(cTask.pData);
+
+    if (cTask.pGroup && atomic_fetch_sub(&cTask.pGroup->nPending, 1) == 1)
+    {
+        pool_Notify(false);
+    }
+
+    return true;
+}
+
+static void* pool_OnWork(void *pData)
+{
+    m_nWorker = (int)(intptr_t)pData;
+
+    while (1)
+    {
+        unsigned int nEpoch = atomic_load(&m_cPool.nEpoch);
+
+        if (pool_RunTask(true))
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&m_cPool.hMutex);
+        atomic_fetch_add(&m_cPool.nIdle, 1);
+
+        while (atomic_load(&m_cPool.nEpoch) == nEpoch)
+        {
+            pthread_cond_wait(&m_cPool.hEventWork, &m_cPool.hMutex);
+        }
+
+        atomic_fetch_sub(&m_cPool.nIdle, 1);
+        pthread_mutex_unlock(&m_cPool.hMutex);
+    }
+
+    return NULL;
+}
+
+static void pool_Init()
+{
+    long nCpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    m_cPool.nThreads = nCpus > 0 ? nCpus : 1;
+    m_cPool.lThreads = malloc(m_cPool.nThreads * sizeof(pthread_t));
+    m_cPool.lQueues = malloc(m_cPool.nThreads * sizeof(PoolQueue));
+    pool_InitQueue(&m_cPool.cShared);
+    pool_InitQueue(&m_cPool.cJobs);
+    pthread_mutex_init(&m_cPool.hMutex, NULL);
+    pthread_cond_init(&m_cPool.hEventWork, NULL);
+    pthread_cond_init(&m_cPool.hEventWait, NULL);
+    atomic_init(&m_cPool.nEpoch, 0);
+    atomic_init(&m_cPool.nIdle, 0);
+    atomic_init(&m_cPool.nWaiting, 0);
+
+    for (int i = 0; i < m_cPool.nThreads; i++)
+    {
+        pool_InitQueue(&m_cPool.lQueues[i]);
+    }
+
+    for (int i = 0; i < m_cPool.nThreads; i++)
+    {
+        if (pthread_create(&m_cPool.lThreads[i], NULL, pool_OnWork, (void*)(intptr_t)i) != 0)
+        {
+            printf("PANIC: Could not start worker thread\n");
+            exit(1);
+        }
+    }
+}
+
+int pool_GetThreads()
+{
+    pthread_once(&m_hPoolOnce, pool_Init);
+
+    return m_cPool.nThreads;
+}
+
+void pool_GroupInit(PoolGroup *pGroup)
+{
+    atomic_init(&pGroup->nPending, 0);
+}
+
+bool pool_GroupDone(PoolGroup *pGroup)
+{
+    return atomic_load(&pGroup->nPending) == 0;
+}
+
+void pool_GroupAdd(PoolGroup *pGroup)
+{
+    atomic_fetch_add(&pGroup->nPending, 1);
+}
+
+void pool_GroupRelease(PoolGroup *pGroup)
+{
+    if (atomic_fetch_sub(&pGroup->nPending, 1) == 1)
+    {
+        pool_Notify(false);
+    }
+}
+
+void pool_Submit(PoolGroup *pGroup, PoolFunc pFunc, void *pData)
+{
+    pthread_once(&m_hPoolOnce, pool_Init);
+
+    PoolTask cTask = {pFunc, pData, pGroup};
+
+    if (pGroup)
+    {
+        atomic_fetch_add(&pGroup->nPending, 1);
+    }
+
+    pool_Push(m_nWorker != -1 ? &m_cPool.lQueues[m_nWorker] : &m_cPool.cShared, &cTask);
+    pool_Notify(true);
+}
+
+void pool_SubmitJob(PoolGroup *pGroup, PoolFunc pFunc, void *pData)
+{
+    pthread_once(&m_hPoolOnce, pool_Init);
+
+    PoolTask cTask = {pFunc, pData, pGroup};
+
+    if (pGroup)
+    {
+        atomic_fetch_add(&pGroup->nPending, 1);
+    }
+
+    pool_Push(&m_cPool.cJobs, &cTask);
+    pool_Notify(true);
+}
+
+void pool_Wait(PoolGroup *pGroup)
+{
+    while (atomic_load(&pGroup->nPending) > 0)
+    {
+        unsigned int nEpoch = atomic_load(&m_cPool.nEpoch);
+
+        if (pool_RunTask(false))
+        {
+            continue;
+        }
+
+        pthread_mutex_lock(&m_cPool.hMutex);
+        atomic_fetch_add(&m_cPool.nWaiting, 1);
+
+        while (atomic_load(&pGroup->nPending) > 0 && atomic_load(&m_cPool.nEpoch) == nEpoch)
+        {
+            pthread_cond_wait(&m_cPool.hEventWait, &m_cPool.hMutex);
+        }
+
+        atomic_fetch_sub(&m_cPool.nWaiting, 1);
+        pthread_mutex_unlock(&m_cPool.hMutex);
+    }
+}
+
+static void pool_OnStage(void *pData)
+{
+    PoolStage *pStage = (PoolStage*)pData;
+    int nState = STAGE_RUNNING;
+
+    do
+    {
+        atomic_store(&pStage->nState, STAGE_RUNNING);
+        pStage->pFunc(pStage->pData);
+        nState = STAGE_RUNNING;
+    }
+    while (!atomic_compare_exchange_strong(&pStage->nState, &nState, STAGE_IDLE));
+}
+
+void pool_StageInit(PoolStage *pStage, PoolFunc pFunc, void *pData)
+{
+    pool_GroupInit(&pStage->cGroup);
+    pStage->pFunc = pFunc;
+    pStage->pData = pData;
+    atomic_init(&pStage->nState, STAGE_IDLE);
+}
+
+void pool_StageKick(PoolStage *pStage)
+{
+    if (atomic_exchange(&pStage->nState, STAGE_PENDING) == STAGE_IDLE)
+    {
+        pool_Submit(&pStage->cGroup, pool_OnStage, pStage);
+    }
+}
+
+void pool_StageWait(PoolStage *pStage)
+{
+    pool_Wait(&pStage->cGroup);
+}
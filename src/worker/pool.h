@@ -0,0 +1,98 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "stdbool.h"
+
+typedef void (*PoolFunc)(void *pData);
+
+typedef struct
+{
+    atomic_int nPending;
+
+} PoolGroup;
+
+typedef struct
+{
+    PoolFunc pFunc;
+    void *pData;
+    PoolGroup *pGroup;
+
+} PoolTask;
+
+typedef struct
+{
+    PoolTask *lTasks;
+    int nSize;
+    int nHead;
+    atomic_int nCount;
+    pthread_mutex_t hMutex;
+
+} PoolQueue;
+
+typedef enum
+{
+    STAGE_IDLE,
+    STAGE_PENDING,
+    STAGE_RUNNING
+
+} PoolStageState;
+
+typedef struct
+{
+    PoolGroup cGroup;
+    PoolFunc pFunc;
+    void *pData;
+    atomic_int nState;
+
+} PoolStage;
+
+/*
+    One pool for the whole library. Tasks are stolen between the workers' deques, jobs (whole tracks) are only picked up
+    by idle workers, so a thread helping out in pool_Wait never gets stuck inside someone else's track.
+*/
+
+int pool_GetThreads();
+void pool_GroupInit(PoolGroup *pGroup);
+bool pool_GroupDone(PoolGroup *pGroup);
+void pool_Submit(PoolGroup *pGroup, PoolFunc pFunc, void *pData);
+void pool_SubmitJob(PoolGroup *pGroup, PoolFunc pFunc, void *pData);
+void pool_Wait(PoolGroup *pGroup);
+
+/*
+    A group can also count work that is not a task of its own, such as the items in a stage's input. pool_Wait returns
+    once every added item has been released.
+*/
+
+void pool_GroupAdd(PoolGroup *pGroup);
+void pool_GroupRelease(PoolGroup *pGroup);
+
+/*
+    A stage never runs twice at once, and a kick guarantees one more run after it, so it can drain its ring and return.
+*/
+
+void pool_StageInit(PoolStage *pStage, PoolFunc pFunc, void *pData);
+void pool_StageKick(PoolStage *pStage);
+void pool_StageWait(PoolStage *pStage);
+
+#endif
@@ -0,0 +1,82 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#include "ring.h"
+#include <stdlib.h>
+
+void ring_Init(Ring *pRing, unsigned int nSize)
+{
+    pRing->nSize = 1;
+
+    while (pRing->nSize < nSize)
+    {
+        pRing->nSize <<= 1;
+    }
+
+    pRing->lItems = malloc(pRing->nSize * sizeof(void*));
+    atomic_init(&pRing->nHead, 0);
+    atomic_init(&pRing->nTail, 0);
+}
+
+void ring_Free(Ring *pRing)
+{
+    free(pRing->lItems);
+    pRing->lItems = NULL;
+}
+
+void ring_Reset(Ring *pRing)
+{
+    atomic_store(&pRing->nHead, 0);
+    atomic_store(&pRing->nTail, 0);
+}
+
+unsigned int ring_Count(Ring *pRing)
+{
+    return atomic_load_explicit(&pRing->nTail, memory_order_acquire) - atomic_load_explicit(&pRing->nHead, memory_order_acquire);
+}
+
+bool ring_Push(Ring *pRing, void *pItem)
+{
+    unsigned int nTail = atomic_load_explicit(&pRing->nTail, memory_order_relaxed);
+
+    if (nTail - atomic_load_explicit(&pRing->nHead, memory_order_acquire) == pRing->nSize)
+    {
+        return false;
+    }
+
+    pRing->lItems[nTail & (pRing->nSize - 1)] = pItem;
+    atomic_store_explicit(&pRing->nTail, nTail + 1, memory_order_release);
+
+    return true;
+}
+
+bool ring_Pop(Ring *pRing, void **pItem)
+{
+    unsigned int nHead = atomic_load_explicit(&pRing->nHead, memory_order_relaxed);
+
+    if (nHead == atomic_load_explicit(&pRing->nTail, memory_order_acquire))
+    {
+        return false;
+    }
+
+    *pItem = pRing->lItems[nHead & (pRing->nSize - 1)];
+    atomic_store_explicit(&pRing->nHead, nHead + 1, memory_order_release);
+
+    return true;
+}
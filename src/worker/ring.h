@@ -0,0 +1,46 @@
+/*
+    Copyright 2015-2025 Robert Tari <robert@tari.in>
+
+    This file is part of Odio SACD library.
+
+    Odio SACD library is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Odio SACD library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Odio SACD library. If not, see <http://www.gnu.org/licenses/gpl-3.0.txt>.
+*/
+
+#ifndef RING_H
+#define RING_H
+
+#include <stdatomic.h>
+#include "stdbool.h"
+
+/*
+    Single producer, single consumer. Either side may move between threads, as long as only one is on it at a time.
+*/
+
+typedef struct
+{
+    void **lItems;
+    unsigned int nSize;
+    atomic_uint nHead;
+    atomic_uint nTail;
+
+} Ring;
+
+void ring_Init(Ring *pRing, unsigned int nSize);
+void ring_Free(Ring *pRing);
+void ring_Reset(Ring *pRing);
+unsigned int ring_Count(Ring *pRing);
+bool ring_Push(Ring *pRing, void *pItem);
+bool ring_Pop(Ring *pRing, void **pItem);
+
+#endif